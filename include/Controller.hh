@@ -21,7 +21,8 @@ class Controller : vivictpp::EventListener {
 public:
   Controller(std::shared_ptr<EventLoop> eventLoop,
              std::shared_ptr<vivictpp::ui::Display> display,
-             VivictPPConfig vivictPPConfig);
+             VivictPPConfig vivictPPConfig,
+             std::shared_ptr<InputOpener> inputOpener = nullptr);
   int run();
   void mouseDrag(const ui::MouseDragged mouseDragged) override;
   void mouseDragStarted(const ui::MouseDragStarted mouseDragStarted) override;
@@ -41,6 +42,7 @@ public:
 private:
   void togglePlaying();
   void adjustPlaybackSpeed(int delta);
+  vivictpp::time::Time seekBarPts(double relativePos);
 
 private:
   std::shared_ptr<EventLoop> eventLoop;
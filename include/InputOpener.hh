@@ -0,0 +1,53 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef INPUTOPENER_HH_
+#define INPUTOPENER_HH_
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "SourceConfig.hh"
+#include "logging/Logging.hh"
+#include "workers/PacketWorker.hh"
+
+/*
+  Opens the inputs of all sources concurrently, each on a thread of its own,
+  since opening and probing an input can take seconds, e.g. for hls or for
+  files on network mounts. Opening starts when the opener is created, so
+  that the window can be shown while waiting.
+ */
+class InputOpener {
+public:
+  explicit InputOpener(const std::vector<SourceConfig> &sourceConfigs);
+  // Waits for inputs that are still being opened
+  ~InputOpener();
+  InputOpener(const InputOpener &) = delete;
+  InputOpener &operator=(const InputOpener &) = delete;
+
+  int size() const { return static_cast<int>(futures.size()); }
+  int openedCount() const { return opened.load(); }
+  bool isDone() const { return openedCount() == size(); }
+  // Time when opening started, from vivictpp::time::relativeTimeMillis
+  int64_t getStartTime() const { return startTime; }
+  // Waits for all inputs, in the order of the sources. Rethrows the error of
+  // the first input that could not be opened. May only be called once.
+  std::vector<std::shared_ptr<vivictpp::workers::PacketWorker>> get();
+
+private:
+  std::shared_ptr<vivictpp::workers::PacketWorker> open(const std::string &path,
+                                                        const std::string &format);
+
+private:
+  vivictpp::logging::Logger logger;
+  const int64_t startTime;
+  std::atomic<int> opened{0};
+  std::vector<std::future<std::shared_ptr<vivictpp::workers::PacketWorker>>> futures;
+};
+
+#endif // INPUTOPENER_HH_
@@ -8,12 +8,78 @@
 
 #include "time/Time.hh"
 
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
 
 namespace vivictpp {
 
   typedef std::function<void(vivictpp::time::Time,bool)> SeekCallback;
 
+/*
+  Handed along with a seek to the workers carrying it out. The token becomes
+  obsolete when a later seek is started from the same SeekSequence, and the
+  workers then stop working towards its target. A default constructed token
+  never becomes obsolete.
+ */
+class SeekToken {
+public:
+  SeekToken() = default;
+  bool obsolete() const { return latest && latest->load() != generation; }
+private:
+  SeekToken(std::shared_ptr<const std::atomic<uint64_t>> latest, uint64_t generation):
+    latest(std::move(latest)), generation(generation) {}
+  std::shared_ptr<const std::atomic<uint64_t>> latest;
+  uint64_t generation{0};
+  friend class SeekSequence;
+};
+
+class SeekSequence {
+public:
+  // Makes the tokens of all earlier seeks obsolete
+  SeekToken next() { return SeekToken(latest, ++(*latest)); }
+private:
+  std::shared_ptr<std::atomic<uint64_t>> latest{std::make_shared<std::atomic<uint64_t>>(0)};
+};
+
+/*
+  Holds the callbacks of queued seek commands, so that a seek command only
+  captures a ticket and fits the inline command storage. A slot is reused
+  after SLOTS later seeks, the seek is then long superseded and take()
+  returns an empty callback.
+ */
+class SeekCallbackSlots {
+public:
+  uint64_t put(SeekCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t ticket = nextTicket++;
+    slots[ticket % SLOTS] = Slot{ticket, std::move(callback)};
+    return ticket;
+  }
+  SeekCallback take(uint64_t ticket) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Slot &slot = slots[ticket % SLOTS];
+    if (slot.ticket != ticket) {
+      return SeekCallback();
+    }
+    return std::move(slot.callback);
+  }
+private:
+  struct Slot {
+    uint64_t ticket;
+    SeekCallback callback;
+  };
+  static constexpr size_t SLOTS = 8;
+  std::mutex mutex;
+  std::array<Slot, SLOTS> slots{};
+  uint64_t nextTicket{0};
+};
+
 }  // namespace vivictpp
 
 #endif  // SEEKING_HH_
@@ -16,12 +16,14 @@ public:
                std::string filter = "",
                std::string vmafLogFile = "",
                std::string formatOptions = "",
-               vivictpp::libav::DecoderOptions decoderOptions = {}):
+               vivictpp::libav::DecoderOptions decoderOptions = {},
+               double priorityWeight = 1.0):
     path(path),
     filter(filter),
     vmafLog(vmafLogFile),
     formatOptions(formatOptions),
-    decoderOptions(decoderOptions)
+    decoderOptions(decoderOptions),
+    priorityWeight(priorityWeight)
     {
     }
 
@@ -30,6 +32,8 @@ public:
   const vivictpp::vmaf::VmafLog vmafLog;
   const std::string formatOptions;
   const vivictpp::libav::DecoderOptions decoderOptions;
+  // Scheduling weight of the demux and decode work for this source
+  const double priorityWeight;
 };
 
 #endif  // SOURCECONFIG_HH_
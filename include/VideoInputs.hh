@@ -11,29 +11,44 @@ extern "C" {
 #include <libavformat/avformat.h>
 }
 
+#include <array>
 #include <memory>
 #include <string>
 #include <vector>
 #include <exception>
 #include <atomic>
 #include <mutex>
+#include <set>
 
+#include "InputOpener.hh"
+#include "Resolution.hh"
 #include "SourceConfig.hh"
 #include "VivictPPConfig.hh"
 #include "libav/Frame.hh"
+#include "libav/ThumbnailCache.hh"
 #include "workers/PacketWorker.hh"
 #include "workers/DecoderWorker.hh"
+#include "workers/FrameHistory.hh"
+#include "workers/HistoryWorker.hh"
+#include "workers/ThumbnailWorker.hh"
 #include "Seeking.hh"
 
 struct MediaPipe {
     std::shared_ptr<vivictpp::workers::PacketWorker> packetWorker;
     std::shared_ptr<vivictpp::workers::DecoderWorker> decoder;
+    // Frames before the frame buffer, for video inputs when prefetching or
+    // keeping of dropped frames is enabled
+    std::shared_ptr<vivictpp::workers::FrameHistory> history;
+    std::shared_ptr<vivictpp::workers::HistoryWorker> historyWorker;
+    // Pts of the history frame shown, NO_TIME while the frame at the cursor
+    // of the frame buffer is shown
+    vivictpp::time::Time historyPts{vivictpp::time::NO_TIME};
 };
 
 class SeekState {
 public:
     int reset(int nSeeks, vivictpp::SeekCallback onFinished);
-    void handleSeekFinished(int seekId, int seekPos, bool error);
+    void handleSeekFinished(int seekId, vivictpp::time::Time seekPos, bool error);
 
 private:
     int seekId{1}; // Used to ignore obsolete callbacks from previos seek operations
@@ -58,16 +73,60 @@ private:
     }
     vivictpp::logging::Logger logger;
     SeekState seekState;
+    // Each seek makes the workers abandon the previous one, if still running
+    vivictpp::SeekSequence seekSequence;
+    // Seek bar thumbnails of the left and right video, if enabled
+    std::array<std::shared_ptr<vivictpp::libav::ThumbnailCache>, 2> thumbnailCaches;
+    std::vector<std::unique_ptr<vivictpp::workers::ThumbnailWorker>> thumbnailWorkers;
+    // When opening of the inputs started, for logging time to first frame
+    int64_t openStartTime;
+    std::set<std::string> loggedFirstFrames;
+    bool firstFramesReady{false};
+    bool downscaleToWindow;
+    Resolution downscaleResolution;
+    // Frames to keep decoded before the frame shown while stopped
+    int prefetchFrames;
+    // Frames dropped by the frame buffers kept in the histories
+    int historyFrames;
+    bool keyframesOnly{false};
+    // The frames buffered since the last seek were demuxed keyframes only
+    bool keyframesOnlyBuffered{false};
 
 public:
-    explicit VideoInputs(VivictPPConfig vivictPPConfig);
+    // Takes the inputs from inputOpener if given, otherwise opens them
+    explicit VideoInputs(VivictPPConfig vivictPPConfig,
+                         std::shared_ptr<InputOpener> inputOpener = nullptr);
     bool ptsInRange(vivictpp::time::Time pts);
     void stepForward(vivictpp::time::Time pts);
     void stepBackward(vivictpp::time::Time pts);
     void dropIfFullAndOutOfRange(vivictpp::time::Time nextPts, int framesToDrop);
     void dropIfFullAndNextOutOfRange(vivictpp::time::Time currentPts, int framesToDrop);
+    // True once every decoder has buffered at least one frame, which is
+    // when playback can start
+    bool firstFramesBuffered();
     std::array<vivictpp::libav::Frame, 2> firstFrames();
+    // The buffered frames up to distance frames before and after the first
+    // frames, nearest first
+    std::array<std::vector<vivictpp::libav::Frame>, 2> neighbourFrames(int distance);
     void seek(vivictpp::time::Time pts, vivictpp::SeekCallback onSeekFinished);
+    // Decodes the frames before the frame buffers or histories in the
+    // background, for the inputs where fewer than the configured number of
+    // frames are kept before the frame shown. Called while playback is
+    // stopped.
+    void prefetch();
+    void stopPrefetching();
+    // The thumbnails of the left and right video closest before pts, null
+    // where none has been made yet
+    std::array<std::shared_ptr<const vivictpp::libav::Thumbnail>, 2> thumbnailsAt(vivictpp::time::Time pts);
+    // Only keyframes of the video streams are demuxed while set. Should be
+    // followed by a seek, so that decoding starts over from a keyframe. No pts
+    // is in range after it is cleared, until that seek.
+    void setKeyframesOnly(bool keyframesOnly);
+    // Sets the resolution the video frames are shown at when the whole frame
+    // is visible, empty if frames must be kept at full resolution. Frames are
+    // only downscaled if enabled in the config. Returns true if the frames
+    // already buffered may have less detail than now wanted.
+    bool setDownscaleResolution(Resolution resolution);
     std::array<std::vector<VideoMetadata>, 2> metadata();
     vivictpp::time::Time duration();
     vivictpp::time::Time startTime();
@@ -107,34 +166,17 @@ public:
          return _leftFrameOffset;
     }
 
-    vivictpp::time::Time nextPts() {
-      vivictpp::time::Time nextPtsL = leftInput.decoder->frames().nextPts() - leftPtsOffset;
-      if (!rightInput.decoder) {
-        return nextPtsL;
-      }
-      vivictpp::time::Time nextPtsR = rightInput.decoder->frames().nextPts();
-      if (vivictpp::time::isNoPts(nextPtsL)) {
-        return nextPtsL;
-      }
-      if (vivictpp::time::isNoPts(nextPtsR)) {
-        return nextPtsR;
-      }
-      return std::min(nextPtsL, nextPtsR);
-    }
-    vivictpp::time::Time previousPts() {
-      vivictpp::time::Time ppl = leftInput.decoder->frames().previousPts() - leftPtsOffset;
-      if(!rightInput.decoder) {
-        return ppl;
-      }
-      vivictpp::time::Time ppr = rightInput.decoder->frames().previousPts();
-      if (vivictpp::time::isNoPts(ppl)) {
-        return ppl;
-      }
-      if (vivictpp::time::isNoPts(ppr)) {
-        return ppr;
-      }
-      return std::max(ppl, ppr);
-    }
+    // Frames in the frame history count as buffered in these
+    vivictpp::time::Time nextPts();
+    vivictpp::time::Time previousPts();
+    // Like nextPts and previousPts, but looked up in the frame index, so
+    // that frames that are not buffered can be found. NO_TIME if the index
+    // does not reach pts yet.
+    vivictpp::time::Time indexedNextPts(vivictpp::time::Time pts);
+    vivictpp::time::Time indexedPreviousPts(vivictpp::time::Time pts);
+    // Pts of the last keyframe of the left input at or before pts, NO_TIME if
+    // the index does not reach pts yet
+    vivictpp::time::Time indexedKeyframeBefore(vivictpp::time::Time pts);
     void selectVideoStreamLeft(int streamIndex);
     void selectVideoStreamRight(int streamIndex);
     bool hasAudio() { return audio1.decoder.get() != nullptr;  }
@@ -153,6 +195,18 @@ public:
 
 private:
 void selectStream(MediaPipe &input, int streamIndex);
+void createHistory(MediaPipe &input, const AVStream *stream, const SourceConfig &source,
+                   const vivictpp::libav::DecoderOptions &decoderOptions,
+                   const VivictPPConfig &vivictPPConfig);
+void setHistoryPts(MediaPipe &input, vivictpp::time::Time pts);
+bool historyJoins(MediaPipe &input);
+bool ptsInRange(MediaPipe &input, vivictpp::time::Time pts);
+void stepForward(MediaPipe &input, vivictpp::time::Time pts);
+void stepBackward(MediaPipe &input, vivictpp::time::Time pts);
+vivictpp::libav::Frame first(MediaPipe &input);
+vivictpp::time::Time nextPts(MediaPipe &input);
+vivictpp::time::Time previousPts(MediaPipe &input);
+void prefetch(MediaPipe &input);
 };
 
 #endif // VIDEOINPUTS_HH_
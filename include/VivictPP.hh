@@ -49,6 +49,14 @@ struct PlayerState {
   bool updateVideoMetadata{false};
   vivictpp::AVSync avSync;
   int playbackSpeed{0};
+  // Only keyframes are decoded, see VivictPP::updateTrickPlay
+  bool trickPlay{false};
+  // Keyframe previews are shown, see VivictPP::scrubTo
+  bool scrubbing{false};
+  bool resumeAfterScrubbing{false};
+  vivictpp::time::Time scrubPts{vivictpp::time::NO_TIME};
+  // Exact position to seek to once the preview being decoded is shown
+  vivictpp::time::Time refinePts{vivictpp::time::NO_TIME};
   PlaybackState togglePlaying();
 };
 /*
@@ -63,7 +71,8 @@ class VivictPP  {
 public:
   VivictPP(VivictPPConfig vivictPPConfig,
            std::shared_ptr<EventScheduler> eventScheduler,
-           vivictpp::audio::AudioOutputFactory &audioOutputFactory);
+           vivictpp::audio::AudioOutputFactory &audioOutputFactory,
+           std::shared_ptr<InputOpener> inputOpener = nullptr);
   virtual ~VivictPP() = default;
   void advanceFrame();
   PlaybackState togglePlaying();
@@ -73,6 +82,12 @@ public:
   void seekNextFrame();
   void seekPreviousFrame();
   void seekFrame(int delta);
+  // While scrubbing only keyframes are decoded, and each position scrubbed
+  // to shows the keyframe before it. When scrubbing stops the exact frame
+  // replaces the last preview.
+  void startScrubbing();
+  void scrubTo(vivictpp::time::Time pts);
+  void stopScrubbing(vivictpp::time::Time pts);
   void switchStream(int delta);
   int adjustPlaybackSpeed(int delta);
   int nextFrameDelay();
@@ -101,6 +116,18 @@ public:
     return value;
   }
   void onSeekFinished(vivictpp::time::Time seekedPos, bool error);
+  // See VideoInputs::setDownscaleResolution
+  void setDownscaleResolution(Resolution resolution);
+
+ private:
+  vivictpp::time::Time frameBefore(vivictpp::time::Time pts);
+  vivictpp::time::Time frameAfter(vivictpp::time::Time pts);
+  bool audioInRange(vivictpp::time::Time pts);
+  void updateTrickPlay();
+  void reseek();
+  void seekInputs(vivictpp::time::Time pts);
+  void refineScrubbing();
+  vivictpp::time::Time clampPts(vivictpp::time::Time pts);
 
  private:
   PlayerState state;
@@ -108,6 +135,7 @@ public:
   VideoInputs videoInputs;
   std::shared_ptr<vivictpp::audio::AudioOutput> audioOutput;
   vivictpp::time::Time frameDuration;
+  double trickPlaySpeed;
   vivictpp::logging::Logger logger;
   vivictpp::logging::Logger seeklog;
 };
@@ -13,14 +13,42 @@
 
 class VivictPPConfig {
 public:
-  VivictPPConfig(std::vector<SourceConfig> sourceConfigs, bool disableAudio):
+  VivictPPConfig(std::vector<SourceConfig> sourceConfigs, bool disableAudio,
+                 double trickPlaySpeed = 8.0, bool downscaleToWindow = false,
+                 double thumbnailInterval = 10.0, int prefetchFrames = 12,
+                 int historyFrames = 250):
     sourceConfigs(sourceConfigs),
-    disableAudio(disableAudio) {}
+    disableAudio(disableAudio),
+    trickPlaySpeed(trickPlaySpeed),
+    downscaleToWindow(downscaleToWindow),
+    thumbnailInterval(thumbnailInterval),
+    prefetchFrames(prefetchFrames),
+    historyFrames(historyFrames) {}
 
   const std::vector<SourceConfig> sourceConfigs;
 
   const bool disableAudio;
 
+  // Playback speed factor from which only keyframes are decoded, 0 disables
+  // trick-play
+  const double trickPlaySpeed;
+
+  // Video frames are downscaled by the decoding pipeline to the size they
+  // are shown at, when that is smaller than the video
+  const bool downscaleToWindow;
+
+  // Seconds between the seek bar thumbnails, 0 disables thumbnails
+  const double thumbnailInterval;
+
+  // Video frames kept decoded before and after the shown frame while
+  // playback is stopped, 0 disables decoding of frames before the buffered
+  // ones
+  const int prefetchFrames;
+
+  // Video frames dropped from the frame buffer that are kept losslessly
+  // compressed, limited by the memory budget, 0 disables keeping them
+  const int historyFrames;
+
 public:
   bool hasVmafData() {
     return std::any_of(sourceConfigs.begin(),
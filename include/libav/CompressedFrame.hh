@@ -0,0 +1,43 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef LIBAV_COMPRESSEDFRAME_HH
+#define LIBAV_COMPRESSEDFRAME_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "libav/Frame.hh"
+
+namespace vivictpp::libav {
+
+/*
+  A decoded video frame with its planes compressed losslessly with the
+  PlaneCodec, and the properties of the frame kept as they are. Decompressing
+  gives a frame that is identical in content to the one compressed, in a
+  newly allocated buffer.
+ */
+class CompressedFrame {
+public:
+  // Null if the pixel format of the frame can not be compressed, e.g.
+  // hardware frames and paletted formats
+  static std::shared_ptr<const CompressedFrame> compress(const Frame &frame);
+  // An empty frame if the buffer can not be allocated
+  Frame decompress() const;
+  size_t byteSize() const;
+
+private:
+  CompressedFrame() = default;
+
+private:
+  // The properties of the frame, without data buffers
+  Frame props{Frame::emptyFrame()};
+  std::vector<std::vector<uint8_t>> planes;
+};
+
+}  // namespace vivictpp::libav
+
+#endif // LIBAV_COMPRESSEDFRAME_HH
@@ -13,10 +13,12 @@ extern "C" {
 #include <exception>
 #include <stdexcept>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "libav/Packet.hh"
 #include "libav/Frame.hh"
+#include "libav/FramePool.hh"
 #include "logging/Logging.hh"
 
 namespace vivictpp {
@@ -25,29 +27,59 @@ namespace libav {
 struct  DecoderOptions {
   std::string hwAccel;
   std::vector<std::string> preferredDecoders;
+  // Number of decoder instances decoding groups of pictures in parallel, see
+  // GopDecoder. Only for video that is intra-only or has closed GOPs, 0 or 1
+  // decodes with a single decoder.
+  int gopDecoders{0};
+  // Decoder threads, 0 means a share of the cpu cores, see
+  // divideDecoderThreads. With GOP decoders this is the total for all of them.
+  int threads{0};
+  // Value of the thread_type codec option, "frame", "slice" or "frame+slice",
+  // empty for the codec default
+  std::string threadType;
+  // Value of the lowres codec option, for decoders that support it
+  int lowres{0};
+  // Value of the skip_loop_filter codec option, e.g. "noref" or "all", empty
+  // for the codec default
+  std::string skipLoopFilter;
 };
 
+// Parses options on the form key1=value1:key2=value2, where the keys are
+// threads, thread_type, lowres, skip_loop_filter and gop_decoders, into
+// decoderOptions. Throws on unknown keys, and on values of threads, lowres
+// and gop_decoders that are not non-negative integers.
+void parseDecoderOptions(const std::string &options, DecoderOptions &decoderOptions);
+
 class Decoder {
 public:
   explicit Decoder(AVCodecParameters *codecParameters, const DecoderOptions &decoderOptions);
   ~Decoder() = default;
 
+  // An empty packet drains the decoder, and leaves it ready for new packets
   std::vector<vivictpp::libav::Frame> handlePacket(vivictpp::libav::Packet packet);
   void flush();
+  // In pre-roll, frames that are not used as reference by other frames are
+  // not decoded. Reference frames are decoded in full, loop filter included,
+  // so frames decoded after pre-roll ends have full quality.
+  void setPreroll(bool preroll);
   AVCodecContext *getCodecContext() { return this->codecContext.get(); }
+  std::shared_ptr<FramePool> getFramePool() { return framePool; }
 private:
   void initCodecContext(AVCodecParameters *codecParameters, const DecoderOptions &decoderOptions);
   void initHardwareContext(std::string hwAccel);
-  void openCodec();
+  void openCodec(const DecoderOptions &decoderOptions);
   void logAudioCodecInfo();
   void selectSwPixelFormat();
 private:
   std::shared_ptr<AVCodecContext> codecContext;
+  std::shared_ptr<FramePool> framePool;
   vivictpp::libav::Frame nextFrame;
   vivictpp::logging::Logger logger;
   std::shared_ptr<AVBufferRef> hwDeviceContext;
   AVPixelFormat hwPixelFormat;
   AVPixelFormat swPixelFormat;
+  // As opened, restored when pre-roll ends
+  AVDiscard skipFrame;
 };
 
 std::shared_ptr<AVCodecContext> createCodecContext(AVCodecParameters *codecParameters);
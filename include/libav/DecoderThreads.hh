@@ -0,0 +1,35 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef LIBAV_DECODERTHREADS_HH
+#define LIBAV_DECODERTHREADS_HH
+
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+namespace vivictpp {
+namespace libav {
+
+// Relative cost of decoding a stream, from its resolution, frame rate and
+// codec. Audio streams have no cost.
+double decodingCost(const AVStream *stream);
+
+/*
+  Divides cores between the decoders, so that the decoders of all inputs
+  together do not use more threads than there are cores. Decoders with a
+  thread count set in requested keep it, the others get at least one thread
+  each, and the cores that are left are divided between them in proportion
+  to their cost.
+ */
+std::vector<int> divideDecoderThreads(const std::vector<double> &costs,
+                                      const std::vector<int> &requested,
+                                      int cores);
+
+}  // namespace libav
+}  // namespace vivictpp
+
+#endif // LIBAV_DECODERTHREADS_HH
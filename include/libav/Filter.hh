@@ -16,6 +16,7 @@ extern "C" {
 }
 
 #include "libav/Frame.hh"
+#include "libav/FramePool.hh"
 #include "Resolution.hh"
 #include "VideoMetadata.hh"
 
@@ -29,7 +30,7 @@ public:
   bool eof() { return eof_; };
   Resolution getFilteredResolution();
 protected:
-  Filter(std::string definition);
+  Filter(std::string definition, std::shared_ptr<FramePool> framePool);
   void createFilter(AVFilterContext **filt_ctx, std::string filterName, const std::string name, const char *args, void *opaque);
   void configureGraph(std::string definition);
   AVFilterContext *bufferSrcCtx;
@@ -38,6 +39,7 @@ protected:
   std::string definition;
 private:
   bool eof_;
+  std::shared_ptr<FramePool> framePool;
   Frame nextFrame;
 };
 
@@ -54,7 +56,8 @@ struct VideoFilterFormatParameters {
 
 class VideoFilter: public Filter {
 public:
-  VideoFilter(AVStream *avStream, AVCodecContext *codecContext, std::string definition);
+  VideoFilter(AVStream *avStream, AVCodecContext *codecContext, std::string definition,
+              std::shared_ptr<FramePool> framePool = FramePool::create());
   ~VideoFilter() = default;
   FilteredVideoMetadata getFilteredVideoMetadata();
   Frame filterFrame(const Frame &frame) override;
@@ -66,7 +69,8 @@ private:
 
 class AudioFilter: public Filter {
 public:
-  AudioFilter(AVCodecContext *codecContext, std::string definition);
+  AudioFilter(AVCodecContext *codecContext, std::string definition,
+              std::shared_ptr<FramePool> framePool = FramePool::create());
   ~AudioFilter() = default;
 private:
     void configure(AVCodecContext *codecContext,
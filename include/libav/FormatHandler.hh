@@ -12,11 +12,13 @@ extern "C" {
 }
 
 #include <exception>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <vector>
 #include <set>
 
+#include "libav/FrameIndex.hh"
 #include "time/Time.hh"
 #include "logging/Logging.hh"
 
@@ -39,14 +41,25 @@ public:
   AVFormatContext *getFormatContext() const { return formatContext; }
   AVPacket *nextPacket();
   void seek(vivictpp::time::Time t);
+  // When the index covers the seek position, seeks go to the exact
+  // keyframe preceding it
+  void setFrameIndex(std::shared_ptr<FrameIndex> frameIndex) { this->frameIndex = frameIndex; }
   void setStreamActive(int streamIndex);
   void setStreamInactive(int streamIndex);
   void setActiveStreams(const std::set<int> &activeStreams);
+  // For trick-play. When set, only keyframes of the active video streams are
+  // read, packets of other streams are read as usual.
+  void setKeyframesOnly(bool keyframesOnly);
 
 public:
   AVFormatContext *formatContext;
   std::string inputFile;
 
+private:
+  bool seekToKeyframe(AVStream *stream, const IndexEntry &keyframe);
+  AVDiscard activeDiscard(const AVStream *stream) const;
+  bool skipPacket(const AVPacket *packet) const;
+
 private:
   AVPacket *packet;
   vivictpp::logging::Logger logger;
@@ -55,6 +68,8 @@ private:
   std::vector<AVStream *> audioStreams;
   std::vector<AVStream *> streams;
   std::set<int> activeStreams;
+  std::shared_ptr<FrameIndex> frameIndex;
+  bool keyframesOnly{false};
 };
 
 }  // namespace libav
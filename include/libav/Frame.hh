@@ -5,6 +5,8 @@
 #ifndef LIBAV_FRAME_HH
 #define LIBAV_FRAME_HH
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 
 extern "C" {
@@ -16,14 +18,21 @@ extern "C" {
 
 namespace vivictpp::libav {
 
+/*
+  Reference counted handle to a decoded AVFrame. Copying a Frame only shares
+  the underlying AVFrame, it is never cloned, so a frame must not be modified
+  once it has been handed out.
+ */
 class Frame {
 private:
   std::shared_ptr<AVFrame> frame;
 public:
   Frame();
-  Frame(const Frame &frame);
+  Frame(const Frame &frame) = default;
+  Frame(Frame &&frame) = default;
   ~Frame() = default;
-  Frame &operator=(const Frame &frame);
+  Frame &operator=(const Frame &frame) = default;
+  Frame &operator=(Frame &&frame) = default;
   AVFrame* avFrame() const { return frame.get(); }
   std::shared_ptr<AVFrame> operator->() const { return frame; }
   bool empty() const { return !frame; }
@@ -44,10 +53,19 @@ public:
     }
   }
   Frame transferHwData(AVPixelFormat swPixelFormat);
+  // Size of the data buffers referenced by the frame
+  size_t byteSize() const;
+  // Total number of AVFrames allocated by the process, recycled frames are
+  // not counted
+  static uint64_t allocationCount();
 private:
   Frame(AVFrame *avFrame);
+  explicit Frame(std::shared_ptr<AVFrame> frame);
+  friend class FramePool;
 };
 
+AVFrame* allocFrame();
+
 void freeFrame(AVFrame* avFrame);
 
 }  // namespace vivictpp::libav
@@ -0,0 +1,80 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef LIBAV_FRAMEINDEX_HH
+#define LIBAV_FRAMEINDEX_HH
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "time/Time.hh"
+
+namespace vivictpp::libav {
+
+struct IndexEntry {
+  // Presentation time, in vivictpp::time units
+  vivictpp::time::Time pts;
+  // Decoding timestamp in the time base of the stream, as used when seeking
+  int64_t dts;
+  // Byte position in the input, -1 if unknown
+  int64_t pos;
+  int size;
+  bool keyframe;
+};
+
+/*
+  Index of all packets of the streams of an input, sorted by presentation
+  time. It is filled by scanning the packets of the input in decoding order
+  while the index is already being used, so every lookup only answers if the
+  scan has got far enough for the answer to be exact.
+
+  Since no frame is presented before it is decoded, all frames with a pts up
+  to the highest dts seen so far are known to be in the index.
+
+  Thread safe, written by one scanning thread and read from any thread.
+ */
+class FrameIndex {
+public:
+  explicit FrameIndex(size_t nStreams);
+  FrameIndex(const FrameIndex &) = delete;
+  FrameIndex &operator=(const FrameIndex &) = delete;
+
+  // dtsTime is the dts of the packet in vivictpp::time units
+  void add(int streamIndex, const IndexEntry &entry, vivictpp::time::Time dtsTime);
+  // Called when the whole input has been scanned
+  void setComplete();
+  bool isComplete();
+  size_t size(int streamIndex);
+  size_t streamCount() const { return streams.size(); }
+  // Copy of all entries of the stream, in pts order
+  std::vector<IndexEntry> entries(int streamIndex);
+
+  // Last keyframe with pts at or before t
+  std::optional<IndexEntry> keyframeBefore(int streamIndex, vivictpp::time::Time t);
+  // Number of frames with pts in [from, to]
+  int framesBetween(int streamIndex, vivictpp::time::Time from, vivictpp::time::Time to);
+  // Pts of the first frame after t, NO_TIME if not known
+  vivictpp::time::Time nextPts(int streamIndex, vivictpp::time::Time t);
+  // Pts of the last frame before t, NO_TIME if not known
+  vivictpp::time::Time previousPts(int streamIndex, vivictpp::time::Time t);
+
+private:
+  struct StreamIndex {
+    std::vector<IndexEntry> entries;
+    vivictpp::time::Time scannedUntil{vivictpp::time::NO_TIME};
+  };
+  bool covers(const StreamIndex &stream, vivictpp::time::Time t) const;
+  StreamIndex *streamIndex(int streamIndex);
+
+private:
+  std::mutex mutex;
+  std::vector<StreamIndex> streams;
+  bool complete{false};
+};
+
+}  // namespace vivictpp::libav
+
+#endif // LIBAV_FRAMEINDEX_HH
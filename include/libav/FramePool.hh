@@ -0,0 +1,52 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef LIBAV_FRAMEPOOL_HH
+#define LIBAV_FRAMEPOOL_HH
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#include "libav/Frame.hh"
+
+namespace vivictpp {
+namespace libav {
+
+/*
+  Recycles AVFrames for a decoder. When the last Frame handle referring to a
+  pooled AVFrame is released, the AVFrame is unreferenced and put back in the
+  pool. Unreferencing returns the picture buffers to the buffer pools of the
+  codec context or filter graph that allocated them, which are sized from the
+  resolution and pixel format of the stream.
+
+  Frames may be released from any thread.
+ */
+class FramePool: public std::enable_shared_from_this<FramePool> {
+public:
+  static std::shared_ptr<FramePool> create(size_t maxIdleFrames = 64);
+  ~FramePool();
+  FramePool(const FramePool &) = delete;
+  FramePool &operator=(const FramePool &) = delete;
+
+  Frame get();
+  size_t idleFrames();
+private:
+  explicit FramePool(size_t maxIdleFrames);
+  void recycle(AVFrame *avFrame);
+private:
+  const size_t maxIdleFrames;
+  std::mutex mutex;
+  std::vector<AVFrame*> idle;
+};
+
+}  // namespace libav
+}  // namespace vivictpp
+
+#endif // LIBAV_FRAMEPOOL_HH
@@ -0,0 +1,118 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef LIBAV_INPUTCACHE_HH
+#define LIBAV_INPUTCACHE_HH
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+#include "libav/FrameIndex.hh"
+#include "libav/ThumbnailCache.hh"
+#include "logging/Logging.hh"
+
+namespace vivictpp::libav {
+
+/*
+  On-disk cache of what is slow to find out about an input: the stream
+  parameters found by avformat_find_stream_info, the duration, and the
+  complete frame index. Entries are stored in the user cache directory,
+  one file per input, with the thumbnails of each video stream in files of
+  their own next to it, and are only used if the path, size and modification
+  time of the input are unchanged. Inputs that are not local files, e.g.
+  urls, are never cached.
+ */
+class InputCache {
+public:
+  // Must be called before any input is opened
+  static void setEnabled(bool enabled);
+
+  explicit InputCache(const std::string &inputFile);
+  // Sets the stream parameters that avformat_find_stream_info would have
+  // found. Returns false, leaving the streams untouched, if there is no
+  // valid cache entry.
+  bool restoreStreamInfo(AVFormatContext *formatContext);
+  // Returns false if there is no valid cache entry
+  bool restoreFrameIndex(FrameIndex &frameIndex);
+  // Stores the stream parameters and the frame index, which must be complete
+  void save(AVFormatContext *formatContext, FrameIndex &frameIndex);
+  // Fills all slots of thumbnails, if there is a cache entry for the stream
+  // made with the same start time and interval. Returns false otherwise.
+  bool restoreThumbnails(int streamIndex, ThumbnailCache &thumbnails);
+  void saveThumbnails(int streamIndex, ThumbnailCache &thumbnails);
+
+private:
+  // Written to the cache file as is
+  struct StreamParams {
+    int codecType;
+    int codecId;
+    int format;
+    int width;
+    int height;
+    int sampleRate;
+    int channels;
+    uint64_t channelMask;
+    int frameSize;
+    int64_t bitRate;
+    int profile;
+    int level;
+    AVRational sampleAspectRatio;
+    AVRational timeBase;
+    AVRational rFrameRate;
+    AVRational avgFrameRate;
+    int64_t startTime;
+    int64_t duration;
+    int64_t nbFrames;
+    uint32_t codecTag;
+    int bitsPerCodedSample;
+    int bitsPerRawSample;
+    int blockAlign;
+    int videoDelay;
+    int fieldOrder;
+    int colorRange;
+    int colorPrimaries;
+    int colorTrc;
+    int colorSpace;
+    int chromaLocation;
+  };
+  struct CachedStream {
+    StreamParams params;
+    std::vector<uint8_t> extradata;
+  };
+  bool load(bool withIndex);
+  bool matches(AVFormatContext *formatContext) const;
+  // The magic and version, followed by what identifies the input file
+  void writeHeader(std::ostream &out, const char *magic) const;
+  bool readHeader(std::istream &in, const char *magic) const;
+  // Writes to a unique temporary file that replaces file when complete, so
+  // that a concurrent reader never sees a partial entry, and concurrent
+  // writers do not write to the same file
+  bool writeFile(const std::string &file, const std::function<void(std::ostream &)> &writeContent);
+  std::string thumbnailFile(int streamIndex) const;
+
+private:
+  static bool enabled;
+  vivictpp::logging::Logger logger;
+  const std::string inputFile;
+  std::string absolutePath;
+  std::string cacheFile;
+  int64_t fileSize{0};
+  int64_t modificationTime{0};
+  int64_t startTime{AV_NOPTS_VALUE};
+  int64_t duration{AV_NOPTS_VALUE};
+  int64_t bitRate{0};
+  std::vector<CachedStream> streams;
+  std::vector<std::vector<IndexEntry>> index;
+};
+
+}  // namespace vivictpp::libav
+
+#endif // LIBAV_INPUTCACHE_HH
@@ -5,6 +5,7 @@
 #ifndef LIBAV_PACKET_HH
 #define LIBAV_PACKET_HH
 
+#include <cstddef>
 #include <memory>
 
 extern "C" {
@@ -20,8 +21,9 @@ public:
   Packet();
   Packet(AVPacket *pkt);
   ~Packet() = default;
-  AVPacket* avPacket();
-  bool empty() { return !packet; }
+  AVPacket* avPacket() const;
+  bool empty() const { return !packet; }
+  size_t byteSize() const { return packet ? packet->size : 0; }
 private:
   std::shared_ptr<AVPacket> packet;
 };
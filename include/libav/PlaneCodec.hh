@@ -0,0 +1,38 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef LIBAV_PLANECODEC_HH
+#define LIBAV_PLANECODEC_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vivictpp::libav {
+
+/*
+  Fast lossless compression of one plane of a picture, for keeping decoded
+  frames in memory.
+
+  Every byte is predicted from the same byte of the row above, or in the
+  first row from the sample to its left. The prediction residuals of each
+  row are bit-packed in blocks of 16, each block with as many bits per
+  residual as its largest residual needs. Flat areas shrink to a byte per
+  block, and the output is at most one byte per block larger than the
+  input with the rows padded to whole blocks.
+
+  sampleBytes is the distance in bytes between the samples of a component,
+  e.g. 2 for 16-bit samples and interleaved chroma, only used for the
+  first row.
+ */
+std::vector<uint8_t> compressPlane(const uint8_t *data, int linesize, int rowBytes, int rows,
+                                   int sampleBytes);
+
+// Returns false if compressed is not a plane of the given size
+bool decompressPlane(const std::vector<uint8_t> &compressed, uint8_t *data, int linesize,
+                     int rowBytes, int rows, int sampleBytes);
+
+}  // namespace vivictpp::libav
+
+#endif // LIBAV_PLANECODEC_HH
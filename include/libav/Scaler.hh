@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef LIBAV_SCALER_HH
+#define LIBAV_SCALER_HH
+
+extern "C" {
+#include <libswscale/swscale.h>
+}
+
+#include "libav/Frame.hh"
+
+namespace vivictpp {
+namespace libav {
+
+/*
+  Scales video frames with libswscale, which has SIMD implementations of its
+  scaling kernels for the common platforms. The scaling context is cached and
+  only recreated when the input or output format changes.
+ */
+class Scaler {
+public:
+  Scaler() = default;
+  ~Scaler();
+  Scaler(const Scaler &) = delete;
+  Scaler &operator=(const Scaler &) = delete;
+  // Returns a new frame with the picture of frame scaled to width x height,
+  // in the same pixel format and with the same properties
+  Frame scale(const Frame &frame, int width, int height);
+  // As above, but converting the picture to format
+  Frame scale(const Frame &frame, int width, int height, AVPixelFormat format);
+private:
+  SwsContext *swsContext{nullptr};
+};
+
+}  // namespace libav
+}  // namespace vivictpp
+
+#endif // LIBAV_SCALER_HH
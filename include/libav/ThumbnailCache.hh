@@ -0,0 +1,66 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef LIBAV_THUMBNAILCACHE_HH
+#define LIBAV_THUMBNAILCACHE_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "time/Time.hh"
+
+namespace vivictpp::libav {
+
+struct Thumbnail {
+  // Presentation time of the keyframe the thumbnail was made from
+  vivictpp::time::Time pts;
+  int width;
+  int height;
+  // The Y, U and V planes of a yuv420p picture, packed without padding
+  std::vector<uint8_t> data;
+};
+
+/*
+  Thumbnails of one video stream, one for every interval of the stream
+  starting at startTime. The thumbnail of a slot is made from the keyframe
+  at or before the start of the slot. Slots may be filled in any order, a
+  lookup answers with the closest filled slot at or before the one asked
+  for.
+
+  Thread safe, written by a ThumbnailWorker and read from the ui thread.
+ */
+class ThumbnailCache {
+public:
+  ThumbnailCache(vivictpp::time::Time startTime, vivictpp::time::Time duration,
+                 vivictpp::time::Time interval);
+  ThumbnailCache(const ThumbnailCache &) = delete;
+  ThumbnailCache &operator=(const ThumbnailCache &) = delete;
+
+  vivictpp::time::Time getStartTime() const { return startTime; }
+  vivictpp::time::Time getInterval() const { return interval; }
+  size_t slotCount() const { return slotTotal; }
+  vivictpp::time::Time slotTime(size_t slot) const { return startTime + slot * interval; }
+  void set(size_t slot, std::shared_ptr<const Thumbnail> thumbnail);
+  bool has(size_t slot);
+  // Null if no slot at or before the one of t is filled yet
+  std::shared_ptr<const Thumbnail> at(vivictpp::time::Time t);
+  // Copy of all slots, empty slots are null
+  std::vector<std::shared_ptr<const Thumbnail>> thumbnails();
+  size_t byteSize();
+
+private:
+  const vivictpp::time::Time startTime;
+  const vivictpp::time::Time interval;
+  const size_t slotTotal;
+  std::mutex mutex;
+  std::vector<std::shared_ptr<const Thumbnail>> slots;
+  size_t bytes{0};
+};
+
+}  // namespace vivictpp::libav
+
+#endif // LIBAV_THUMBNAILCACHE_HH
@@ -63,6 +63,13 @@ public:
   void displayFrame(const vivictpp::ui::DisplayState &displayState) override {
     screenOutput.displayFrame(displayState);
   }
+  void displaySplash(const std::string &status) override {
+    screenOutput.renderSplash(status);
+  }
+  // Keeps the window responsive and shows the splash screen, with the text
+  // from getStatus, until isDone returns true. Returns false if the window
+  // was closed before that.
+  bool showSplashUntil(std::function<bool()> isDone, std::function<std::string()> getStatus);
   int getWidth() override {
     return screenOutput.getWidth();
   }
@@ -72,6 +79,12 @@ public:
   void setFullscreen(bool fullscreen) override {
     screenOutput.setFullscreen(fullscreen);
   }
+  Resolution getVideoDisplayResolution() override {
+    return screenOutput.getVideoDisplayResolution();
+  }
+  float seekBarHoverPos(int x, int y) override {
+    return screenOutput.seekBarHoverPos(x, y);
+  }
  private:
   void scheduleEvent(const CustomEvent &event, const int delay);
   void scheduleEvent(CustomEvent *event, const int delay);
@@ -38,21 +38,60 @@ class SDLInitializer {
 //typedef std::shared_ptr<SDL_Texture, std::function<void(SDL_Texture *)>> TexturePtr;
 typedef std::shared_ptr<SDL_Texture> TexturePtr;
 
+/*
+  A streaming texture for decoded frames. The texture keeps a reference to the
+  frame it was last updated with, and the region of that frame that has been
+  uploaded, so that updating it again with the same frame only uploads the
+  parts of the region that were not uploaded before. Holding the reference
+  also keeps the AVFrame from being recycled by a FramePool, so comparing the
+  AVFrame pointers is enough to identify the frame.
+ */
 class SDLTexture {
 public:
   SDLTexture() {}
   SDLTexture(SDL_Renderer* renderer, int w, int h, SDL_PixelFormatEnum pixelFormat);
-  void update(const vivictpp::libav::Frame &frame);
+  // Uploads the whole frame, unless it is already uploaded. Returns true if
+  // anything was uploaded.
+  bool update(const vivictpp::libav::Frame &frame);
+  // Uploads the part of region that is not already uploaded from the same
+  // frame. The region is widened to whole chroma samples and clipped to the
+  // texture. Returns true if anything was uploaded.
+  bool update(const vivictpp::libav::Frame &frame, const SDL_Rect &region);
+  // Makes the next update upload its frame, for when the texture contents
+  // have been lost
+  void invalidate() {
+    currentFrame = vivictpp::libav::Frame::emptyFrame();
+    uploadedRect = {0, 0, 0, 0};
+  }
+  int getWidth() const { return width; }
+  int getHeight() const { return height; }
+  SDL_PixelFormatEnum getPixelFormat() const { return pixelFormat; }
+  // True if frame is the frame the texture was last updated with
+  bool holds(const vivictpp::libav::Frame &frame) const {
+    return !frame.empty() && frame.avFrame() == currentFrame.avFrame();
+  }
+  // False if the texture has not been updated since it was invalidated
+  bool holdsFrame() const { return !currentFrame.empty(); }
   bool operator!() const { return !texturePtr; }
   TexturePtr &operator->() { return texturePtr; }
   SDL_Texture *get() { return texturePtr.get(); }
 
 private:
-  TexturePtr texturePtr;
-  SDL_PixelFormatEnum pixelFormat;
+  void uploadRect(const vivictpp::libav::Frame &frame, const SDL_Rect &rect);
 
+private:
+  TexturePtr texturePtr;
+  SDL_PixelFormatEnum pixelFormat{SDL_PIXELFORMAT_YV12};
+  int width{0};
+  int height{0};
+  vivictpp::libav::Frame currentFrame{vivictpp::libav::Frame::emptyFrame()};
+  SDL_Rect uploadedRect{0, 0, 0, 0};
 };
 
+// The texture format for uploading frame, NV12 frames are uploaded as they
+// are, other frames are YUV 4:2:0
+SDL_PixelFormatEnum texturePixelFormat(const vivictpp::libav::Frame &frame);
+
 std::unique_ptr<SDL_Window, std::function<void(SDL_Window *)>>
   createWindow(int width, int height);
 
@@ -68,6 +107,11 @@ std::unique_ptr<SDL_Cursor, std::function<void(SDL_Cursor *)>>
 std::unique_ptr<SDL_Cursor, std::function<void(SDL_Cursor *)>>
   createPanCursor();
 
+// If thread placement is enabled, moves the calling thread to the
+// presentation core and raises its priority, see ThreadPlacement. Running
+// with normal priority if that is not permitted.
+void placePresentationThread();
+
 }  // sdl
 }  // vivictpp
 
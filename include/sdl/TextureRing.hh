@@ -0,0 +1,54 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef SDL_TEXTURERING_HH
+#define SDL_TEXTURERING_HH
+
+extern "C" {
+#include <SDL.h>
+}
+
+#include <cstdint>
+#include <vector>
+
+#include "sdl/SDLUtils.hh"
+#include "libav/Frame.hh"
+
+namespace vivictpp {
+namespace sdl {
+
+/*
+  A small set of textures for the frames of one input. Besides the texture
+  of the frame shown, textures of the frames around it can be uploaded ahead
+  of time, so that stepping to one of them only needs the textures to be
+  composited again. Textures released by retain are reused first, then
+  textures in least recently used order. Textures are created or resized to
+  fit the frames given.
+ */
+class TextureRing {
+public:
+  explicit TextureRing(size_t size = 1): entries(size) {}
+  // The texture holding frame, or else a released or the least recently used
+  // texture, fitted to the size and format of frame. The caller updates it
+  // with frame.
+  SDLTexture &get(SDL_Renderer *renderer, const vivictpp::libav::Frame &frame);
+  bool contains(const vivictpp::libav::Frame &frame) const;
+  // Releases the frames held by textures, other than the given frames
+  void retain(const std::vector<vivictpp::libav::Frame> &frames);
+  void invalidate();
+  void clear();
+
+private:
+  struct Entry {
+    SDLTexture texture;
+    uint64_t lastUse{0};
+  };
+  std::vector<Entry> entries;
+  uint64_t useCount{0};
+};
+
+}  // namespace sdl
+}  // namespace vivictpp
+
+#endif // SDL_TEXTURERING_HH
@@ -9,10 +9,13 @@
 #include <string>
 #include <cmath>
 #include <iostream>
+#include <memory>
+#include <vector>
 
 #include "VideoMetadata.hh"
 #include "time/Time.hh"
 #include "libav/Frame.hh"
+#include "libav/ThumbnailCache.hh"
 
 namespace vivictpp {
 namespace ui {
@@ -49,8 +52,17 @@ struct SeekBarState {
   float relativePos{0};
   float relativeSeekPos{0};
   bool seeking{false};
+  // Position of the mouse along the seek bar while hovering over it,
+  // negative otherwise
+  float relativeHoverPos{-1};
+  std::shared_ptr<const vivictpp::libav::Thumbnail> leftThumbnail;
+  std::shared_ptr<const vivictpp::libav::Thumbnail> rightThumbnail;
 };
 
+// Frames on either side of the shown frame that are uploaded ahead while
+// playback is stopped
+constexpr int NEIGHBOUR_FRAMES = 2;
+
 struct DisplayState {
   float splitPercent{50};
   //  int zoom{0};
@@ -70,6 +82,9 @@ struct DisplayState {
   int leftFrameOffset{0};
   vivictpp::libav::Frame leftFrame;
   vivictpp::libav::Frame rightFrame;
+  // Nearest first, empty during playback
+  std::vector<vivictpp::libav::Frame> leftNeighbourFrames;
+  std::vector<vivictpp::libav::Frame> rightNeighbourFrames;
   VideoMetadata leftVideoMetadata;
   VideoMetadata rightVideoMetadata;
   int videoMetadataVersion{0};
@@ -46,9 +46,18 @@ public:
   ScreenOutput& operator=(const ScreenOutput&) = delete;
   virtual ~ScreenOutput();
   void displayFrame(const vivictpp::ui::DisplayState &displayState);
+  // Frames around the shown frame are uploaded ahead, one at a time, while
+  // there are no events to handle
+  bool hasIdleUploads() const { return videoDisplay.hasNeighbourFramesToUpload(); }
+  void uploadIdle() { videoDisplay.uploadNeighbourFrame(renderer.get()); }
+  // Logo, with a status text below it if not empty
+  void renderSplash(const std::string &status = "");
   int getWidth() { return width; }
   int getHeight() { return height; }
+  Resolution getVideoDisplayResolution() { return videoDisplay.getDisplayResolution(); }
+  float seekBarHoverPos(int x, int y) { return seekBar.hoverPos(x, y); }
   void onResize();
+  void onRenderTargetsReset();
   void setFullscreen(bool fullscreen);
   void setCursorHand();
   void setCursorPan();
@@ -85,7 +94,6 @@ private:
   Resolution getTargetResolution(const VideoMetadata &leftVideoMetadata,
                                  const VideoMetadata &rightVideoMetadata);
   void initialize(const DisplayState &displayState);
-  void renderSplash();
   void setSize(Resolution targetResolution);
   void initText();
   void drawTime(const vivictpp::ui::DisplayState &displayState);
@@ -7,6 +7,7 @@
 
 #include "ui/DisplayState.hh"
 #include "ui/Ui.hh"
+#include "sdl/SDLUtils.hh"
 
 namespace vivictpp {
 namespace ui {
@@ -22,8 +23,26 @@ public:
   void setState(const SeekBarState &state) {
     this->state = state;
   }
+  // Relative position of x along the bar if x, y is on or near the bar,
+  // negative otherwise
+  float hoverPos(int x, int y) const;
 private:
+  // Uploaded when the hovered thumbnail changes
+  struct ThumbnailTexture {
+    std::shared_ptr<const vivictpp::libav::Thumbnail> thumbnail;
+    vivictpp::sdl::TexturePtr texture;
+    int width{0};
+    int height{0};
+  };
+  void renderThumbnails(SDL_Renderer *renderer, int width);
+  void renderThumbnail(SDL_Renderer *renderer, ThumbnailTexture &texture,
+                       const std::shared_ptr<const vivictpp::libav::Thumbnail> &thumbnail,
+                       int x, int bottom);
+private:
+  static constexpr int HOVER_MARGIN = 8;
   SeekBarState state;
+  ThumbnailTexture leftThumbnail;
+  ThumbnailTexture rightThumbnail;
   Margin margin;
   Box box{0,0,0,0};
   int seekBarHeight{8};
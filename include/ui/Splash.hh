@@ -18,10 +18,21 @@ class Splash : public Component {
 public:
   Splash():
     textBox(std::make_shared<TextBox>(SPLASH_TEXT, "FreeMono", 32)),
-    container(Position::CENTER, {textBox}) {
+    statusBox(std::make_shared<TextBox>(" ", "FreeMono", 24)),
+    container(Position::CENTER, {textBox, statusBox}) {
      textBox->bg = {0,0,0,255};
      textBox->border = false;
+     statusBox->bg = {0,0,0,255};
+     statusBox->border = false;
+     statusBox->display = false;
   };
+  // Progress text shown below the logo, hidden if empty
+  void setStatus(const std::string &status) {
+    statusBox->display = !status.empty();
+    if (!status.empty()) {
+      statusBox->setText(status);
+    }
+  }
   void render(const DisplayState &displayState, SDL_Renderer *renderer, int x, int y) {
     container.render(displayState, renderer, x, y);
   };
@@ -31,6 +42,7 @@ public:
 
 private:
   std::shared_ptr<TextBox> textBox;
+  std::shared_ptr<TextBox> statusBox;
   FixedPositionContainer container;
 };
 
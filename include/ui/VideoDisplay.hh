@@ -12,8 +12,12 @@ extern "C" {
 
 #include "ui/Ui.hh"
 #include "sdl/SDLUtils.hh"
+#include "sdl/TextureRing.hh"
 #include "logging/Logging.hh"
 
+#include <deque>
+#include <vector>
+
 namespace vivictpp::ui {
 
 class VideoDisplay : public Component {
@@ -22,24 +26,53 @@ public:
   ~VideoDisplay() = default;
   void render(const DisplayState &displayState, SDL_Renderer *renderer, int x, int y) override;
   void update(const DisplayState &displayState);
+  // Makes the next render upload the frames again, for when the renderer
+  // has lost the texture contents
+  void invalidateTextures();
+  // Queues the neighbour frames of the display state for upload to textures
+  // of their own, so that stepping to them does not have to wait for an
+  // upload. Called after the frame has been presented, the frames are
+  // uploaded one at a time by uploadNeighbourFrame when the event loop is idle.
+  void queueNeighbourFrames(const DisplayState &displayState);
+  bool hasNeighbourFramesToUpload() const { return !neighbourUploads.empty(); }
+  void uploadNeighbourFrame(SDL_Renderer *renderer);
   const Box& getBox() const override {
     return box;
   }
+  // The size the video was last drawn at if the whole frame was visible,
+  // empty if the frames were cropped
+  Resolution getDisplayResolution() const { return displayResolution; }
 private:
-  void initTextures(SDL_Renderer *renderer, const DisplayState &displayState);
+  struct NeighbourUpload {
+    vivictpp::sdl::TextureRing *textures;
+    vivictpp::libav::Frame frame;
+    SDL_Rect sourceRect;
+    Resolution resolution;
+    SDL_Rect visibleDestRect;
+  };
+  void initTextures(const DisplayState &displayState);
+  std::vector<NeighbourUpload> neighbourUploadsFor(vivictpp::sdl::TextureRing &textures,
+                                                   const vivictpp::libav::Frame &frame,
+                                                   const std::vector<vivictpp::libav::Frame> &neighbours,
+                                                   const SDL_Rect &sourceRect,
+                                                   const Resolution &resolution,
+                                                   const SDL_Rect &visibleDestRect);
   void calcZoomedSrcRect(const vivictpp::ui::DisplayState &displayState,
                          const Resolution &scaledResolution,
                          const VideoMetadata &videoMetadata,
                          SDL_Rect &rect);
   void setDefaultSourceRectangles(const DisplayState &displayState);
   void updateRectangles(const DisplayState &displayState, SDL_Renderer *renderer);
+  SDL_Rect visibleSourceRect(const SDL_Rect &sourceRect, int destFrom, int destTo) const;
 private:
-  vivictpp::sdl::SDLTexture leftTexture;
-  vivictpp::sdl::SDLTexture rightTexture;
+  vivictpp::sdl::TextureRing leftTextures;
+  vivictpp::sdl::TextureRing rightTextures;
+  std::deque<NeighbourUpload> neighbourUploads;
   SDL_Rect sourceRectLeft, sourceRectRight, zoomedView, destRectLeft, destRectRight, destRect;
   Box box;
   vivictpp::logging::Logger logger;
   Resolution targetResolution;
+  Resolution displayResolution;
   int videoMetadataVersion{-1};
 };
 
@@ -7,6 +7,7 @@
 
 #include "libav/Frame.hh"
 #include "VideoMetadata.hh"
+#include "Resolution.hh"
 #include "EventLoop.hh"
 #include "ui/DisplayState.hh"
 #include <string>
@@ -45,9 +46,17 @@ class Display {
 public:
   virtual ~Display() = default;
   virtual void displayFrame(const vivictpp::ui::DisplayState &displayState) = 0;
+  // Shown until the first frames are available
+  virtual void displaySplash(const std::string &status) = 0;
   virtual int getWidth() = 0;
   virtual int getHeight() = 0;
   virtual void setFullscreen(bool fullscreen) = 0;
+  // The resolution the video was last displayed at, if the whole frame was
+  // visible. Empty if the frames were cropped by zooming.
+  virtual Resolution getVideoDisplayResolution() = 0;
+  // Relative position along the seek bar of the mouse at x, y, negative if
+  // the mouse is not over the seek bar
+  virtual float seekBarHoverPos(int x, int y) = 0;
 //  void setCursorHand();
 //  void setCursorDefault();
 };
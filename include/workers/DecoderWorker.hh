@@ -6,7 +6,11 @@
 #define WORKERS_DECODERWORKER_HH
 
 #include "workers/InputWorker.hh"
+#include "workers/FilterWorker.hh"
+#include "workers/GopDecoder.hh"
+#include "workers/MemoryBudget.hh"
 #include "workers/PacketQueue.hh"
+#include "workers/StageTimer.hh"
 #include "libav/FormatHandler.hh"
 #include "libav/Filter.hh"
 #include "workers/FrameBuffer.hh"
@@ -18,53 +22,96 @@
 #include <queue>
 #include <atomic>
 #include <string>
+#include <vector>
 #include "spdlog/spdlog.h"
 
 
 namespace vivictpp {
 namespace workers {
 
+/*
+  First stage of the decoding pipeline. Decodes packets and passes the
+  decoded frames on to a FilterWorker, which filters them and writes them
+  to the frame buffer.
+
+  The packet queue and the frame buffer are sized by the MemoryBudget,
+  frameBufferSize and packetQueueSize are upper limits.
+
+  When seeking, video packets from the keyframe up to what would fit in the
+  frame buffer before the seek position are decoded in pre-roll mode, where
+  non-reference frames are skipped. The frames that are still decoded there
+  are dropped by the FilterWorker without being filtered.
+
+  With more than one GOP decoder in the decoder options, video is decoded in
+  GOP-parallel mode. Packets are split into GOPs at keyframes, the GOPs are
+  decoded by GopDecoders, and the decoded frames are passed on to the
+  FilterWorker GOP by GOP, in the order the GOPs were read. The decoded frames
+  of the GOPs in flight are kept within a memory budget account of their own.
+  Pre-roll is not used in this mode.
+ */
 class DecoderWorker : public InputWorker<vivictpp::libav::Packet> {
 public:
   DecoderWorker(AVStream *stream,
                 std::string customFilter = "",
                 vivictpp::libav::DecoderOptions decoderOptions = {},
-                int frameBufferSize = 50,
-                int packetQueueSize = 256);
+                int frameBufferSize = 128,
+                int packetQueueSize = 256,
+                int filterQueueSize = 4);
   virtual ~DecoderWorker();
-  void seek(vivictpp::time::Time pos, vivictpp::SeekCallback callback);
+  // Packets are dropped undecoded once token is obsolete, until the next seek
+  void seek(vivictpp::time::Time pos, vivictpp::SeekCallback callback,
+            vivictpp::SeekToken token = vivictpp::SeekToken());
   AVStream *getStream() { return stream; };
   AVCodecContext *getCodecContext() { return decoder->getCodecContext(); }
-  FrameBuffer &frames() { return frameBuffer; }
+  FrameBuffer &frames() { return filterWorker->frames(); }
+  int urgency() override { return filterWorker->urgency(); }
   FilteredVideoMetadata getFilteredVideoMetadata() {
-    std::shared_ptr<vivictpp::libav::VideoFilter> videoFilter = std::dynamic_pointer_cast<vivictpp::libav::VideoFilter>(filter);
-    if (videoFilter) {
-      return videoFilter->getFilteredVideoMetadata();
-    }
-    return FilteredVideoMetadata();
+    return filterWorker->getFilteredVideoMetadata();
+  }
+  const StageTimer &getDecodeTimer() const { return timer; }
+  const StageTimer &getFilterTimer() const { return filterWorker->getTimer(); }
+  void setDownscaleResolution(Resolution resolution) {
+    filterWorker->setDownscaleResolution(resolution);
   }
 public:
   const int streamIndex;
 private:
-    bool filterData(const vivictpp::workers::Data<vivictpp::libav::Packet> &data) override {
-    return data.data->avPacket()->stream_index == streamIndex;
-  };
   bool onData(const vivictpp::workers::Data<vivictpp::libav::Packet> &data) override;
-  void doWork() override;
-  void dropFrameIfSeekingAndBufferFull();
-  bool seeking() { return state == InputWorkerState::SEEKING; }
-  void addFrameToBuffer(const vivictpp::libav::Frame &frame);
+  bool doWork() override;
+  bool inPreroll(const vivictpp::libav::Packet &packet);
+  vivictpp::time::Time prerollEndFor(vivictpp::time::Time seekPos);
+  bool gopParallel() { return !gopDecoders.empty(); }
+  bool onGopData(const vivictpp::libav::Packet &packet);
+  bool dispatchGop();
+  void onGopDecoded(const Gop &gop);
+  bool takeDecodedGop();
+  void resetGops();
 
 private:
   AVStream *stream;
-  FrameBuffer frameBuffer;
-
   std::shared_ptr<vivictpp::libav::Decoder> decoder;
-  std::shared_ptr<vivictpp::libav::Filter> filter;
+  std::unique_ptr<FilterWorker> filterWorker;
+  // Decoded frames waiting for room in the filter queue
   std::queue<vivictpp::libav::Frame> frameQueue;
-  vivictpp::time::Time seekPos;
-  vivictpp::time::Time lastSeenPts;
-  vivictpp::SeekCallback seekCallback;
+  StageTimer timer;
+  std::unique_ptr<MemoryBudget::Account> packetAccount;
+  // Packets before this are decoded in pre-roll mode, NO_TIME if none
+  vivictpp::time::Time prerollEnd{vivictpp::time::NO_TIME};
+  bool preroll{false};
+  vivictpp::SeekToken seekToken;
+  vivictpp::SeekCallbackSlots seekCallbacks;
+  // GOP-parallel mode, empty if not used
+  std::vector<std::unique_ptr<GopDecoder>> gopDecoders;
+  Gop currentGop;
+  uint64_t nextGopSequenceNo{0};
+  size_t nextGopDecoder{0};
+  DecodedGops decodedGops;
+  // Decoded size of the last GOP taken, the expected size of the GOPs that
+  // are still being decoded
+  size_t lastGopBytes{0};
+  std::atomic<size_t> gopByteLimit{0};
+  std::unique_ptr<MemoryBudget::Account> gopAccount;
+  bool openGopWarned{false};
 
 };
 }  // namespace workers
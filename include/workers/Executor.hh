@@ -0,0 +1,92 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef WORKERS_EXECUTOR_HH
+#define WORKERS_EXECUTOR_HH
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "workers/Parker.hh"
+#include "logging/Logging.hh"
+
+namespace vivictpp {
+namespace workers {
+
+class Task {
+public:
+  virtual ~Task() = default;
+  virtual void run() = 0;
+  // Tasks with higher priority run first. Called from any executor thread
+  // while the task is queued, so it must be thread safe.
+  virtual double priority() = 0;
+};
+
+/*
+  Process-wide thread pool running the demux, decode and filter work of all
+  inputs.
+
+  Each thread has its own queue. Tasks submitted from an executor thread are
+  put in that thread's queue, other tasks are spread over the queues. A thread
+  takes the task with highest priority from its own queue, and steals from the
+  other queues when its own queue is empty. Priorities are evaluated when a
+  task is taken, so they reflect the current state of the frame buffers.
+
+  A task must not be submitted again until it has been taken, tasks are
+  expected to keep track of this themselves.
+
+  Work that playback does not wait for, like indexing, thumbnails and the
+  frame history, runs on the background executor instead. Its single thread
+  has the lowest scheduling priority. Background tasks block on opening
+  inputs, seeking and decoding, and priorities only order queued tasks, so
+  on the shared pool they would hold threads the playback pipeline needs.
+ */
+class Executor {
+public:
+  // Must be called before the first call to instance(), 0 means one thread
+  // per cpu core
+  static void setThreadCount(int threadCount);
+  static Executor &instance();
+  static Executor &background();
+
+  explicit Executor(int threadCount, std::string threadName = "vpp-worker",
+                    bool lowPriority = false);
+  ~Executor();
+  Executor(const Executor &) = delete;
+  Executor &operator=(const Executor &) = delete;
+
+  void submit(Task *task);
+  int getThreadCount() const { return static_cast<int>(threads.size()); }
+
+private:
+  struct WorkQueue {
+    std::mutex mutex;
+    std::vector<Task*> tasks;
+  };
+  void run(size_t index);
+  Task *take(size_t index);
+  static Task *takeHighestPriority(WorkQueue &queue);
+
+private:
+  static int configuredThreadCount;
+  vivictpp::logging::Logger logger;
+  const std::string threadName;
+  const bool lowPriority;
+  std::vector<std::unique_ptr<WorkQueue>> queues;
+  std::vector<std::thread> threads;
+  std::atomic<int> pending{0};
+  std::atomic<bool> running{true};
+  std::atomic<size_t> nextQueue{0};
+  Parker workAvailable;
+};
+
+}  // namespace workers
+}  // namespace vivictpp
+
+#endif // WORKERS_EXECUTOR_HH
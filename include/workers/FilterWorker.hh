@@ -0,0 +1,93 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef WORKERS_FILTERWORKER_HH
+#define WORKERS_FILTERWORKER_HH
+
+#include "workers/InputWorker.hh"
+#include "workers/FrameBuffer.hh"
+#include "workers/MemoryBudget.hh"
+#include "workers/StageTimer.hh"
+#include "libav/Filter.hh"
+#include "libav/Frame.hh"
+#include "libav/Scaler.hh"
+#include "Resolution.hh"
+#include "time/Time.hh"
+#include "Seeking.hh"
+
+#include <memory>
+#include <queue>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+namespace vivictpp {
+namespace workers {
+
+/*
+  Second stage of the decoding pipeline. Receives decoded frames from a
+  DecoderWorker, runs them through the filter graph and writes the filtered
+  frames to the frame buffer. Running as its own task lets filtering of one
+  frame overlap with decoding of the next.
+
+  The depth of the frame buffer is set by the MemoryBudget, frameBufferSize
+  is the maximum depth.
+
+  Video frames can be downscaled after filtering, to the resolution they are
+  shown at, so that the display does not have to upload and scale full
+  resolution frames. Frames are never upscaled.
+ */
+class FilterWorker : public InputWorker<vivictpp::libav::Frame> {
+public:
+  FilterWorker(AVStream *stream,
+               std::shared_ptr<vivictpp::libav::Filter> filter,
+               int frameBufferSize,
+               int frameQueueSize);
+  virtual ~FilterWorker();
+  // Frames before prerollEnd are dropped unfiltered while seeking, as are
+  // all frames once token is obsolete
+  void seek(vivictpp::time::Time pos, vivictpp::SeekCallback callback,
+            vivictpp::time::Time prerollEnd = vivictpp::time::NO_TIME,
+            vivictpp::SeekToken token = vivictpp::SeekToken());
+  FrameBuffer &frames() { return frameBuffer; }
+  int urgency() override;
+  const StageTimer &getTimer() const { return timer; }
+  FilteredVideoMetadata getFilteredVideoMetadata();
+  // Frames filtered after this are downscaled to fit resolution, an empty
+  // resolution turns downscaling off
+  void setDownscaleResolution(Resolution resolution);
+private:
+  bool onData(const vivictpp::workers::Data<vivictpp::libav::Frame> &data) override;
+  bool doWork() override;
+  void dropFrameIfSeekingAndBufferFull();
+  bool seeking() { return state == InputWorkerState::SEEKING; }
+  void addFrameToBuffer(const vivictpp::libav::Frame &frame);
+  bool skipPrerollFrame(const vivictpp::libav::Frame &frame);
+  vivictpp::libav::Frame downscale(const vivictpp::libav::Frame &frame);
+
+private:
+  AVStream *stream;
+  FrameBuffer frameBuffer;
+  std::shared_ptr<vivictpp::libav::Filter> filter;
+  // Filtered frames waiting for room in the frame buffer
+  std::queue<vivictpp::libav::Frame> frameQueue;
+  vivictpp::time::Time seekPos;
+  vivictpp::time::Time prerollEnd;
+  int prerollFramesSkipped{0};
+  vivictpp::time::Time lastSeenPts;
+  vivictpp::SeekCallback seekCallback;
+  vivictpp::SeekToken seekToken;
+  vivictpp::SeekCallbackSlots seekCallbacks;
+  StageTimer timer;
+  Resolution downscaleResolution;
+  vivictpp::libav::Scaler scaler;
+  // Declared last, so that it is closed before the frame buffer is destroyed
+  std::unique_ptr<MemoryBudget::Account> memoryAccount;
+};
+
+}  // namespace workers
+}  // namespace vivictpp
+
+#endif // WORKERS_FILTERWORKER_HH
@@ -13,14 +13,16 @@ extern "C" {
 #include <unistd.h>
 }
 
-#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <limits>
-#include <mutex>
+#include <memory>
 #include <vector>
-#include <condition_variable>
-#include <chrono>
 
-#include "workers/QueuePointer.hh"
+#include "workers/Parker.hh"
+#include "workers/WakeupSignal.hh"
 #include "libav/Frame.hh"
 #include "logging/Logging.hh"
 #include "time/Time.hh"
@@ -29,61 +31,130 @@ namespace vivictpp {
 namespace workers {
 
 /*
-  Circular buffer for storing decoded frames. Stores index to the head and tail
- position, as well as the current read index. If the read index gets too close
-to the head, size is decreased to make room for new frames. Pts for each frame
-is stored in a separate array.
+  Lock-free circular buffer for storing decoded frames.
 
-It is assumed that there is only a single reader thread and a single writer thread.
+  There is exactly one writer thread (the DecoderWorker) and one reader thread
+  (the main/event thread). Head, tail and cursor are monotonically increasing
+  indices, the slot of an index is found by masking with the power of two
+  capacity. Pts for each frame is stored in a separate contiguous array that
+  the reader can search without taking any lock.
 
-A mutex is used to ensure consistency
+  The writer owns the head and the frame slots. Both threads may advance the
+  tail (drop frames), and the reader owns the cursor. A cursor that has been
+  passed by the tail is treated as pointing at the tail. While the reader
+  copies the frame at the cursor, the index is published in readerPin so that
+  the writer never overwrites or releases that slot.
 
- */
+  When the buffer is full and the cursor gets too close to the head, the
+  writer drops frames behind the cursor to make room for new frames. How
+  many frames it keeps ahead can be raised, up to half the maximum size, so
+  that stepping forward finds frames already decoded. If a
+  space signal is given, it is notified when the reader frees space in a full
+  buffer, so that the writer can sleep instead of polling makeRoom().
 
+  The maximum size can be changed at any time, up to the capacity given at
+  construction. After it has been lowered the writer drops frames behind the
+  cursor until the buffer fits again. The bytes of the frames between tail
+  and head are tracked for memory accounting.
 
+  A drop listener, if set, is handed every dropped frame on the writer
+  thread when its slot is released, in pts order, so that the frames can be
+  kept elsewhere. Frames removed by clear() are not handed out.
+ */
 class FrameBuffer {
 public:
-  FrameBuffer(int _maxSize);
+  // Called with a dropped frame, its pts and the pts of the frame after it,
+  // NO_TIME if that frame is not written yet
+  typedef std::function<void(const vivictpp::libav::Frame &frame, vivictpp::time::Time pts,
+                             vivictpp::time::Time nextPts)> DropListener;
+
+  explicit FrameBuffer(int _maxSize, WakeupSignal *spaceSignal = nullptr);
   ~FrameBuffer() = default;
+  FrameBuffer(const FrameBuffer &) = delete;
+  FrameBuffer &operator=(const FrameBuffer &) = delete;
+
+  // Reader side
   vivictpp::libav::Frame first();
-  void write(vivictpp::libav::Frame frame, vivictpp::time::Time pts);
+  // The frame offset frames from the cursor, an empty frame if it is not in
+  // the buffer. Does not wait for frames to be written.
+  vivictpp::libav::Frame frameAt(int offset);
   vivictpp::time::Time nextPts();
   vivictpp::time::Time previousPts();
   int stepForward(vivictpp::time::Time pts);
   void stepBackward(vivictpp::time::Time pts);
-  void drop(int n = 1);
-  void dropIfFull(int n);
-  int size();
   vivictpp::time::Time currentPts();
-  void clear();
   bool ptsInRange(vivictpp::time::Time pts);
   vivictpp::time::Time minPts();
   vivictpp::time::Time maxPts();
-  bool isFull();
+
+  // Writer side
+  void write(vivictpp::libav::Frame frame, vivictpp::time::Time pts);
+  void clear();
+  bool makeRoom();
   bool waitForNotFull(const std::chrono::milliseconds& relTime);
+
+  // Any side
+  void drop(int n = 1);
+  void dropIfFull(int n);
+  int size();
+  int maxSize() const { return static_cast<int>(_maxSize.load()); }
+  int capacity() const { return static_cast<int>(_capacity); }
+  // Clamped to between 1 and the capacity
+  void setMaxSize(int maxSize);
+  // Bytes of the frames in the buffer
+  size_t bytes() const { return _bytes.load(); }
+  // Number of frames from the cursor to the head, including the current frame
+  int framesAhead();
+  // Number of frames from the tail to the cursor, not including the current
+  // frame
+  int framesBehind();
+  // Frames the writer keeps ahead of the cursor before it drops frames
+  // behind it, limited by the maximum size
+  int minFramesAhead();
+  void setMinFramesAhead(int minFramesAhead);
+  // Must be set before the writer starts
+  void setDropListener(DropListener dropListener) { this->dropListener = std::move(dropListener); }
+  bool isFull();
   bool isEmpty();
-  const std::vector<vivictpp::time::Time> &getPtsBuffer() { return ptsBuffer; }
 
 private:
-  bool next();
-  bool previous();
-  QueuePointer tail() { return _writePos - _size; }
-  QueuePointer head() { return _writePos - 1; }
-  void _drop(int n = 1);
+  uint64_t loadCursor();
+  uint64_t minFramesAhead(uint64_t maxSize) const;
+  void releaseDropped();
+  void notifyNotFull();
+  // Called by the thread that moved the tail from begin to end
+  void releaseBytes(uint64_t begin, uint64_t end);
+  vivictpp::time::Time ptsAt(uint64_t index) const {
+    return ptsBuffer[index & _mask].load(std::memory_order_relaxed);
+  }
 
 private:
+  static constexpr uint64_t NOT_PINNED = std::numeric_limits<uint64_t>::max();
+  // Minimum number of frames the writer keeps ahead of the cursor before it
+  // starts dropping frames behind the cursor
+  static constexpr uint64_t MIN_FRAMES_AHEAD = 5;
+
   vivictpp::logging::Logger logger;
+  std::atomic<uint64_t> _maxSize;
+  std::atomic<uint64_t> _minFramesAhead{MIN_FRAMES_AHEAD};
+  const uint64_t _capacity;
+  const uint64_t _mask;
   std::vector<vivictpp::libav::Frame> queue;
-  std::vector<vivictpp::time::Time> ptsBuffer;
-  QueuePointer _writePos; // Points to first empty slot,
-                          // ie one ahead of written value
-  QueuePointer _cursor;
-  int _size;
-  int _maxSize;
-  std::mutex mutex;
-  std::condition_variable conditionVariable;
+  std::unique_ptr<std::atomic<vivictpp::time::Time>[]> ptsBuffer;
+  std::unique_ptr<std::atomic<size_t>[]> sizeBuffer;
+  std::atomic<size_t> _bytes{0};
+  std::atomic<uint64_t> _head{0}; // Points to first empty slot,
+                                  // ie one ahead of written value
+  std::atomic<uint64_t> _tail{0};
+  std::atomic<uint64_t> _cursor{0};
+  std::atomic<uint64_t> readerPin{NOT_PINNED};
+  uint64_t _released{0}; // Writer only, dropped slots below this are released
+  uint64_t _noticeFrom{0}; // Writer only, slots below this are not handed to the drop listener
+  DropListener dropListener;
+  Parker notEmpty;
+  Parker notFull;
+  WakeupSignal *spaceSignal;
 };
 }  // namespace workers
 }  // namespace vivictpp
 #endif // WORKERS_FRAMEBUFFER_HH
-
@@ -0,0 +1,129 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef WORKERS_FRAMEHISTORY_HH
+#define WORKERS_FRAMEHISTORY_HH
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "libav/CompressedFrame.hh"
+#include "libav/Frame.hh"
+#include "time/Time.hh"
+
+namespace vivictpp {
+namespace workers {
+
+/*
+  Decoded frames from right before the first frame of the frame buffer of a
+  video input, so that stepping backwards past the start of the buffer does
+  not need a seek.
+
+  The frames are a contiguous run that ends right before endPts, the pts of
+  the first buffered frame. Frames dropped by the frame buffer are appended,
+  and frames decoded by a HistoryWorker are prepended. Once the frame buffer
+  has dropped a frame that did not reach the history, the run no longer
+  joins up with the buffer, and is not used.
+
+  Frames are kept losslessly compressed, except the few around the position,
+  the frame shown or the end of the history while a buffered frame is shown.
+  Compressing, and decompressing ahead of stepping, is done by the
+  HistoryWorker in compressOne() and warmOne(). The oldest frames are dropped
+  when the bytes held go over the limit.
+
+  Thread safe, filled by a HistoryWorker and the writer of the frame buffer,
+  and read from the main thread. All pts are in the time of the stream,
+  without the offset of the left input.
+ */
+class FrameHistory {
+public:
+  explicit FrameHistory(size_t maxBytes);
+  FrameHistory(const FrameHistory &) = delete;
+  FrameHistory &operator=(const FrameHistory &) = delete;
+
+  // Adds decoded frames, by pts, which must all be before endPts. Replaces
+  // an empty history, and is prepended if endPts is where the history
+  // starts. Otherwise the frames are stale and are not added.
+  void add(std::map<vivictpp::time::Time, vivictpp::libav::Frame> frames,
+           vivictpp::time::Time endPts);
+  // Appends a frame dropped by the frame buffer. Starts over from the frame
+  // if it is not the one the history ends before.
+  void append(const vivictpp::libav::Frame &frame, vivictpp::time::Time pts,
+              vivictpp::time::Time nextPts);
+  void clear();
+  // Frames are dropped from the start when lowered
+  void setMaxBytes(size_t maxBytes);
+  // The pts of the frame shown, NO_TIME while a buffered frame is shown
+  void setPosition(vivictpp::time::Time pts);
+  int size();
+  size_t bytes();
+  // True if another frame of the average size would go over the limit
+  bool full();
+  // NO_TIME if empty
+  vivictpp::time::Time endPts();
+  vivictpp::time::Time firstPts();
+  vivictpp::time::Time lastPts();
+  // True if the frames end right before a frame buffer starting at
+  // bufferStart
+  bool joins(vivictpp::time::Time bufferStart);
+  // Number of frames before pts
+  int framesBefore(vivictpp::time::Time pts);
+  // Pts of the first frame at or after pts, NO_TIME if none
+  vivictpp::time::Time ptsAtOrAfter(vivictpp::time::Time pts);
+  // Pts of the last frame at or before pts, NO_TIME if none
+  vivictpp::time::Time ptsAtOrBefore(vivictpp::time::Time pts);
+  vivictpp::time::Time previousPts(vivictpp::time::Time pts);
+  vivictpp::time::Time nextPts(vivictpp::time::Time pts);
+  // The frame with exactly pts, an empty frame if there is none. A frame
+  // that only is kept compressed is decompressed on the calling thread.
+  vivictpp::libav::Frame frame(vivictpp::time::Time pts);
+  // The frames up to distance frames before and after pts that do not need
+  // to be decompressed, nearest first
+  std::vector<vivictpp::libav::Frame> framesAround(vivictpp::time::Time pts, int distance);
+  // Compresses one frame away from the position, returns the bytes the
+  // frame is kept in, or 0 if there was nothing to compress
+  size_t compressOne();
+  // Decompresses one compressed frame near the position, and releases the
+  // decompressed copies no longer near it. Returns false if there was
+  // nothing to do.
+  bool warmOne();
+
+private:
+  struct Entry {
+    // Empty while only the compressed frame is kept
+    vivictpp::libav::Frame frame{vivictpp::libav::Frame::emptyFrame()};
+    std::shared_ptr<const vivictpp::libav::CompressedFrame> compressed;
+    // Set if the format of the frame can not be compressed
+    bool incompressible{false};
+    size_t bytes() const {
+      return frame.byteSize() + (compressed ? compressed->byteSize() : 0);
+    }
+  };
+  typedef std::map<vivictpp::time::Time, Entry> Entries;
+
+  // Whether the entry is within NEAR_POSITION frames of the position
+  bool nearPosition(Entries::const_iterator it);
+  void addEntry(vivictpp::time::Time pts, Entry entry);
+  void eraseEntry(Entries::iterator it);
+  void clearEntries();
+  void dropExcess();
+
+private:
+  // Frames on each side of the position that are kept decompressed
+  static constexpr int NEAR_POSITION = 2;
+  std::mutex mutex;
+  size_t _maxBytes;
+  Entries entries;
+  vivictpp::time::Time _endPts{vivictpp::time::NO_TIME};
+  vivictpp::time::Time position{vivictpp::time::NO_TIME};
+  size_t _bytes{0};
+};
+
+}  // namespace workers
+}  // namespace vivictpp
+
+#endif // WORKERS_FRAMEHISTORY_HH
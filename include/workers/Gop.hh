@@ -0,0 +1,93 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef WORKERS_GOP_HH
+#define WORKERS_GOP_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "libav/Frame.hh"
+#include "libav/Packet.hh"
+
+namespace vivictpp {
+namespace workers {
+
+/*
+  The packets of a group of pictures, from a keyframe up to the next one, and
+  the frames decoded from them. A cheap to copy handle, copies share the same
+  packets and frames.
+ */
+class Gop {
+public:
+  Gop(): Gop(0, 0) {}
+  Gop(uint64_t sequenceNo, uint64_t seekEpoch);
+  uint64_t sequenceNo() const { return state->sequenceNo; }
+  // Incremented by the DecoderWorker on every seek, GOPs from before a seek
+  // are discarded
+  uint64_t seekEpoch() const { return state->seekEpoch; }
+  void addPacket(const vivictpp::libav::Packet &packet);
+  void addFrame(vivictpp::libav::Frame frame);
+  const std::vector<vivictpp::libav::Packet> &packets() const { return state->packets; }
+  std::vector<vivictpp::libav::Frame> &frames() const { return state->frames; }
+  bool empty() const { return state->packets.empty(); }
+  // Pts of the first packet in the time base of the stream, AV_NOPTS_VALUE
+  // if not known
+  int64_t firstPts() const;
+  size_t byteSize() const { return state->bytes; }
+  // Bytes of the frames added with addFrame
+  size_t frameBytes() const { return state->frameBytes; }
+
+private:
+  struct State {
+    uint64_t sequenceNo;
+    uint64_t seekEpoch;
+    std::vector<vivictpp::libav::Packet> packets;
+    std::vector<vivictpp::libav::Frame> frames;
+    size_t bytes{0};
+    size_t frameBytes{0};
+  };
+  std::shared_ptr<State> state;
+};
+
+/*
+  Decoded GOPs waiting to be passed on in the order they were read. GOPs are
+  decoded concurrently and may finish in any order, a GOP is only handed out
+  by take once all GOPs before it have been. GOPs decoded for a seek epoch
+  before the current one arrive after the seek, and are dropped.
+ */
+class DecodedGops {
+public:
+  // Returns false if the GOP is from an earlier seek epoch, and was dropped
+  bool put(const Gop &gop);
+  // Takes the GOP with the next sequence number, returns false if it has not
+  // been decoded yet
+  bool take(Gop &gop);
+  // Drops all GOPs, restarts the sequence numbers from 0 and starts a new
+  // seek epoch, which is returned
+  uint64_t reset();
+  uint64_t seekEpoch();
+  // Sequence number of the next GOP to take
+  uint64_t nextSequenceNo();
+  // Number of GOPs waiting to be taken
+  size_t size();
+  // Bytes of the decoded frames of the GOPs waiting to be taken
+  size_t frameBytes();
+
+private:
+  std::mutex mutex;
+  uint64_t epoch{0};
+  uint64_t nextToTake{0};
+  size_t bytes{0};
+  std::map<uint64_t, Gop> gops;
+};
+
+}  // namespace workers
+}  // namespace vivictpp
+
+#endif // WORKERS_GOP_HH
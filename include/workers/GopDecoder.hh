@@ -0,0 +1,54 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef WORKERS_GOPDECODER_HH
+#define WORKERS_GOPDECODER_HH
+
+#include <functional>
+
+#include "workers/Gop.hh"
+#include "workers/InputWorker.hh"
+#include "libav/Decoder.hh"
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+namespace vivictpp {
+namespace workers {
+
+/*
+  One of the decoder instances of a DecoderWorker in GOP-parallel mode. A
+  GOP that starts with a keyframe and has no frames referring to frames of
+  the previous GOP can be decoded by a decoder of its own, so the
+  DecoderWorker hands out whole GOPs to several GopDecoders, that decode them
+  concurrently on the executor, and puts the decoded GOPs back in order.
+
+  Each GOP is decoded in full, with the decoder drained at the end, and the
+  decoded frames are passed to onDecoded.
+ */
+class GopDecoder : public InputWorker<Gop> {
+public:
+  GopDecoder(AVStream *stream,
+             const vivictpp::libav::DecoderOptions &decoderOptions,
+             std::function<void(const Gop &)> onDecoded,
+             std::function<int()> urgencyFunction);
+  virtual ~GopDecoder();
+  // Drops the GOPs that have not been decoded yet
+  void discardQueued();
+
+private:
+  bool onData(const vivictpp::workers::Data<Gop> &data) override;
+  int urgency() override { return urgencyFunction(); }
+
+private:
+  vivictpp::libav::Decoder decoder;
+  std::function<void(const Gop &)> onDecoded;
+  std::function<int()> urgencyFunction;
+};
+
+}  // namespace workers
+}  // namespace vivictpp
+
+#endif // WORKERS_GOPDECODER_HH
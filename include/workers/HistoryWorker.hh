@@ -0,0 +1,93 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef WORKERS_HISTORYWORKER_HH
+#define WORKERS_HISTORYWORKER_HH
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "workers/FrameHistory.hh"
+#include "workers/InputWorker.hh"
+#include "workers/MemoryBudget.hh"
+#include "libav/Decoder.hh"
+#include "libav/Filter.hh"
+#include "libav/FormatHandler.hh"
+#include "libav/FrameIndex.hh"
+#include "time/Time.hh"
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+namespace vivictpp {
+namespace workers {
+
+/*
+  Fills the FrameHistory of a video input while playback is stopped, by
+  decoding the frames before the first frame of the frame buffer. Opens its
+  own handle to the input, and decodes from the keyframe before the start of
+  the history with the decoder options and filter of the input, so that the
+  frames look the same as the buffered ones. Decodes one packet per run, on
+  the background executor.
+
+  Also compresses the frames of the history, and decompresses the ones
+  around the frame shown ahead of stepping. Should be woken up when frames
+  are appended to the history or the position in it changes.
+
+  The bytes of the history are limited to what the MemoryBudget allows for
+  maxFrames compressed frames.
+ */
+class HistoryWorker : public InputWorker<int> {
+public:
+  // stream is the video stream of the input as opened for playback
+  HistoryWorker(std::string source, std::string format, const AVStream *stream,
+                std::string customFilter, vivictpp::libav::DecoderOptions decoderOptions,
+                std::shared_ptr<vivictpp::libav::FrameIndex> frameIndex,
+                std::shared_ptr<FrameHistory> history, int maxFrames);
+  virtual ~HistoryWorker();
+  // Decodes the frames from startPts up to endPts into the history, instead
+  // of any prefetch not finished yet. Does nothing if endPts is what was
+  // last asked for.
+  void prefetch(vivictpp::time::Time startPts, vivictpp::time::Time endPts);
+  void cancel();
+
+private:
+  bool doWork() override;
+  void open();
+  void addFrame(const vivictpp::libav::Frame &frame, bool &done);
+  void finish();
+
+private:
+  // Packets read before a prefetch is given up, guards against inputs
+  // where endPts is never reached
+  static constexpr int MAX_PACKETS_PER_PREFETCH = 1024;
+  const std::string source;
+  const std::string format;
+  const int streamIndex;
+  const std::string customFilter;
+  const vivictpp::libav::DecoderOptions decoderOptions;
+  std::shared_ptr<vivictpp::libav::FrameIndex> frameIndex;
+  std::shared_ptr<FrameHistory> history;
+  const int maxFrames;
+  std::unique_ptr<vivictpp::libav::FormatHandler> formatHandler;
+  std::unique_ptr<vivictpp::libav::Decoder> decoder;
+  std::unique_ptr<vivictpp::libav::Filter> filter;
+  // Only used by the thread calling prefetch and cancel
+  vivictpp::time::Time requestedEndPts{vivictpp::time::NO_TIME};
+  vivictpp::time::Time startPts{vivictpp::time::NO_TIME};
+  vivictpp::time::Time endPts{vivictpp::time::NO_TIME};
+  bool started{false};
+  int packetsRead{0};
+  std::map<vivictpp::time::Time, vivictpp::libav::Frame> frames;
+  bool failed{false};
+  // Declared last, so that it is closed before the history is released
+  std::unique_ptr<MemoryBudget::Account> memoryAccount;
+};
+
+}  // namespace workers
+}  // namespace vivictpp
+
+#endif // WORKERS_HISTORYWORKER_HH
@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef WORKERS_INDEXWORKER_HH
+#define WORKERS_INDEXWORKER_HH
+
+#include <memory>
+#include <string>
+
+#include "workers/InputWorker.hh"
+#include "libav/FormatHandler.hh"
+#include "libav/FrameIndex.hh"
+
+namespace vivictpp {
+namespace workers {
+
+/*
+  Builds the FrameIndex of an input in the background. Opens its own handle
+  to the input and reads all packets of the audio and video streams without
+  decoding them.
+
+  A complete index is saved in the InputCache together with the stream
+  parameters, and is loaded from there instead of scanning the input again.
+ */
+class IndexWorker : public InputWorker<int> {
+public:
+  IndexWorker(std::string source, std::string format,
+              std::shared_ptr<vivictpp::libav::FrameIndex> frameIndex);
+  virtual ~IndexWorker();
+
+private:
+  bool doWork() override;
+  void open();
+  void addPacket(const AVPacket *packet);
+
+private:
+  // Packets read before giving other tasks a chance to run
+  static constexpr int PACKETS_PER_STEP = 256;
+  const std::string source;
+  const std::string format;
+  std::shared_ptr<vivictpp::libav::FrameIndex> frameIndex;
+  std::unique_ptr<vivictpp::libav::FormatHandler> formatHandler;
+  bool done{false};
+  int64_t startTime{0};
+};
+
+}  // namespace workers
+}  // namespace vivictpp
+
+#endif // WORKERS_INDEXWORKER_HH
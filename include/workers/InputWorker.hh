@@ -6,11 +6,13 @@
 #define WORKERS_INPUTWORKER_HH
 
 #include "workers/VideoInputMessage.hh"
+#include "workers/WakeupSignal.hh"
+#include "workers/Executor.hh"
+#include <atomic>
+#include <condition_variable>
 #include <memory>
-#include <thread>
 #include <mutex>
 
-#include <unistd.h>
 #include "logging/Logging.hh"
 
 namespace vivictpp {
@@ -18,31 +20,61 @@ namespace workers {
 
 enum class InputWorkerState { INACTIVE, ACTIVE, SEEKING, STOPPED };
 
+/*
+  Base class for workers. A worker does not own a thread, it is a task on the
+  shared Executor that is scheduled when it is woken up by a new command, new
+  data, or by a call to wakeup(), which is used when something the worker was
+  blocked on has changed, e.g. space was freed in a downstream buffer. The
+  worker is only ever run by one executor thread at a time, and it stays idle
+  when neither doWork nor onData makes progress.
+
+  Subclasses must call quit() in their destructor.
+ */
 template <class T>
-class InputWorker {
+class InputWorker: public Task {
 
 public:
-  InputWorker(int queueDataLimit, std::string);
+  InputWorker(int queueDataLimit, std::string, Executor &executor = Executor::instance());
   virtual ~InputWorker();
 
-  void sendCommand(vivictpp::workers::Command *cmd);
-  bool offerData(const vivictpp::workers::Data<T> &data,
-                 const std::chrono::milliseconds& timeout);
+  void sendCommand(vivictpp::workers::Command &&cmd);
+  // Never blocks, returns false if the data queue is full. The producer
+  // signal, if set, is notified when there is room in the queue again.
+  bool offerData(const vivictpp::workers::Data<T> &data);
+  void setProducerSignal(WakeupSignal *signal) { producerSignal = signal; }
+  void wakeup() { wakeupSignal.notify(); }
   void start();
   void stop();
+  // Relative priority of this worker compared to the workers of other inputs
+  void setPriorityWeight(double weight) { priorityWeight = weight; }
+  double priority() override { return priorityWeight.load() * urgency(); }
+  // Limits the bytes of queued data, see Queue
+  void setDataByteLimit(size_t bytes);
+  size_t queuedDataBytes() { return messageQueue.queuedDataBytes(); }
 
 protected:
   InputWorker();
   void quit();
+  void clearDataOlderThan(uint64_t serialNo);
+  void notifyProducer();
+  static constexpr int MAX_URGENCY = 100;
+  // How urgently the output of this worker is needed, between 1 and
+  // MAX_URGENCY. Called from executor threads.
+  virtual int urgency() { return MAX_URGENCY; }
 
 private:
-  void pollMessageQueue();
-  void run();
+  // Maximum number of steps before giving other tasks a chance to run
+  static constexpr int MAX_STEPS_PER_RUN = 16;
+  bool pollMessageQueue();
+  void run() override;
+  void schedule();
   virtual bool filterData(const vivictpp::workers::Data<T> &data) {
     (void) data;
     return true;
   };
-  virtual void doWork(){}
+  // Returns true if any progress was made, if neither doWork nor onData makes
+  // progress the worker sleeps until woken up.
+  virtual bool doWork() { return false; }
   virtual bool onData(const vivictpp::workers::Data<T> &data) {
     (void) data;
     return true;
@@ -51,21 +83,31 @@ private:
 protected:
   vivictpp::logging::Logger logger;
   vivictpp::logging::Logger seeklog;
-  InputWorkerState state;
+  std::atomic<InputWorkerState> state;
+  WakeupSignal wakeupSignal;
   vivictpp::workers::Queue<T> messageQueue;
 
 private:
-  std::unique_ptr<std::thread> thread;
+  Executor &executor;
+  std::atomic<WakeupSignal*> producerSignal{nullptr};
+  std::atomic<double> priorityWeight{1.0};
+  // True while the worker is queued in the executor or running
+  std::atomic<bool> scheduled{false};
+  std::mutex finishedMutex;
+  std::condition_variable finishedCondition;
+  bool finished{false};
 
 };
 
 
 template<class T>
-InputWorker<T>::InputWorker(int queueDataLimit, std::string name):
+InputWorker<T>::InputWorker(int queueDataLimit, std::string name, Executor &executor):
     logger(vivictpp::logging::getOrCreateLogger(name)),
     seeklog(vivictpp::logging::getOrCreateLogger("seeklog")),
     state(InputWorkerState::INACTIVE),
-    messageQueue(queueDataLimit) {
+    wakeupSignal([this] { schedule(); }),
+    messageQueue(queueDataLimit),
+    executor(executor) {
 }
 
 template<class T>
@@ -74,27 +116,35 @@ InputWorker<T>::~InputWorker() {
 }
 
 template<class T>
-void InputWorker<T>::sendCommand(vivictpp::workers::Command *cmd) {
-  messageQueue.pushCommand(cmd);
+void InputWorker<T>::sendCommand(vivictpp::workers::Command &&cmd) {
+  messageQueue.pushCommand(std::move(cmd));
+  wakeupSignal.notify();
 }
 
 template<class T>
-bool InputWorker<T>::offerData(const vivictpp::workers::Data<T> &data,
-                               const std::chrono::milliseconds& timeout) {
+bool InputWorker<T>::offerData(const vivictpp::workers::Data<T> &data) {
   if (!filterData(data)) {
     return true;
   }
-  return messageQueue.offerData(data, timeout);
+  if (messageQueue.offerData(data)) {
+    wakeupSignal.notify();
+    return true;
+  }
+  return false;
+}
+
+template<class T>
+void InputWorker<T>::setDataByteLimit(size_t bytes) {
+  messageQueue.setMaxDataBytes(bytes);
+  // A refused producer may fit now
+  notifyProducer();
 }
 
 template<class T>
 void InputWorker<T>::start() {
   logger->trace("InputWorker::start()");
-  if (!thread) {
-    thread.reset(new std::thread(&InputWorker<T>::run, this));
-  }
   InputWorker<T> *inputWorker(this);
-  messageQueue.pushCommand(new vivictpp::workers::Command([=](uint64_t serialNo){
+  sendCommand(vivictpp::workers::Command([=](uint64_t serialNo){
                                                             (void) serialNo;
                                                             inputWorker->state = InputWorkerState::ACTIVE;
                                                             return true;
@@ -104,7 +154,7 @@ void InputWorker<T>::start() {
 template<class T>
 void InputWorker<T>::stop() {
   InputWorker<T> *inputWorker(this);
-  messageQueue.pushCommand(new vivictpp::workers::Command([=](uint64_t serialNo){
+  sendCommand(vivictpp::workers::Command([=](uint64_t serialNo){
                                                             (void) serialNo;
         inputWorker->state = InputWorkerState::INACTIVE;
         return true;
@@ -113,56 +163,102 @@ void InputWorker<T>::stop() {
 
 template<class T>
 void InputWorker<T>::quit() {
-  if (state != InputWorkerState::STOPPED) {
-    InputWorker<T> *inputWorker(this);
-    messageQueue.pushCommand(new vivictpp::workers::Command([=](uint64_t serialNo){
-                                                              (void)serialNo;
-          inputWorker->state = InputWorkerState::STOPPED;
-          return true;
-        }, "quit"));
-    if (thread) {
-      thread->join();
+  {
+    const std::lock_guard<std::mutex> lock(finishedMutex);
+    if (finished) {
+      return;
     }
   }
+  InputWorker<T> *inputWorker(this);
+  sendCommand(vivictpp::workers::Command([=](uint64_t serialNo){
+                                                            (void)serialNo;
+        inputWorker->state = InputWorkerState::STOPPED;
+        return true;
+      }, "quit"));
+  std::unique_lock<std::mutex> lock(finishedMutex);
+  finishedCondition.wait(lock, [this] { return finished; });
 }
 
 template<class T>
-void InputWorker<T>::pollMessageQueue() {
-  while (!messageQueue.empty()) {
-    vivictpp::workers::Message& message = messageQueue.peek();
-    if (typeid(message) == typeid(vivictpp::workers::Data<T>)) {
+void InputWorker<T>::clearDataOlderThan(uint64_t serialNo) {
+  messageQueue.clearDataOlderThan(serialNo);
+  notifyProducer();
+}
+
+template<class T>
+void InputWorker<T>::notifyProducer() {
+  WakeupSignal *signal = producerSignal.load();
+  if (signal) {
+    signal->notify();
+  }
+}
+
+// Handles all pending commands, and at most one data message
+template<class T>
+bool InputWorker<T>::pollMessageQueue() {
+  bool progress = false;
+  while (state != InputWorkerState::STOPPED) {
+    vivictpp::workers::Message<T> message = messageQueue.peek();
+    if (auto command = std::get_if<vivictpp::workers::Command*>(&message)) {
+      logger->debug("InputWorker::pollMessageQueue Recieved Command '{}'", (*command)->name);
+      if (!(*command)->apply()) {
+        break;
+      }
+      progress = true;
+      messageQueue.popCommand();
+    } else if (auto data = std::get_if<vivictpp::workers::Data<T>*>(&message)) {
       if (state == InputWorkerState::INACTIVE) {
-        return;
+        break;
       }
-      auto data = dynamic_cast<vivictpp::workers::Data<T>&>(message);
       logger->debug("InputWorker::pollMessageQueue Recieved DATA");
-      if (onData(data)) {
-        messageQueue.pop();
-      } else {
-          usleep(5 * 1000);
+      if (!onData(**data)) {
         break;
       }
-    } else {
-      vivictpp::workers::Command& command = dynamic_cast<vivictpp::workers::Command&>(message);
-      logger->debug("InputWorker::pollMessageQueue Recieved Command '{}'", command.name);
-      if (command.apply()) {
-        messageQueue.pop();
+      progress = true;
+      if (messageQueue.popData()) {
+        notifyProducer();
       }
+      break;
+    } else {
+      break;
     }
   }
+  return progress;
+}
+
+template<class T>
+void InputWorker<T>::schedule() {
+  if (!scheduled.exchange(true)) {
+    executor.submit(this);
+  }
 }
 
 template<class T>
 void InputWorker<T>::run() {
-  while (state == InputWorkerState::INACTIVE) {
-    if (messageQueue.waitForCommand(std::chrono::milliseconds(100))) {
-      pollMessageQueue();
+  for (int i = 0; i < MAX_STEPS_PER_RUN; i++) {
+    uint64_t generation = wakeupSignal.generation();
+    bool progress = false;
+    if (state != InputWorkerState::INACTIVE) {
+      progress = doWork();
+    }
+    progress = pollMessageQueue() || progress;
+    if (state == InputWorkerState::STOPPED) {
+      // scheduled is left set, so the worker is never run again
+      const std::lock_guard<std::mutex> lock(finishedMutex);
+      finished = true;
+      finishedCondition.notify_all();
+      return;
+    }
+    if (!progress) {
+      scheduled = false;
+      // If woken up after generation was read, keep running unless the
+      // wakeup already scheduled the worker again
+      if (wakeupSignal.generation() == generation || scheduled.exchange(true)) {
+        return;
+      }
     }
   }
-  while (state != InputWorkerState::STOPPED) {
-    doWork();
-    pollMessageQueue();
-  }
+  executor.submit(this);
 }
 
 }  // namespace workers
@@ -0,0 +1,112 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef WORKERS_MEMORYBUDGET_HH
+#define WORKERS_MEMORYBUDGET_HH
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "logging/Logging.hh"
+
+namespace vivictpp {
+namespace workers {
+
+/*
+  Process-wide limit on the memory used by decoded frames and queued packets.
+
+  Every frame buffer and packet queue opens an account with the budget. A
+  fixed share of the budget is reserved for packet queues and split evenly
+  between them. The rest is split between the frame buffers so that each
+  gets an equal number of bytes, except that buffers that need less than
+  their share, typically audio, get what they need and leave the remainder to
+  the others. The number of frames a buffer may hold is its byte share
+  divided by its frame size, so high resolution inputs get shallower buffers.
+
+  The split is recomputed when an account is opened or closed, when the frame
+  size of an account changes, and when the limit is changed. Each account is
+  told about its new allocation through a callback, which is called with the
+  budget lock held and must not call back into the budget.
+ */
+class MemoryBudget {
+public:
+  enum class Kind { VIDEO_FRAMES, AUDIO_FRAMES, PACKETS };
+
+  struct Allocation {
+    size_t bytes;
+    int entries;
+  };
+
+  class Account {
+  public:
+    ~Account();
+    Account(const Account &) = delete;
+    Account &operator=(const Account &) = delete;
+    // Updates the size of one entry, e.g. when the first frame shows that
+    // the filtered frames are larger than estimated
+    void setEntryBytes(size_t bytes);
+    Allocation getAllocation();
+    // Bytes currently held by the buffer of this account
+    size_t usedBytes() const { return usage(); }
+    const std::string &getName() const { return name; }
+  private:
+    friend class MemoryBudget;
+    Account(MemoryBudget &budget, Kind kind, std::string name, size_t entryBytes,
+            int minEntries, int maxEntries, std::function<size_t()> usage,
+            std::function<void(Allocation)> onAllocation);
+    size_t maxBytes() const { return entryBytes.load() * maxEntries; }
+  private:
+    MemoryBudget &budget;
+    const Kind kind;
+    const std::string name;
+    std::atomic<size_t> entryBytes;
+    const int minEntries;
+    const int maxEntries;
+    const std::function<size_t()> usage;
+    const std::function<void(Allocation)> onAllocation;
+    Allocation allocation{0, 0};
+  };
+
+  static MemoryBudget &instance();
+  // A quarter of the physical memory
+  static size_t defaultLimit();
+
+  explicit MemoryBudget(size_t limit);
+  MemoryBudget(const MemoryBudget &) = delete;
+  MemoryBudget &operator=(const MemoryBudget &) = delete;
+
+  // entryBytes is the expected size of a frame. The number of entries given
+  // to frame buffers is kept between minEntries and maxEntries. Packet
+  // queues are only limited in bytes, and are always given maxEntries.
+  std::unique_ptr<Account> open(Kind kind, std::string name, size_t entryBytes,
+                                int minEntries, int maxEntries,
+                                std::function<size_t()> usage,
+                                std::function<void(Allocation)> onAllocation);
+  void setLimit(size_t limit);
+  size_t getLimit();
+  // Bytes currently held by all accounts
+  size_t usedBytes();
+
+private:
+  void close(Account *account);
+  void rebalance();
+
+private:
+  // Share of the budget reserved for packet queues
+  static constexpr double PACKET_SHARE = 0.1;
+  vivictpp::logging::Logger logger;
+  std::mutex mutex;
+  size_t limit;
+  std::vector<Account*> accounts;
+};
+
+}  // namespace workers
+}  // namespace vivictpp
+
+#endif // WORKERS_MEMORYBUDGET_HH
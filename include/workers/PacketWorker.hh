@@ -6,11 +6,15 @@
 #define WORKERS_PACKETWORKER_HH
 
 #include <atomic>
+#include <mutex>
+#include <optional>
 
 #include "workers/InputWorker.hh"
 #include "workers/PacketQueue.hh"
 #include "libav/FormatHandler.hh"
 #include "workers/DecoderWorker.hh"
+#include "workers/IndexWorker.hh"
+#include "libav/FrameIndex.hh"
 #include "VideoMetadata.hh"
 #include "time/Time.hh"
 #include "Seeking.hh"
@@ -26,7 +30,12 @@ public:
   void removeDecoderWorker(const std::shared_ptr<DecoderWorker> &decoderWorker);
   bool hasDecoders() { return !decoderWorkers.empty(); };
   int nDecoders() { return decoderWorkers.size(); };
-  void seek(vivictpp::time::Time pos, vivictpp::SeekCallback callback);
+  // Seeks that arrive before the worker has started on the previous one
+  // replace it, only the latest target is kept
+  void seek(vivictpp::time::Time pos, vivictpp::SeekCallback callback,
+            vivictpp::SeekToken token = vivictpp::SeekToken());
+  // See FormatHandler::setKeyframesOnly
+  void setKeyframesOnly(bool keyframesOnly);
   const std::vector<VideoMetadata> &getVideoMetadata() {
     std::lock_guard<std::mutex> guard(videoMetadataMutex);
     return this->videoMetadata;
@@ -34,19 +43,48 @@ public:
   const std::vector<AVStream *> &getStreams() { return formatHandler.getStreams(); }
   const std::vector<AVStream *> &getVideoStreams() { return formatHandler.getVideoStreams(); }
   const std::vector<AVStream *> &getAudioStreams() { return formatHandler.getAudioStreams(); }
+  // Filled in the background, see IndexWorker
+  const std::shared_ptr<vivictpp::libav::FrameIndex> &getFrameIndex() { return frameIndex; }
 
 private:
-  void doWork() override;
+  bool doWork() override;
+  int urgency() override { return decoderUrgency.load(); }
   void setActiveStreams();
   void unrefCurrentPacket();
+  bool deliverEndOfStream();
   void initVideoMetadata();
+  const std::vector<std::shared_ptr<DecoderWorker>> &decodersForStream(int streamIndex);
 
 private:
+  struct PendingSeek {
+    vivictpp::time::Time pos;
+    vivictpp::SeekCallback callback;
+    vivictpp::SeekToken token;
+  };
+
   vivictpp::libav::FormatHandler formatHandler;
   std::vector<std::shared_ptr<DecoderWorker>> decoderWorkers;
+  // Decoder workers indexed by the stream they decode
+  std::vector<std::vector<std::shared_ptr<DecoderWorker>>> decodersByStream;
   AVPacket* currentPacket;
+  // Shared by all decoders of the current packet's stream
+  vivictpp::libav::Packet sharedPacket;
+  // Number of decoders that have accepted the current packet
+  size_t deliveredCount;
+  // Set when all decoders have been sent the empty packet that marks the end
+  // of the input, cleared by a seek
+  bool endOfStreamDelivered{false};
+  // Highest urgency of the decoders, as seen on the last doWork
+  std::atomic<int> decoderUrgency{MAX_URGENCY};
   std::vector<VideoMetadata> videoMetadata;
   std::mutex videoMetadataMutex;
+  std::shared_ptr<vivictpp::libav::FrameIndex> frameIndex;
+  std::unique_ptr<IndexWorker> indexWorker;
+  // The latest seek, while its command has not been handled
+  std::optional<PendingSeek> pendingSeek;
+  std::mutex pendingSeekMutex;
+  // Token of the seek whose packets are being read
+  vivictpp::SeekToken seekToken;
 
 };
 }  // namespace workers
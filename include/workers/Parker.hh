@@ -0,0 +1,72 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef WORKERS_PARKER_HH
+#define WORKERS_PARKER_HH
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace vivictpp {
+namespace workers {
+
+/*
+  Lets a thread sleep until some lock-free condition becomes true.
+
+  The state that the condition depends on is owned by the caller and must be
+  updated with sequentially consistent atomics before calling unpark(). The
+  mutex is only taken when a thread actually needs to sleep, or when there is
+  a sleeping thread to wake up, so the fast path of both sides is lock free.
+ */
+class Parker {
+public:
+  Parker() = default;
+  Parker(const Parker &) = delete;
+  Parker &operator=(const Parker &) = delete;
+
+  template <class Predicate>
+  void park(Predicate predicate) {
+    if (predicate()) {
+      return;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    waiters++;
+    conditionVariable.wait(lock, predicate);
+    waiters--;
+  }
+
+  template <class Predicate>
+  bool parkFor(const std::chrono::milliseconds &relTime, Predicate predicate) {
+    if (predicate()) {
+      return true;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    waiters++;
+    bool result = conditionVariable.wait_for(lock, relTime, predicate);
+    waiters--;
+    return result;
+  }
+
+  void unpark() {
+    if (waiters.load() == 0) {
+      return;
+    }
+    // Taking the lock ensures a parking thread is either not yet checking
+    // its predicate, or already waiting on the condition variable.
+    { const std::lock_guard<std::mutex> lock(mutex); }
+    conditionVariable.notify_all();
+  }
+
+private:
+  std::atomic<int> waiters{0};
+  std::mutex mutex;
+  std::condition_variable conditionVariable;
+};
+
+}  // namespace workers
+}  // namespace vivictpp
+
+#endif // WORKERS_PARKER_HH
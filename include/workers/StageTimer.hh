@@ -0,0 +1,56 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef WORKERS_STAGETIMER_HH
+#define WORKERS_STAGETIMER_HH
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace vivictpp {
+namespace workers {
+
+/*
+  Accumulates the time spent in one pipeline stage. Written by the stage,
+  may be read from any thread.
+ */
+class StageTimer {
+public:
+  class Scope {
+  public:
+    explicit Scope(StageTimer &timer):
+      timer(timer),
+      start(std::chrono::steady_clock::now()) {}
+    ~Scope() {
+      timer.add(std::chrono::steady_clock::now() - start);
+    }
+  private:
+    StageTimer &timer;
+    const std::chrono::steady_clock::time_point start;
+  };
+
+  void add(std::chrono::steady_clock::duration duration) {
+    totalNanos.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(),
+                         std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+  }
+  uint64_t getCount() const { return count.load(std::memory_order_relaxed); }
+  double averageMillis() const {
+    uint64_t n = getCount();
+    return n == 0 ? 0.0 : totalNanos.load(std::memory_order_relaxed) / (n * 1e6);
+  }
+  double totalMillis() const {
+    return totalNanos.load(std::memory_order_relaxed) / 1e6;
+  }
+
+private:
+  std::atomic<uint64_t> count{0};
+  std::atomic<uint64_t> totalNanos{0};
+};
+
+}  // namespace workers
+}  // namespace vivictpp
+
+#endif // WORKERS_STAGETIMER_HH
@@ -0,0 +1,48 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef WORKERS_THREADPLACEMENT_HH
+#define WORKERS_THREADPLACEMENT_HH
+
+#include <string>
+
+namespace vivictpp {
+namespace workers {
+
+// Names the calling thread, as shown by top and perf. Names are cut to 15
+// characters on Linux.
+void setCurrentThreadName(const std::string &name);
+
+// Gives the calling thread the lowest scheduling priority. Threads it starts
+// inherit the priority. Does nothing on platforms other than Linux and macOS.
+void setCurrentThreadLowPriority();
+
+/*
+  Optional placement of threads on cpu cores, so that presentation keeps its
+  timing when other processes load the machine. One core is reserved for the
+  presentation thread, i.e. the thread running the event loop, and the SDL
+  timer thread, and all other threads run on the remaining cores.
+
+  Threads inherit the placement of the thread that creates them, so enable()
+  is called from the main thread before any other thread is started. That
+  keeps the executor threads, the decoder threads started by libavcodec and
+  any other threads off the presentation core.
+
+  Only supported on Linux, elsewhere enabling it only logs a message.
+ */
+class ThreadPlacement {
+public:
+  // Restricts the calling thread to the worker cores. Does nothing if there
+  // is only one core to run on.
+  static void enable();
+  static bool isEnabled();
+  // Moves the calling thread to the presentation core. Returns false if
+  // placement is not enabled or not supported.
+  static bool pinPresentationThread();
+};
+
+}  // namespace workers
+}  // namespace vivictpp
+
+#endif // WORKERS_THREADPLACEMENT_HH
@@ -0,0 +1,67 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef WORKERS_THUMBNAILWORKER_HH
+#define WORKERS_THUMBNAILWORKER_HH
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "workers/InputWorker.hh"
+#include "libav/Decoder.hh"
+#include "libav/FormatHandler.hh"
+#include "libav/FrameIndex.hh"
+#include "libav/Scaler.hh"
+#include "libav/ThumbnailCache.hh"
+
+namespace vivictpp {
+namespace workers {
+
+/*
+  Fills a ThumbnailCache in the background, for the seek bar. Opens its own
+  handle to the input and decodes one keyframe per thumbnail with a single
+  threaded decoder, one thumbnail per run.
+
+  The slots are filled coarse to fine, every 16th slot first, so that the
+  whole seek bar has thumbnails early. A complete set is saved in the
+  InputCache, and is loaded from there instead of decoding the input again.
+ */
+class ThumbnailWorker : public InputWorker<int> {
+public:
+  static constexpr int THUMBNAIL_WIDTH = 160;
+
+  ThumbnailWorker(std::string source, std::string format, int streamIndex,
+                  std::shared_ptr<vivictpp::libav::FrameIndex> frameIndex,
+                  std::shared_ptr<vivictpp::libav::ThumbnailCache> thumbnails);
+  virtual ~ThumbnailWorker();
+
+private:
+  bool doWork() override;
+  void open();
+  void finish();
+  vivictpp::libav::Frame decodeKeyframe(vivictpp::time::Time t);
+  std::shared_ptr<const vivictpp::libav::Thumbnail> makeThumbnail(const vivictpp::libav::Frame &frame);
+
+private:
+  // Packets read looking for a keyframe before the slot is left empty
+  static constexpr int MAX_PACKETS_PER_THUMBNAIL = 512;
+  static constexpr size_t FIRST_STRIDE = 16;
+  const std::string source;
+  const std::string format;
+  const int streamIndex;
+  std::shared_ptr<vivictpp::libav::FrameIndex> frameIndex;
+  std::shared_ptr<vivictpp::libav::ThumbnailCache> thumbnails;
+  std::unique_ptr<vivictpp::libav::FormatHandler> formatHandler;
+  std::unique_ptr<vivictpp::libav::Decoder> decoder;
+  vivictpp::libav::Scaler scaler;
+  std::vector<size_t> slotOrder;
+  size_t nextSlot{0};
+  bool done{false};
+};
+
+}  // namespace workers
+}  // namespace vivictpp
+
+#endif // WORKERS_THUMBNAILWORKER_HH
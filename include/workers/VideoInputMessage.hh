@@ -6,156 +6,318 @@
 #ifndef WORKERS_VIDEOINPUTMESSAGE_HH
 #define WORKERS_VIDEOINPUTMESSAGE_HH
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <list>
 #include <memory>
 #include <mutex>
-#include <queue>
-#include <atomic>
-#include <condition_variable>
-#include <functional>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
 
 namespace vivictpp {
 namespace workers {
 
-class Message {
-public:
-  virtual ~Message() = default;
-public:
-  const uint64_t serialNo;
-protected:
-  Message():
-    serialNo(serialCounter++) {}
-private:
-  static std::atomic<uint64_t> serialCounter;
-};
+// Serial numbers are shared by commands and data, so that a command can
+// discard all data that was queued before it.
+uint64_t nextSerialNo();
+
+/*
+  A named lambda taking the serial number of the command. The lambda is stored
+  inline, so creating and queueing a command never allocates.
 
-class Command: public Message {
+  A SUPERSEDING command fully replaces the effect of an earlier command with
+  the same name, which may then be dropped from a full queue.
+ */
+class Command {
 public:
-  Command(std::function<bool(uint64_t)> lambda, std::string name = "UNKNOWN"):
+  enum class Kind { ORDERED, SUPERSEDING };
+  template <class F>
+  Command(F lambda, const char *name = "UNKNOWN", Kind kind = Kind::ORDERED):
+    serialNo(nextSerialNo()),
     name(name),
-    lambda(lambda) {
+    kind(kind),
+    invokeFunction(&invoke<F>),
+    manageFunction(&manage<F>) {
+    static_assert(sizeof(F) <= STORAGE_SIZE, "Command lambda captures too much");
+    static_assert(alignof(F) <= alignof(std::max_align_t), "Command lambda alignment not supported");
+    new (storage) F(std::move(lambda));
+  }
+  Command(Command &&other) noexcept:
+    serialNo(other.serialNo),
+    name(other.name),
+    kind(other.kind),
+    invokeFunction(other.invokeFunction),
+    manageFunction(other.manageFunction) {
+    manageFunction(Operation::MOVE, storage, other.storage);
+  }
+  Command(const Command &) = delete;
+  Command &operator=(const Command &) = delete;
+  ~Command() {
+    manageFunction(Operation::DESTROY, storage, nullptr);
   }
-  virtual ~Command() = default;
   bool apply() {
-    return lambda(serialNo);
+    return invokeFunction(storage, serialNo);
+  }
+  bool supersedes(const Command &earlier) const {
+    return kind == Kind::SUPERSEDING && earlier.kind == Kind::SUPERSEDING &&
+      std::strcmp(name, earlier.name) == 0;
   }
 public:
-  const std::string name;
+  const uint64_t serialNo;
+  const char *name;
+  const Kind kind;
+private:
+  enum class Operation { MOVE, DESTROY };
+  template <class F>
+  static bool invoke(void *lambda, uint64_t serialNo) {
+    return (*static_cast<F*>(lambda))(serialNo);
+  }
+  template <class F>
+  static void manage(Operation operation, void *dst, void *src) {
+    if (operation == Operation::MOVE) {
+      new (dst) F(std::move(*static_cast<F*>(src)));
+    } else {
+      static_cast<F*>(dst)->~F();
+    }
+  }
 private:
-  std::function<bool(uint64_t)> lambda;
+  static constexpr size_t STORAGE_SIZE = 64;
+  alignas(std::max_align_t) unsigned char storage[STORAGE_SIZE];
+  bool (*invokeFunction)(void *, uint64_t);
+  void (*manageFunction)(Operation, void *, void *);
 };
 
+/*
+  Data message. T is expected to be a cheap to copy handle, like a Packet or
+  a Frame.
+ */
 template <class T>
-class Data : public Message {
+class Data {
 public:
-  const std::shared_ptr<T> data;
+  const uint64_t serialNo;
+  const T data;
 
 public:
-  Data(T* data):
-    data(data) {}
-  virtual ~Data() = default;
-  T* operator->() const { return data.get(); }
+  Data(T data):
+    serialNo(nextSerialNo()),
+    data(std::move(data)) {}
+  const T* operator->() const { return &data; }
 };
 
+// Number of bytes held by a data message, for memory accounting
+template <class T>
+size_t dataBytes(const T &data) {
+  if constexpr (std::is_class_v<T>) {
+    return data.byteSize();
+  } else {
+    (void) data;
+    return 0;
+  }
+}
+
+/*
+  Fixed capacity FIFO. All slots are allocated up front, pushing and popping
+  only constructs and destroys entries in place.
+ */
+template <class E>
+class MessageRing {
+public:
+  explicit MessageRing(size_t capacity):
+    slots(capacity) {}
+  bool empty() const { return count == 0; }
+  bool full() const { return count == slots.size(); }
+  size_t size() const { return count; }
+  template <class... Args>
+  void emplace(Args&&... args) {
+    slots[(first + count) % slots.size()].emplace(std::forward<Args>(args)...);
+    count++;
+  }
+  E &front() { return *slots[first]; }
+  void pop() {
+    slots[first].reset();
+    first = (first + 1) % slots.size();
+    count--;
+  }
+  // Removes the newest entry after the front matching pred, moving the
+  // entries after it one step forward. The front entry is never touched, so
+  // that a reference returned by front() stays valid.
+  template <class P>
+  bool removeLastMatch(P pred) {
+    for (size_t i = count; i-- > 1;) {
+      if (!pred(*slots[(first + i) % slots.size()])) {
+        continue;
+      }
+      for (size_t j = i; j + 1 < count; j++) {
+        std::optional<E> &slot = slots[(first + j) % slots.size()];
+        slot.reset();
+        slot.emplace(std::move(*slots[(first + j + 1) % slots.size()]));
+      }
+      slots[(first + count - 1) % slots.size()].reset();
+      count--;
+      return true;
+    }
+    return false;
+  }
+private:
+  std::vector<std::optional<E>> slots;
+  size_t first{0};
+  size_t count{0};
+};
+
+/*
+  A reference to the next message of a Queue, empty if there is no message.
+ */
+template <class T>
+using Message = std::variant<std::monostate, Command*, Data<T>*>;
+
+/*
+  Message queue of an InputWorker. Commands and data are kept in separate
+  rings so that commands, e.g. seeks, are handled before any queued data.
+  Commands and data are pushed from other threads and consumed by the worker
+  thread. An entry returned by peek() stays valid until it is popped.
+
+  Besides the number of data messages, the queued data can be limited in
+  bytes. A message is always accepted by an empty queue, however large.
+
+  Commands are never refused, as they are sent from the UI and event loop
+  threads. When the command ring is full, a queued command superseded by the
+  new one is dropped to make room. Failing that, the command is kept in an
+  overflow queue, which is moved into the ring as it drains.
+ */
 template <class T>
 class Queue {
 private:
-  std::queue<std::shared_ptr<Command>> queue_;
-  std::queue<std::shared_ptr<Data<T>>> dataQueue;
+  static constexpr size_t MAX_COMMANDS = 256;
+  MessageRing<Command> commands;
+  std::list<Command> overflowCommands;
+  MessageRing<Data<T>> dataQueue;
+  size_t queuedBytes{0};
+  size_t maxDataBytes{std::numeric_limits<size_t>::max()};
+  bool refused{false};
   std::mutex mutex;
-  size_t maxDataQueueSize;
-  std::condition_variable conditionVariable;
-  bool popData;
 
 public:
-  Queue(size_t maxDataQueueSize):
-    maxDataQueueSize(maxDataQueueSize) {}
+  Queue(size_t maxDataQueueSize, size_t maxCommands = MAX_COMMANDS):
+    commands(maxCommands),
+    dataQueue(maxDataQueueSize) {}
   bool empty();
-  bool offerData(const Data<T> &data, const std::chrono::milliseconds& timeout);
-  bool waitForCommand(const std::chrono::milliseconds& timeout);
+  bool offerData(const Data<T> &data);
   void clearDataOlderThan(uint64_t serialNo);
-  void pushCommand(Command* command);
-  Message & peek();
-  void pop();
+  void pushCommand(Command &&command);
+  Message<T> peek();
+  void popCommand();
+  // Returns true if data has been refused since the last pop
+  bool popData();
+  void setMaxDataBytes(size_t bytes);
+  size_t queuedDataBytes();
+  size_t queuedCommands();
 };
 
 template <class T>
 bool Queue<T>::empty() {
   const std::lock_guard<std::mutex> lock(mutex);
-  return queue_.empty() && dataQueue.empty();
-}
-
-template <class T>
-bool Queue<T>::offerData(const Data<T> &data,
-                                            const std::chrono::milliseconds& timeout) {
-  std::unique_lock<std::mutex> lock(mutex);
-    if (conditionVariable.wait_for(lock, timeout,
-                                 [&]{ return dataQueue.size() < maxDataQueueSize; })) {
-    dataQueue.push(std::shared_ptr<Data<T>>(new Data<T>(data)));
-    return true;
-  }
-  return false;
+  return commands.empty() && dataQueue.empty();
 }
 
 template <class T>
-bool Queue<T>::waitForCommand(const std::chrono::milliseconds& timeout) {
-  std::unique_lock<std::mutex> lock(mutex);
-  return conditionVariable.wait_for(lock, timeout,
-                                    [&]{ return queue_.size() > 0; });
+bool Queue<T>::offerData(const Data<T> &data) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  size_t bytes = dataBytes(data.data);
+  if (dataQueue.full() || (!dataQueue.empty() && queuedBytes + bytes > maxDataBytes)) {
+    refused = true;
+    return false;
+  }
+  dataQueue.emplace(data);
+  queuedBytes += bytes;
+  return true;
 }
 
-
 template <class T>
 void Queue<T>::clearDataOlderThan(uint64_t serialNo) {
   const std::lock_guard<std::mutex> lock(mutex);
-  while(!dataQueue.empty() && dataQueue.front()->serialNo < serialNo) {
+  while(!dataQueue.empty() && dataQueue.front().serialNo < serialNo) {
+    queuedBytes -= dataBytes(dataQueue.front().data);
     dataQueue.pop();
   }
 }
 
 template <class T>
-void Queue<T>::pushCommand(Command *command) {
-  bool wasEmpty;
-  {
-    const std::lock_guard<std::mutex> lock(mutex);
-    wasEmpty = queue_.empty();
-    queue_.push(std::shared_ptr<Command>(command));
+void Queue<T>::pushCommand(Command &&command) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  if (!overflowCommands.empty()) {
+    for (auto it = overflowCommands.rbegin(); it != overflowCommands.rend(); ++it) {
+      if (command.supersedes(*it)) {
+        overflowCommands.erase(std::next(it).base());
+        break;
+      }
+    }
+    overflowCommands.push_back(std::move(command));
+    return;
   }
-  if (wasEmpty) {
-    conditionVariable.notify_all();
+  if (commands.full() &&
+      !commands.removeLastMatch([&command](const Command &queued) { return command.supersedes(queued); })) {
+    overflowCommands.push_back(std::move(command));
+    return;
   }
+  commands.emplace(std::move(command));
 }
 
 template <class T>
-Message& Queue<T>::peek() {
+Message<T> Queue<T>::peek() {
   const std::lock_guard<std::mutex> lock(mutex);
-  if (!queue_.empty()) {
-    popData = false;
-    return *queue_.front();
+  if (!commands.empty()) {
+    return &commands.front();
   }
   if (!dataQueue.empty()) {
-    popData = true;
-    return *dataQueue.front();
+    return &dataQueue.front();
   }
-  throw std::runtime_error("Queue is empty");
+  return std::monostate();
 }
 
 template <class T>
-void Queue<T>::pop() {
-  bool dataWasFull{false};
-  {
-    const std::lock_guard<std::mutex> lock(mutex);
-    if (popData) {
-      dataWasFull = dataQueue.size() == maxDataQueueSize;
-      dataQueue.pop();
-    } else {
-      queue_.pop();
-    }
-  }
-  if (dataWasFull) {
-    conditionVariable.notify_all();
+void Queue<T>::popCommand() {
+  const std::lock_guard<std::mutex> lock(mutex);
+  commands.pop();
+  if (!overflowCommands.empty()) {
+    commands.emplace(std::move(overflowCommands.front()));
+    overflowCommands.pop_front();
   }
 }
 
+template <class T>
+bool Queue<T>::popData() {
+  const std::lock_guard<std::mutex> lock(mutex);
+  queuedBytes -= dataBytes(dataQueue.front().data);
+  dataQueue.pop();
+  bool wasRefused = refused;
+  refused = false;
+  return wasRefused;
+}
+
+template <class T>
+void Queue<T>::setMaxDataBytes(size_t bytes) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  maxDataBytes = bytes;
+}
+
+template <class T>
+size_t Queue<T>::queuedDataBytes() {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return queuedBytes;
+}
+
+template <class T>
+size_t Queue<T>::queuedCommands() {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return commands.size() + overflowCommands.size();
+}
+
 }  // namespace workers
 }  // namespace vivictpp
 
@@ -0,0 +1,45 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef WORKERS_WAKEUPSIGNAL_HH
+#define WORKERS_WAKEUPSIGNAL_HH
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+namespace vivictpp {
+namespace workers {
+
+/*
+  Wakes up a worker when something it may be waiting for has happened, like
+  a new command, new data or free space downstream.
+
+  The worker reads the generation before looking for work. If it finds
+  nothing to do and the generation is unchanged it may go idle, since any
+  later notify() will wake it up again.
+ */
+class WakeupSignal {
+public:
+  explicit WakeupSignal(std::function<void()> onNotify):
+    onNotify(std::move(onNotify)) {}
+  WakeupSignal(const WakeupSignal &) = delete;
+  WakeupSignal &operator=(const WakeupSignal &) = delete;
+
+  uint64_t generation() const { return counter.load(); }
+
+  void notify() {
+    counter.fetch_add(1);
+    onNotify();
+  }
+
+private:
+  std::atomic<uint64_t> counter{0};
+  const std::function<void()> onNotify;
+};
+
+}  // namespace workers
+}  // namespace vivictpp
+
+#endif // WORKERS_WAKEUPSIGNAL_HH
@@ -20,10 +20,11 @@ VideoMetadata* metadataPtr(const std::vector<VideoMetadata> &v) {
 
 vivictpp::Controller::Controller(std::shared_ptr<EventLoop> eventLoop,
                                  std::shared_ptr<vivictpp::ui::Display> display,
-                                 VivictPPConfig vivictPPConfig)
+                                 VivictPPConfig vivictPPConfig,
+                                 std::shared_ptr<InputOpener> inputOpener)
   : eventLoop(eventLoop),
     display(display),
-    vivictPP(vivictPPConfig, eventLoop, vivictpp::sdl::audioOutputFactory),
+    vivictPP(vivictPPConfig, eventLoop, vivictpp::sdl::audioOutputFactory, inputOpener),
     splitScreenDisabled(vivictPPConfig.sourceConfigs.size() == 1),
     plotEnabled(vivictPPConfig.hasVmafData()),
     startTime(vivictPP.getVideoInputs().startTime()),
@@ -68,20 +69,35 @@ void vivictpp::Controller::fade() {
 
 void vivictpp::Controller::seekFinished(vivictpp::time::Time seekedPos, bool error) {
   vivictPP.onSeekFinished(seekedPos, error);
-  displayState.seekBar.seeking = false;
+  // The seek bar keeps showing the dragged position while previews are shown
+  displayState.seekBar.seeking = vivictPP.getPlayerState().scrubbing;
 }
 
 void vivictpp::Controller::refreshDisplay() {
   logger->trace("vivictpp::Controller::refreshDisplay");
+  if (!vivictPP.getVideoInputs().firstFramesBuffered()) {
+    display->displaySplash("Buffering...");
+    eventLoop->scheduleRefreshDisplay(20);
+    return;
+  }
   std::array<vivictpp::libav::Frame, 2> frames = vivictPP.getVideoInputs().firstFrames();
   displayState.leftFrame = frames[0];
   displayState.rightFrame = frames[1];
+  if (vivictPP.isPlaying()) {
+    displayState.leftNeighbourFrames.clear();
+    displayState.rightNeighbourFrames.clear();
+  } else {
+    auto neighbours = vivictPP.getVideoInputs().neighbourFrames(vivictpp::ui::NEIGHBOUR_FRAMES);
+    displayState.leftNeighbourFrames = neighbours[0];
+    displayState.rightNeighbourFrames = neighbours[1];
+  }
   if (displayState.displayTime) {
     displayState.timeStr = vivictpp::time::formatTime(vivictPP.getPts());
   }
   displayState.pts = vivictPP.getPts();
   displayState.seekBar.relativePos = (displayState.pts - startTime) / (float) inputDuration;
   display->displayFrame(displayState);
+  vivictPP.setDownscaleResolution(display->getVideoDisplayResolution());
 }
 
 
@@ -98,6 +114,7 @@ void vivictpp::Controller::mouseDrag(const ui::MouseDragged mouseDragged) {
       logger->trace("vivictpp::Controller::mouseDrag mouseDragged.x={}, box.x={}, box.w={}",
                     mouseDragged.x, box.x, box.w);
       displayState.seekBar.relativeSeekPos = std::min(1.0, std::max(seekRel, 0.0));
+      vivictPP.scrubTo(seekBarPts(displayState.seekBar.relativeSeekPos));
       eventLoop->scheduleRefreshDisplay(0);
     } else {
       int xrel = mouseDragged.xrel;
@@ -112,9 +129,9 @@ void vivictpp::Controller::mouseDrag(const ui::MouseDragged mouseDragged) {
 
 void vivictpp::Controller::mouseDragStopped(const ui::MouseDragStopped mouseDragStopped) {
   if (mouseDragStopped.target == "seekbar") {
-    float pos = startTime + inputDuration * displayState.seekBar.relativeSeekPos;
+    vivictpp::time::Time pos = seekBarPts(displayState.seekBar.relativeSeekPos);
     logger->debug("seeking to {}", pos);
-    vivictPP.seek(pos);
+    vivictPP.stopScrubbing(pos);
     displayState.seekBar.seeking = false;
     eventLoop->scheduleRefreshDisplay(0);
   }
@@ -126,6 +143,8 @@ void vivictpp::Controller::mouseDragStarted(const ui::MouseDragStarted mouseDrag
     double seekRel = (mouseDragStarted.x - box.x) / (double) box.w;
     displayState.seekBar.relativeSeekPos = std::min(1.0, std::max(seekRel, 0.0));
     displayState.seekBar.seeking = true;
+    vivictPP.startScrubbing();
+    vivictPP.scrubTo(seekBarPts(displayState.seekBar.relativeSeekPos));
     eventLoop->scheduleRefreshDisplay(0);
   }
 }
@@ -146,6 +165,17 @@ void vivictpp::Controller::mouseMotion(const int x, const int y) {
     displayState.seekBar.hideTimer = 0;
     displayState.seekBar.opacity = 255;
   }
+  // Thumbnails are made in the background, see ThumbnailWorker
+  float hoverPos = displayState.seekBar.visible ? display->seekBarHoverPos(x, y) : -1;
+  displayState.seekBar.relativeHoverPos = hoverPos;
+  if (hoverPos >= 0) {
+    auto thumbnails = vivictPP.getVideoInputs().thumbnailsAt(seekBarPts(hoverPos));
+    displayState.seekBar.leftThumbnail = thumbnails[0];
+    displayState.seekBar.rightThumbnail = thumbnails[1];
+  } else {
+    displayState.seekBar.leftThumbnail.reset();
+    displayState.seekBar.rightThumbnail.reset();
+  }
   eventLoop->scheduleRefreshDisplay(0);
 }
 
@@ -161,8 +191,8 @@ void vivictpp::Controller::mouseClick(const vivictpp::ui::MouseClicked mouseClic
   logger->debug("vivictpp::Controller::mouseClick {}", mouseClicked.target);
   if (mouseClicked.target == "seekbar") {
     auto box = mouseClicked.component.get().getBox();
-    float seekRel = (mouseClicked.x - box.x) / (float) box.w;
-    float pos = startTime + inputDuration * seekRel;
+    double seekRel = (mouseClicked.x - box.x) / (double) box.w;
+    vivictpp::time::Time pos = seekBarPts(std::min(1.0, std::max(seekRel, 0.0)));
     logger->debug("seeking to {}", pos);
     vivictPP.seek(pos);
   } else {
@@ -170,6 +200,10 @@ void vivictpp::Controller::mouseClick(const vivictpp::ui::MouseClicked mouseClic
   }
 }
 
+vivictpp::time::Time vivictpp::Controller::seekBarPts(double relativePos) {
+  return startTime + static_cast<vivictpp::time::Time>(inputDuration * relativePos);
+}
+
 void vivictpp::Controller::togglePlaying() {
   displayState.isPlaying = vivictPP.togglePlaying() == PlaybackState::PLAYING;
 }
@@ -273,6 +307,9 @@ void vivictpp::Controller::adjustPlaybackSpeed(int delta) {
   } else {
     float speedFloat = std::pow(std::sqrt(2), -1 * speed);
     displayState.playbackSpeedStr =  fmt::format("{:.2f}", speedFloat);
+    if (vivictPP.getPlayerState().trickPlay) {
+      displayState.playbackSpeedStr += " (keyframes)";
+    }
   }
   eventLoop->scheduleRefreshDisplay(0);
 }
@@ -0,0 +1,47 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "InputOpener.hh"
+
+#include "time/TimeUtils.hh"
+#include "workers/ThreadPlacement.hh"
+
+InputOpener::InputOpener(const std::vector<SourceConfig> &sourceConfigs):
+  logger(vivictpp::logging::getOrCreateLogger("InputOpener")),
+  startTime(vivictpp::time::relativeTimeMillis()) {
+  for (const auto &source : sourceConfigs) {
+    futures.push_back(std::async(std::launch::async, &InputOpener::open, this,
+                                 source.path, source.formatOptions));
+  }
+}
+
+InputOpener::~InputOpener() {
+  for (auto &future : futures) {
+    if (future.valid()) {
+      future.wait();
+    }
+  }
+}
+
+std::shared_ptr<vivictpp::workers::PacketWorker> InputOpener::open(const std::string &path,
+                                                                   const std::string &format) {
+  vivictpp::workers::setCurrentThreadName("vpp-open");
+  try {
+    auto packetWorker = std::make_shared<vivictpp::workers::PacketWorker>(path, format);
+    logger->info("Opened {} in {} ms", path, vivictpp::time::relativeTimeMillis() - startTime);
+    opened++;
+    return packetWorker;
+  } catch (...) {
+    opened++;
+    throw;
+  }
+}
+
+std::vector<std::shared_ptr<vivictpp::workers::PacketWorker>> InputOpener::get() {
+  std::vector<std::shared_ptr<vivictpp::workers::PacketWorker>> packetWorkers;
+  for (auto &future : futures) {
+    packetWorkers.push_back(future.get());
+  }
+  return packetWorkers;
+}
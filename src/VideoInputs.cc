@@ -6,6 +6,12 @@
 #include "Seeking.hh"
 #include "spdlog/spdlog.h"
 #include "time/Time.hh"
+#include "time/TimeUtils.hh"
+#include "libav/DecoderThreads.hh"
+
+#include <algorithm>
+#include <optional>
+#include <thread>
 extern "C" {
 #include <libavcodec/avcodec.h>
 }
@@ -20,7 +26,7 @@ int SeekState::reset(int nSeeks, vivictpp::SeekCallback onFinished) {
   return seekId;
 }
 
-void SeekState::handleSeekFinished(int seekId, int seekPos, bool error) {
+void SeekState::handleSeekFinished(int seekId, vivictpp::time::Time seekPos, bool error) {
   std::lock_guard<std::mutex> lg(m);
   if(seekId != this->seekId) return;
   seekEndPos.push_back(seekPos);
@@ -35,50 +41,166 @@ void SeekState::handleSeekFinished(int seekId, int seekPos, bool error) {
 }
 
 
-VideoInputs::VideoInputs(VivictPPConfig vivictPPConfig):
+VideoInputs::VideoInputs(VivictPPConfig vivictPPConfig, std::shared_ptr<InputOpener> inputOpener):
   _leftFrameOffset(0),
   leftPtsOffset(0),
-  logger(vivictpp::logging::getOrCreateLogger("VideoInputs")) {
-  for (auto source: vivictPPConfig.sourceConfigs) {
-    auto packetWorker = std::shared_ptr<vivictpp::workers::PacketWorker>(
-      new vivictpp::workers::PacketWorker(source.path, source.formatOptions));
+  logger(vivictpp::logging::getOrCreateLogger("VideoInputs")),
+  downscaleToWindow(vivictPPConfig.downscaleToWindow),
+  prefetchFrames(vivictPPConfig.prefetchFrames),
+  historyFrames(vivictPPConfig.historyFrames) {
+  if (!inputOpener) {
+    inputOpener = std::make_shared<InputOpener>(vivictPPConfig.sourceConfigs);
+  }
+  openStartTime = inputOpener->getStartTime();
+  auto openedWorkers = inputOpener->get();
+
+  // The streams to decode are chosen before any decoder is created, so that
+  // the cpu cores can be divided between the decoders
+  struct PlannedDecoder {
+    MediaPipe &input;
+    std::shared_ptr<vivictpp::workers::PacketWorker> packetWorker;
+    AVStream *stream;
+    const SourceConfig &source;
+    vivictpp::libav::DecoderOptions decoderOptions;
+  };
+  std::vector<PlannedDecoder> plannedDecoders;
+  int plannedVideo = 0;
+  bool plannedAudio = false;
+  for (size_t i = 0; i < openedWorkers.size(); i++) {
+    const SourceConfig &source = vivictPPConfig.sourceConfigs[i];
+    auto packetWorker = openedWorkers[i];
+    packetWorker->setPriorityWeight(source.priorityWeight);
     packetWorkers.push_back(packetWorker);
-    if (!packetWorker->getVideoStreams().empty()) {
-      if (!leftInput.decoder) {
-        leftInput.packetWorker = packetWorker;
-        leftInput.decoder.reset(
-          new vivictpp::workers::DecoderWorker(packetWorker->getVideoStreams()[0],
-                                               source.filter, source.decoderOptions));
-        packetWorker->addDecoderWorker(leftInput.decoder);
-        leftInput.decoder->start();
-      } else if (!rightInput.decoder) {
-        rightInput.packetWorker = packetWorker;
-        rightInput.decoder.reset(
-          new vivictpp::workers::DecoderWorker(packetWorker->getVideoStreams()[0],
-                                               source.filter, source.decoderOptions));
-        packetWorker->addDecoderWorker(rightInput.decoder);
-        rightInput.decoder->start();
-      }
+    if (!packetWorker->getVideoStreams().empty() && plannedVideo < 2) {
+      plannedDecoders.push_back({plannedVideo == 0 ? leftInput : rightInput, packetWorker,
+                                 packetWorker->getVideoStreams()[0], source, source.decoderOptions});
+      plannedVideo++;
     }
+    if (!vivictPPConfig.disableAudio && !packetWorker->getAudioStreams().empty() && !plannedAudio) {
+      plannedDecoders.push_back({audio1, packetWorker, packetWorker->getAudioStreams()[0], source, {}});
+      plannedAudio = true;
+    }
+  }
 
-    if (!vivictPPConfig.disableAudio && !packetWorker->getAudioStreams().empty()) {
-      if (!audio1.decoder) {
-        audio1.packetWorker = packetWorker;
-        audio1.decoder.reset(
-          new vivictpp::workers::DecoderWorker(packetWorker->getAudioStreams()[0]));
-        packetWorker->addDecoderWorker(audio1.decoder);
-        audio1.decoder->start();
-      }
+  std::vector<double> costs;
+  std::vector<int> requestedThreads;
+  for (const auto &planned : plannedDecoders) {
+    costs.push_back(vivictpp::libav::decodingCost(planned.stream));
+    requestedThreads.push_back(planned.decoderOptions.threads);
+  }
+  int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  std::vector<int> threads = vivictpp::libav::divideDecoderThreads(costs, requestedThreads, cores);
+
+  for (size_t i = 0; i < plannedDecoders.size(); i++) {
+    PlannedDecoder &planned = plannedDecoders[i];
+    planned.decoderOptions.threads = threads[i];
+    logger->info("Decoding stream {} of {} with {} threads", planned.stream->index, planned.source.path, threads[i]);
+    bool video = planned.stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO;
+    planned.input.packetWorker = planned.packetWorker;
+    planned.input.decoder.reset(
+      new vivictpp::workers::DecoderWorker(planned.stream, video ? planned.source.filter : "",
+                                           planned.decoderOptions));
+    planned.input.decoder->setPriorityWeight(planned.source.priorityWeight);
+    planned.packetWorker->addDecoderWorker(planned.input.decoder);
+    if (video) {
+      createHistory(planned.input, planned.stream, planned.source, planned.decoderOptions,
+                    vivictPPConfig);
     }
+    planned.input.decoder->start();
+  }
 
+  for (auto &packetWorker : packetWorkers) {
     spdlog::trace("VideoInputs::VideoInputs starting packetWorker");
     packetWorker->start();
   }
+
+  if (vivictPPConfig.thumbnailInterval > 0) {
+    vivictpp::time::Time interval =
+      static_cast<vivictpp::time::Time>(vivictPPConfig.thumbnailInterval * vivictpp::time::TIME_BASE);
+    int video = 0;
+    for (const auto &planned : plannedDecoders) {
+      if (planned.stream->codecpar->codec_type != AVMEDIA_TYPE_VIDEO) {
+        continue;
+      }
+      const VideoMetadata &metadata = planned.packetWorker->getVideoMetadata()[0];
+      if (metadata.hasDuration()) {
+        thumbnailCaches[video] = std::make_shared<vivictpp::libav::ThumbnailCache>(
+          metadata.startTime, metadata.duration, interval);
+        thumbnailWorkers.emplace_back(new vivictpp::workers::ThumbnailWorker(
+          planned.source.path, planned.source.formatOptions, planned.stream->index,
+          planned.packetWorker->getFrameIndex(), thumbnailCaches[video]));
+        thumbnailWorkers.back()->start();
+      }
+      video++;
+    }
+  }
 }
 
+// Created before the decoder is started, since the drop listener must be set
+// before frames are written. Frames dropped by the frame buffer are only
+// kept if a number of history frames is configured.
+void VideoInputs::createHistory(MediaPipe &input, const AVStream *stream, const SourceConfig &source,
+                                const vivictpp::libav::DecoderOptions &decoderOptions,
+                                const VivictPPConfig &vivictPPConfig) {
+  if (vivictPPConfig.prefetchFrames <= 0 && vivictPPConfig.historyFrames <= 0) {
+    return;
+  }
+  if (vivictPPConfig.prefetchFrames > 0) {
+    input.decoder->frames().setMinFramesAhead(vivictPPConfig.prefetchFrames);
+  }
+  input.history = std::make_shared<vivictpp::workers::FrameHistory>(0);
+  input.historyWorker = std::make_shared<vivictpp::workers::HistoryWorker>(
+    source.path, source.formatOptions, stream, source.filter, decoderOptions,
+    input.packetWorker->getFrameIndex(), input.history,
+    // Room for the prefetched frames before they are compressed as well
+    vivictPPConfig.historyFrames + 2 * std::max(vivictPPConfig.prefetchFrames, 0));
+  if (vivictPPConfig.historyFrames > 0) {
+    std::shared_ptr<vivictpp::workers::FrameHistory> history = input.history;
+    std::weak_ptr<vivictpp::workers::HistoryWorker> historyWorker = input.historyWorker;
+    input.decoder->frames().setDropListener(
+      [history, historyWorker](const vivictpp::libav::Frame &frame, vivictpp::time::Time pts,
+                               vivictpp::time::Time nextPts) {
+        history->append(frame, pts, nextPts);
+        if (auto worker = historyWorker.lock()) {
+          worker->wakeup();
+        }
+      });
+  }
+  input.historyWorker->start();
+}
+
+// Frames between the buffered keyframes are missing when keyframes only were
+// demuxed, which is only what is wanted while that is still the case
 bool VideoInputs::ptsInRange(vivictpp::time::Time pts) {
-  return !vivictpp::time::isNoPts(pts) && leftInput.decoder->frames().ptsInRange(pts + leftPtsOffset) &&
-    (!rightInput.decoder || rightInput.decoder->frames().ptsInRange(pts));
+  if (keyframesOnlyBuffered && !keyframesOnly) {
+    return false;
+  }
+  return !vivictpp::time::isNoPts(pts) && ptsInRange(leftInput, pts + leftPtsOffset) &&
+    (!rightInput.decoder || ptsInRange(rightInput, pts));
+}
+
+bool VideoInputs::ptsInRange(MediaPipe &input, vivictpp::time::Time pts) {
+  vivictpp::workers::FrameBuffer &frames = input.decoder->frames();
+  if (frames.ptsInRange(pts)) {
+    return true;
+  }
+  return historyJoins(input) && input.history->firstPts() <= pts && pts < frames.minPts();
+}
+
+// The history keeps the frames around the one shown decompressed
+void VideoInputs::setHistoryPts(MediaPipe &input, vivictpp::time::Time pts) {
+  if (pts == input.historyPts) {
+    return;
+  }
+  input.historyPts = pts;
+  input.history->setPosition(pts);
+  input.historyWorker->wakeup();
+}
+
+// The history is only used while it ends right where the frame buffer starts
+bool VideoInputs::historyJoins(MediaPipe &input) {
+  vivictpp::workers::FrameBuffer &frames = input.decoder->frames();
+  return input.history && !frames.isEmpty() && input.history->joins(frames.minPts());
 }
 
 vivictpp::time::Time VideoInputs::duration() {
@@ -106,16 +228,47 @@ vivictpp::time::Time VideoInputs::startTime() {
 }
 
 void VideoInputs::stepForward(vivictpp::time::Time pts) {
-  leftInput.decoder->frames().stepForward(pts + leftPtsOffset);
+  stepForward(leftInput, pts + leftPtsOffset);
   if (rightInput.decoder)
-    rightInput.decoder->frames().stepForward(pts);
+    stepForward(rightInput, pts);
 }
 
+// Within the history the last frame at or before pts is shown, like in the
+// frame buffer
+void VideoInputs::stepForward(MediaPipe &input, vivictpp::time::Time pts) {
+  vivictpp::workers::FrameBuffer &frames = input.decoder->frames();
+  if (!vivictpp::time::isNoPts(input.historyPts)) {
+    if (historyJoins(input) && pts < frames.minPts()) {
+      vivictpp::time::Time historyPts = input.history->ptsAtOrBefore(pts);
+      if (!vivictpp::time::isNoPts(historyPts) && historyPts > input.historyPts) {
+        setHistoryPts(input, historyPts);
+      }
+      return;
+    }
+    setHistoryPts(input, vivictpp::time::NO_TIME);
+  }
+  frames.stepForward(pts);
+}
 
 void VideoInputs::stepBackward(vivictpp::time::Time pts) {
-  leftInput.decoder->frames().stepBackward(pts + leftPtsOffset);
+  stepBackward(leftInput, pts + leftPtsOffset);
   if (rightInput.decoder)
-    rightInput.decoder->frames().stepBackward(pts);
+    stepBackward(rightInput, pts);
+}
+
+// Like the frame buffer, the history steps to the first frame at or after
+// pts. The cursor of the frame buffer stays at its first frame while a
+// history frame is shown.
+void VideoInputs::stepBackward(MediaPipe &input, vivictpp::time::Time pts) {
+  vivictpp::workers::FrameBuffer &frames = input.decoder->frames();
+  if (historyJoins(input) && pts < frames.minPts()) {
+    vivictpp::time::Time historyPts = input.history->ptsAtOrAfter(pts);
+    if (!vivictpp::time::isNoPts(historyPts) &&
+        (vivictpp::time::isNoPts(input.historyPts) || historyPts < input.historyPts)) {
+      setHistoryPts(input, historyPts);
+    }
+  }
+  frames.stepBackward(pts);
 }
 
 void VideoInputs::dropIfFullAndNextOutOfRange(vivictpp::time::Time currentPts, int framesToDrop) {
@@ -138,34 +291,197 @@ void VideoInputs::dropIfFullAndOutOfRange(vivictpp::time::Time nextPts, int fram
   }
 }
 
+bool VideoInputs::firstFramesBuffered() {
+  if (firstFramesReady) {
+    return true;
+  }
+  std::pair<const char*, MediaPipe&> inputs[] = {{"left", leftInput}, {"right", rightInput}, {"audio", audio1}};
+  bool buffered = true;
+  for (auto &input : inputs) {
+    if (!input.second.decoder) {
+      continue;
+    }
+    if (input.second.decoder->frames().isEmpty()) {
+      buffered = false;
+    } else if (loggedFirstFrames.insert(input.first).second) {
+      logger->info("Time to first frame of {} input: {} ms", input.first,
+                   vivictpp::time::relativeTimeMillis() - openStartTime);
+    }
+  }
+  if (buffered) {
+    logger->info("Time to first frame: {} ms", vivictpp::time::relativeTimeMillis() - openStartTime);
+    firstFramesReady = true;
+  }
+  return buffered;
+}
+
 std::array<vivictpp::libav::Frame, 2> VideoInputs::firstFrames() {
-  std::array<vivictpp::libav::Frame, 2> result = {leftInput.decoder->frames().first(),
-                                                  rightInput.decoder ? rightInput.decoder->frames().first()
+  std::array<vivictpp::libav::Frame, 2> result = {first(leftInput),
+                                                  rightInput.decoder ? first(rightInput)
                                                   : vivictpp::libav::Frame::emptyFrame()};
   return result;
 }
 
+vivictpp::libav::Frame VideoInputs::first(MediaPipe &input) {
+  if (!vivictpp::time::isNoPts(input.historyPts)) {
+    vivictpp::libav::Frame frame = historyJoins(input) ? input.history->frame(input.historyPts)
+      : vivictpp::libav::Frame::emptyFrame();
+    if (!frame.empty()) {
+      return frame;
+    }
+    setHistoryPts(input, vivictpp::time::NO_TIME);
+  }
+  return input.decoder->frames().first();
+}
+
+std::array<std::vector<vivictpp::libav::Frame>, 2> VideoInputs::neighbourFrames(int distance) {
+  std::array<std::vector<vivictpp::libav::Frame>, 2> result;
+  MediaPipe *inputs[] = {&leftInput, &rightInput};
+  for (int i = 0; i < 2; i++) {
+    if (!inputs[i]->decoder) {
+      continue;
+    }
+    if (!vivictpp::time::isNoPts(inputs[i]->historyPts)) {
+      result[i] = inputs[i]->history->framesAround(inputs[i]->historyPts, distance);
+      continue;
+    }
+    vivictpp::workers::FrameBuffer &frames = inputs[i]->decoder->frames();
+    for (int d = 1; d <= distance; d++) {
+      for (int offset : {d, -d}) {
+        vivictpp::libav::Frame frame = frames.frameAt(offset);
+        if (!frame.empty()) {
+          result[i].push_back(frame);
+        }
+      }
+    }
+  }
+  return result;
+}
+
 void VideoInputs::seek(vivictpp::time::Time pts, vivictpp::SeekCallback onSeekFinished) {
   int nDecoders = 0;
   for (auto packetWorker : packetWorkers) {
     nDecoders += packetWorker->nDecoders();
   }
   int seekId = seekState.reset(nDecoders, onSeekFinished);
+  keyframesOnlyBuffered = keyframesOnly;
+  vivictpp::SeekToken token = seekSequence.next();
+  for (MediaPipe *input : {&leftInput, &rightInput}) {
+    // Clearing the history resets its position as well
+    input->historyPts = vivictpp::time::NO_TIME;
+    if (input->history) {
+      input->historyWorker->cancel();
+      input->history->clear();
+    }
+  }
   for (auto packetWorker : packetWorkers) {
     if (packetWorker == leftInput.packetWorker) {
       vivictpp::SeekCallback seekCallback = [this, seekId](vivictpp::time::Time seekEndPos, bool error) {
         this->seekState.handleSeekFinished(seekId, seekEndPos - leftPtsOffset, error);
       };
-      packetWorker->seek(pts + leftPtsOffset, seekCallback);
+      packetWorker->seek(pts + leftPtsOffset, seekCallback, token);
     } else {
       vivictpp::SeekCallback seekCallback = [this, seekId](vivictpp::time::Time seekEndPos, bool error) {
         this->seekState.handleSeekFinished(seekId, seekEndPos, error);
       };
-      packetWorker->seek(pts, seekCallback);
+      packetWorker->seek(pts, seekCallback, token);
     }
   }
 }
 
+void VideoInputs::prefetch() {
+  prefetch(leftInput);
+  if (rightInput.decoder) {
+    prefetch(rightInput);
+  }
+}
+
+// Frames are decoded before the history, or before the frame buffer while
+// the history is empty, when fewer than prefetchFrames frames are kept
+// before the frame shown. The start is found in the frame index if it
+// reaches that far.
+void VideoInputs::prefetch(MediaPipe &input) {
+  vivictpp::workers::FrameBuffer &frames = input.decoder->frames();
+  if (!input.historyWorker || prefetchFrames <= 0 || frames.isEmpty()) {
+    return;
+  }
+  vivictpp::time::Time bufferStart = frames.minPts();
+  vivictpp::time::Time endPts;
+  int framesBefore;
+  if (historyJoins(input)) {
+    if (input.history->full()) {
+      return;
+    }
+    endPts = input.history->firstPts();
+    framesBefore = vivictpp::time::isNoPts(input.historyPts)
+      ? frames.framesBehind() + input.history->size()
+      : input.history->framesBefore(input.historyPts);
+  } else {
+    vivictpp::time::Time historyEnd = input.history->endPts();
+    if (historyFrames > 0 && !vivictpp::time::isNoPts(historyEnd) && historyEnd < bufferStart) {
+      // The frames dropped by the frame buffer are on their way to the history
+      return;
+    }
+    input.history->clear();
+    endPts = bufferStart;
+    framesBefore = frames.framesBehind();
+  }
+  const VideoMetadata &metadata = input.packetWorker->getVideoMetadata()[0];
+  if (framesBefore >= prefetchFrames || endPts <= metadata.startTime) {
+    return;
+  }
+  vivictpp::time::Time startPts = endPts;
+  int found = 0;
+  for (; found < prefetchFrames; found++) {
+    vivictpp::time::Time previousPts =
+      input.packetWorker->getFrameIndex()->previousPts(input.decoder->streamIndex, startPts);
+    if (vivictpp::time::isNoPts(previousPts)) {
+      break;
+    }
+    startPts = previousPts;
+  }
+  startPts -= (prefetchFrames - found) * metadata.frameDuration;
+  input.historyWorker->prefetch(std::max(startPts, metadata.startTime), endPts);
+}
+
+void VideoInputs::stopPrefetching() {
+  for (MediaPipe *input : {&leftInput, &rightInput}) {
+    if (input->historyWorker) {
+      input->historyWorker->cancel();
+    }
+  }
+}
+
+std::array<std::shared_ptr<const vivictpp::libav::Thumbnail>, 2>
+VideoInputs::thumbnailsAt(vivictpp::time::Time pts) {
+  return {thumbnailCaches[0] ? thumbnailCaches[0]->at(pts + leftPtsOffset) : nullptr,
+          thumbnailCaches[1] ? thumbnailCaches[1]->at(pts) : nullptr};
+}
+
+void VideoInputs::setKeyframesOnly(bool keyframesOnly) {
+  this->keyframesOnly = keyframesOnly;
+  for (auto packetWorker : packetWorkers) {
+    packetWorker->setKeyframesOnly(keyframesOnly);
+  }
+}
+
+bool VideoInputs::setDownscaleResolution(Resolution resolution) {
+  if (!downscaleToWindow) {
+    return false;
+  }
+  if (resolution.w == downscaleResolution.w && resolution.h == downscaleResolution.h) {
+    return false;
+  }
+  bool moreDetail = downscaleResolution.w > 0 &&
+    (resolution.w <= 0 || resolution.w > downscaleResolution.w || resolution.h > downscaleResolution.h);
+  downscaleResolution = resolution;
+  leftInput.decoder->setDownscaleResolution(resolution);
+  if (rightInput.decoder) {
+    rightInput.decoder->setDownscaleResolution(resolution);
+  }
+  return moreDetail;
+}
+
 std::array<std::vector<VideoMetadata>, 2> VideoInputs::metadata() {
   std::array<std::vector<VideoMetadata>, 2> result = {
     leftInput.packetWorker->getVideoMetadata(),
@@ -173,6 +489,104 @@ std::array<std::vector<VideoMetadata>, 2> VideoInputs::metadata() {
   return result;
 }
 
+vivictpp::time::Time VideoInputs::nextPts() {
+  vivictpp::time::Time nextPtsL = nextPts(leftInput);
+  if (vivictpp::time::isNoPts(nextPtsL)) {
+    return nextPtsL;
+  }
+  nextPtsL -= leftPtsOffset;
+  if (!rightInput.decoder) {
+    return nextPtsL;
+  }
+  vivictpp::time::Time nextPtsR = nextPts(rightInput);
+  if (vivictpp::time::isNoPts(nextPtsR)) {
+    return nextPtsR;
+  }
+  return std::min(nextPtsL, nextPtsR);
+}
+
+vivictpp::time::Time VideoInputs::nextPts(MediaPipe &input) {
+  if (!vivictpp::time::isNoPts(input.historyPts)) {
+    vivictpp::time::Time nextPts = input.history->nextPts(input.historyPts);
+    return vivictpp::time::isNoPts(nextPts) ? input.decoder->frames().minPts() : nextPts;
+  }
+  return input.decoder->frames().nextPts();
+}
+
+vivictpp::time::Time VideoInputs::previousPts() {
+  vivictpp::time::Time ppl = previousPts(leftInput);
+  if (vivictpp::time::isNoPts(ppl)) {
+    return ppl;
+  }
+  ppl -= leftPtsOffset;
+  if (!rightInput.decoder) {
+    return ppl;
+  }
+  vivictpp::time::Time ppr = previousPts(rightInput);
+  if (vivictpp::time::isNoPts(ppr)) {
+    return ppr;
+  }
+  return std::max(ppl, ppr);
+}
+
+vivictpp::time::Time VideoInputs::previousPts(MediaPipe &input) {
+  if (!vivictpp::time::isNoPts(input.historyPts)) {
+    return input.history->previousPts(input.historyPts);
+  }
+  vivictpp::workers::FrameBuffer &frames = input.decoder->frames();
+  vivictpp::time::Time previousPts = frames.previousPts();
+  if (vivictpp::time::isNoPts(previousPts) && frames.framesBehind() == 0 && historyJoins(input)) {
+    previousPts = input.history->lastPts();
+  }
+  return previousPts;
+}
+
+vivictpp::time::Time VideoInputs::indexedNextPts(vivictpp::time::Time pts) {
+  vivictpp::time::Time nextPtsL = leftInput.packetWorker->getFrameIndex()->nextPts(
+    leftInput.decoder->streamIndex, pts + leftPtsOffset);
+  if (vivictpp::time::isNoPts(nextPtsL)) {
+    return nextPtsL;
+  }
+  nextPtsL -= leftPtsOffset;
+  if (!rightInput.decoder) {
+    return nextPtsL;
+  }
+  vivictpp::time::Time nextPtsR = rightInput.packetWorker->getFrameIndex()->nextPts(
+    rightInput.decoder->streamIndex, pts);
+  if (vivictpp::time::isNoPts(nextPtsR)) {
+    return nextPtsR;
+  }
+  return std::min(nextPtsL, nextPtsR);
+}
+
+vivictpp::time::Time VideoInputs::indexedPreviousPts(vivictpp::time::Time pts) {
+  vivictpp::time::Time previousPtsL = leftInput.packetWorker->getFrameIndex()->previousPts(
+    leftInput.decoder->streamIndex, pts + leftPtsOffset);
+  if (vivictpp::time::isNoPts(previousPtsL)) {
+    return previousPtsL;
+  }
+  previousPtsL -= leftPtsOffset;
+  if (!rightInput.decoder) {
+    return previousPtsL;
+  }
+  vivictpp::time::Time previousPtsR = rightInput.packetWorker->getFrameIndex()->previousPts(
+    rightInput.decoder->streamIndex, pts);
+  if (vivictpp::time::isNoPts(previousPtsR)) {
+    return previousPtsR;
+  }
+  return std::max(previousPtsL, previousPtsR);
+}
+
+vivictpp::time::Time VideoInputs::indexedKeyframeBefore(vivictpp::time::Time pts) {
+  std::optional<vivictpp::libav::IndexEntry> keyframe =
+    leftInput.packetWorker->getFrameIndex()->keyframeBefore(leftInput.decoder->streamIndex,
+                                                            pts + leftPtsOffset);
+  if (!keyframe) {
+    return vivictpp::time::NO_TIME;
+  }
+  return keyframe->pts - leftPtsOffset;
+}
+
 void VideoInputs::selectVideoStreamLeft(int streamIndex) {
   selectStream(leftInput, streamIndex);
 }
@@ -6,6 +6,8 @@
 
 #include "logging/Logging.hh"
 #include "time/Time.hh"
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <utility>
 
@@ -41,11 +43,13 @@ PlaybackState PlayerState::togglePlaying() {
 
 VivictPP::VivictPP(VivictPPConfig vivictPPConfig,
                    std::shared_ptr<EventScheduler> eventScheduler,
-                   vivictpp::audio::AudioOutputFactory &audioOutputFactory)
+                   vivictpp::audio::AudioOutputFactory &audioOutputFactory,
+                   std::shared_ptr<InputOpener> inputOpener)
   : state(),
     eventScheduler(eventScheduler),
-    videoInputs(vivictPPConfig),
+    videoInputs(vivictPPConfig, inputOpener),
     audioOutput(nullptr),
+    trickPlaySpeed(vivictPPConfig.trickPlaySpeed),
     logger(vivictpp::logging::getOrCreateLogger("VivictPP")),
     seeklog(vivictpp::logging::getOrCreateLogger("seeklog")){
   if (!vivictPPConfig.disableAudio && videoInputs.hasAudio()) {
@@ -101,9 +105,125 @@ int VivictPP::adjustPlaybackSpeed(int delta) {
   if (state.playbackSpeed == 0) {
     state.avSync.playbackStart(state.pts);
   }
+  updateTrickPlay();
   return state.playbackSpeed;
 }
 
+// At high speeds decoding every frame cannot keep up, so only keyframes are
+// decoded. Both inputs are reseeked when switching, so that decoding starts
+// over from a keyframe. Playback steps to the earliest next keyframe of the
+// two inputs, and each input shows its last keyframe at or before that.
+void VivictPP::updateTrickPlay() {
+  double speedFactor = std::pow(2.0, -state.playbackSpeed / 2.0);
+  bool trickPlay = trickPlaySpeed > 0 && speedFactor >= trickPlaySpeed;
+  if (trickPlay == state.trickPlay) {
+    return;
+  }
+  logger->info("Trick-play {} at speed x{:.2f}", trickPlay ? "started" : "stopped", speedFactor);
+  state.trickPlay = trickPlay;
+  videoInputs.setKeyframesOnly(trickPlay || state.scrubbing);
+  if (audioOutput && state.playbackState == PlaybackState::PLAYING) {
+    if (trickPlay) {
+      audioOutput->stop();
+    } else {
+      audioOutput->start();
+      queueAudio();
+    }
+  }
+  reseek();
+}
+
+// Seeks to the current position, so that the frames are decoded again
+void VivictPP::reseek() {
+  seekInputs(state.pts);
+}
+
+// Seeks the inputs also if pts is buffered
+void VivictPP::seekInputs(vivictpp::time::Time pts) {
+  state.seeking = true;
+  state.nextPts = pts;
+  videoInputs.seek(pts, [this](vivictpp::time::Time pos, bool error) {
+    this->eventScheduler->scheduleSeekFinished(pos, error);
+  });
+  eventScheduler->clearAdvanceFrame();
+}
+
+void VivictPP::startScrubbing() {
+  if (state.scrubbing) {
+    return;
+  }
+  seeklog->debug("VivictPP::startScrubbing");
+  state.scrubbing = true;
+  state.resumeAfterScrubbing = isPlaying();
+  if (state.resumeAfterScrubbing) {
+    togglePlaying();
+  }
+  state.scrubPts = vivictpp::time::NO_TIME;
+  state.refinePts = vivictpp::time::NO_TIME;
+  videoInputs.setKeyframesOnly(true);
+}
+
+// Scrubbing within one GOP keeps showing the same keyframe without seeking
+// again. Seeks issued faster than they finish are coalesced by the workers.
+void VivictPP::scrubTo(vivictpp::time::Time pts) {
+  if (!state.scrubbing) {
+    return;
+  }
+  pts = clampPts(pts);
+  vivictpp::time::Time keyframePts = videoInputs.indexedKeyframeBefore(pts);
+  vivictpp::time::Time previewPts =
+    vivictpp::time::isNoPts(keyframePts) ? pts : std::max(keyframePts, videoInputs.minPts());
+  if (previewPts == state.scrubPts) {
+    return;
+  }
+  seeklog->debug("VivictPP::scrubTo pts={} previewPts={}", pts, previewPts);
+  state.scrubPts = previewPts;
+  seekInputs(previewPts);
+}
+
+// A preview still being decoded is shown before the exact frame is sought,
+// see advanceFrame
+void VivictPP::stopScrubbing(vivictpp::time::Time pts) {
+  if (!state.scrubbing) {
+    return;
+  }
+  seeklog->debug("VivictPP::stopScrubbing pts={}", pts);
+  state.scrubbing = false;
+  videoInputs.setKeyframesOnly(state.trickPlay);
+  state.refinePts = clampPts(pts);
+  if (!state.seeking) {
+    refineScrubbing();
+  }
+}
+
+// The inputs are only sought if the exact frame is not buffered. If it is,
+// no seek finishes to resume playback paused by the drag, so it is resumed
+// here.
+void VivictPP::refineScrubbing() {
+  vivictpp::time::Time pts = state.refinePts;
+  seek(pts);
+  if (!state.seeking && state.resumeAfterScrubbing) {
+    state.resumeAfterScrubbing = false;
+    togglePlaying();
+  }
+}
+
+// During playback the frames decoded after the change have the new
+// resolution. When stopped, the frame shown is decoded again if it has less
+// detail than the new resolution needs.
+void VivictPP::setDownscaleResolution(Resolution resolution) {
+  if (videoInputs.setDownscaleResolution(resolution) &&
+      state.playbackState == PlaybackState::STOPPED && !state.seeking) {
+    logger->debug("VivictPP::setDownscaleResolution reseeking for {}x{}", resolution.w, resolution.h);
+    reseek();
+  }
+}
+
+// Audio is not played during trick-play, and only kept up with the video
+bool VivictPP::audioInRange(vivictpp::time::Time pts) {
+  return !audioOutput || state.trickPlay || state.scrubbing || videoInputs.audioFrames().ptsInRange(pts);
+}
+
 void VivictPP::advanceFrame() {
   logger->trace("VivictPP::advanceFrame pts={} nextPts={}", state.pts,
                 state.nextPts);
@@ -114,7 +234,7 @@ void VivictPP::advanceFrame() {
       return;
     }
   }
-  if (videoInputs.ptsInRange(state.nextPts) && (!audioOutput || videoInputs.audioFrames().ptsInRange(state.nextPts))) {
+  if (videoInputs.ptsInRange(state.nextPts) && audioInRange(state.nextPts)) {
     logger->trace("VivictPP::advanceFrame nextPts is in range {}",
                   state.nextPts);
     if (state.seeking) {
@@ -126,6 +246,9 @@ void VivictPP::advanceFrame() {
     } else {
       videoInputs.stepBackward(state.nextPts);
     }
+    if (audioOutput && state.trickPlay) {
+      videoInputs.audioFrames().stepForward(state.nextPts);
+    }
     state.pts = state.nextPts;
     bool wasSeeking = state.seeking;
     state.seeking = false;
@@ -147,6 +270,17 @@ void VivictPP::advanceFrame() {
     }
     state.lastFrameAdvance = vivictpp::time::relativeTimeMicros();
     eventScheduler->scheduleRefreshDisplay(0);
+    if (wasSeeking && !state.scrubbing) {
+      if (!vivictpp::time::isNoPts(state.refinePts)) {
+        refineScrubbing();
+      } else if (state.resumeAfterScrubbing) {
+        state.resumeAfterScrubbing = false;
+        togglePlaying();
+      }
+    }
+    if (state.playbackState == PlaybackState::STOPPED && !state.seeking && !state.scrubbing) {
+      videoInputs.prefetch();
+    }
   } else {
     logger->trace("VivictPP::advanceFrame nextPts is out of range {}", state.nextPts);
     videoInputs.dropIfFullAndNextOutOfRange(state.pts, state.seeking ? 0 : 1);
@@ -162,7 +296,7 @@ void VivictPP::queueAudio() {
   vivictpp::time::Time queueDuration = audioOutput->queueDuration();
   logger->debug("vivictPP::queueAudio queueDuration={} audioOutput->currentPts={}",
                queueDuration, audioOutput->currentPts());
-  if (state.playbackState != PlaybackState::PLAYING) {
+  if (state.playbackState != PlaybackState::PLAYING || state.trickPlay) {
     return;
   }
   if (queueDuration > 200000) {
@@ -189,10 +323,14 @@ void VivictPP::queueAudio() {
 }
 
 PlaybackState VivictPP::togglePlaying() {
+  if (state.playbackState == PlaybackState::STOPPED && !videoInputs.firstFramesBuffered()) {
+    logger->debug("VivictPP::togglePlaying inputs are still buffering");
+    return state.playbackState;
+  }
   if (state.togglePlaying() == PlaybackState::PLAYING) {
     audioSeek(state.pts);
     queueAudio();
-    if (audioOutput) {
+    if (audioOutput && !state.trickPlay) {
       audioOutput->start();
     }
     state.avSync.playbackStart(state.pts);
@@ -202,6 +340,7 @@ PlaybackState VivictPP::togglePlaying() {
     }
     */
     state.nextPts = state.pts;
+    videoInputs.stopPrefetching();
     eventScheduler->scheduleAdvanceFrame(0);
   } else {
     if (audioOutput) {
@@ -209,17 +348,20 @@ PlaybackState VivictPP::togglePlaying() {
     }
     eventScheduler->clearAdvanceFrame();
     eventScheduler->scheduleRefreshDisplay(0);
+    if (!state.seeking) {
+      videoInputs.prefetch();
+    }
   }
   return state.playbackState;
 }
 
 void VivictPP::seekPreviousFrame() {
   if (state.seeking) {
-    seek(state.nextPts - frameDuration);
+    seek(frameBefore(state.nextPts));
   } else {
     vivictpp::time::Time previousPts = videoInputs.previousPts();
     if (vivictpp::time::isNoPts(previousPts)) {
-      previousPts = state.pts - frameDuration;
+      previousPts = frameBefore(state.pts);
     }
     seek(previousPts);
   }
@@ -227,16 +369,28 @@ void VivictPP::seekPreviousFrame() {
 
 void VivictPP::seekNextFrame() {
   if (state.seeking) {
-    seek(state.nextPts + frameDuration);
+    seek(frameAfter(state.nextPts));
   } else {
     vivictpp::time::Time nextPts = videoInputs.nextPts();
     if (vivictpp::time::isNoPts(nextPts)) {
-      nextPts = state.pts + frameDuration;
+      nextPts = frameAfter(state.pts);
     }
     seek(nextPts);
   }
 }
 
+// The frame index gives exact frame times also for variable frame rate
+// content, the frame duration is only a guess
+vivictpp::time::Time VivictPP::frameBefore(vivictpp::time::Time pts) {
+  vivictpp::time::Time previousPts = videoInputs.indexedPreviousPts(pts);
+  return vivictpp::time::isNoPts(previousPts) ? pts - frameDuration : previousPts;
+}
+
+vivictpp::time::Time VivictPP::frameAfter(vivictpp::time::Time pts) {
+  vivictpp::time::Time nextPts = videoInputs.indexedNextPts(pts);
+  return vivictpp::time::isNoPts(nextPts) ? pts + frameDuration : nextPts;
+}
+
 void VivictPP::seekRelative(vivictpp::time::Time deltaT) {
   seeklog->debug("VivictPP::seekRelative deltaT={} pts={} nextPts={} seeking={}", deltaT, state.pts, state.nextPts, state.seeking);
   if (state.seeking) {
@@ -246,15 +400,19 @@ void VivictPP::seekRelative(vivictpp::time::Time deltaT) {
   }
 }
 
-void VivictPP::seek(vivictpp::time::Time nextPts) {
-  nextPts = std::max(nextPts, videoInputs.minPts());
+vivictpp::time::Time VivictPP::clampPts(vivictpp::time::Time pts) {
+  pts = std::max(pts, videoInputs.minPts());
   if (videoInputs.hasMaxPts()) {
-    nextPts = std::min(nextPts, videoInputs.maxPts());
+    pts = std::min(pts, videoInputs.maxPts());
   }
-  state.nextPts = nextPts;
+  return pts;
+}
+
+void VivictPP::seek(vivictpp::time::Time nextPts) {
+  state.nextPts = clampPts(nextPts);
+  state.refinePts = vivictpp::time::NO_TIME;
   seeklog->debug("VivictPP::seek pts={} nextPts={} seeking={}", state.pts, state.nextPts, state.seeking);
-  if (videoInputs.ptsInRange(state.nextPts) &&
-      (!audioOutput || videoInputs.audioFrames().ptsInRange(state.nextPts))) {
+  if (videoInputs.ptsInRange(state.nextPts) && audioInRange(state.nextPts)) {
     seeklog->debug("VivictPP::seek Seek pts in range");
     if (state.playbackState == PlaybackState::PLAYING) {
       togglePlaying();
@@ -0,0 +1,108 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "libav/CompressedFrame.hh"
+
+#include "libav/PlaneCodec.hh"
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+struct PlaneLayout {
+  int rowBytes;
+  int rows;
+  int sampleBytes;
+};
+
+// Empty if the data of the format is not plain samples in planes
+static std::vector<PlaneLayout> planeLayouts(AVPixelFormat format, int width, int height) {
+  const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+  if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM |
+                               AV_PIX_FMT_FLAG_PAL))) {
+    return {};
+  }
+  int linesizes[4];
+  if (av_image_fill_linesizes(linesizes, format, width) < 0) {
+    return {};
+  }
+  std::vector<PlaneLayout> layouts;
+  for (int plane = 0; plane < av_pix_fmt_count_planes(format); plane++) {
+    int rows = plane == 1 || plane == 2 ? AV_CEIL_RSHIFT(height, desc->log2_chroma_h) : height;
+    int sampleBytes = 1;
+    for (int c = 0; c < desc->nb_components; c++) {
+      if (desc->comp[c].plane == plane) {
+        sampleBytes = desc->comp[c].step;
+        break;
+      }
+    }
+    layouts.push_back({linesizes[plane], rows, sampleBytes});
+  }
+  return layouts;
+}
+
+std::shared_ptr<const vivictpp::libav::CompressedFrame>
+vivictpp::libav::CompressedFrame::compress(const Frame &frame) {
+  const AVFrame *avFrame = frame.avFrame();
+  if (!avFrame || avFrame->hw_frames_ctx) {
+    return nullptr;
+  }
+  std::vector<PlaneLayout> layouts =
+    planeLayouts(static_cast<AVPixelFormat>(avFrame->format), avFrame->width, avFrame->height);
+  if (layouts.empty()) {
+    return nullptr;
+  }
+  std::shared_ptr<CompressedFrame> compressed(new CompressedFrame());
+  for (size_t plane = 0; plane < layouts.size(); plane++) {
+    const PlaneLayout &layout = layouts[plane];
+    if (!avFrame->data[plane] || avFrame->linesize[plane] < layout.rowBytes) {
+      return nullptr;
+    }
+    compressed->planes.push_back(compressPlane(avFrame->data[plane], avFrame->linesize[plane],
+                                               layout.rowBytes, layout.rows, layout.sampleBytes));
+  }
+  Frame props;
+  if (av_frame_copy_props(props.avFrame(), avFrame) < 0) {
+    return nullptr;
+  }
+  props->format = avFrame->format;
+  props->width = avFrame->width;
+  props->height = avFrame->height;
+  compressed->props = props;
+  return compressed;
+}
+
+vivictpp::libav::Frame vivictpp::libav::CompressedFrame::decompress() const {
+  const AVFrame *propsFrame = props.avFrame();
+  Frame frame;
+  if (av_frame_copy_props(frame.avFrame(), propsFrame) < 0) {
+    return Frame::emptyFrame();
+  }
+  frame->format = propsFrame->format;
+  frame->width = propsFrame->width;
+  frame->height = propsFrame->height;
+  if (av_frame_get_buffer(frame.avFrame(), 0) < 0) {
+    return Frame::emptyFrame();
+  }
+  std::vector<PlaneLayout> layouts =
+    planeLayouts(static_cast<AVPixelFormat>(propsFrame->format), propsFrame->width,
+                 propsFrame->height);
+  for (size_t plane = 0; plane < layouts.size() && plane < planes.size(); plane++) {
+    const PlaneLayout &layout = layouts[plane];
+    if (!decompressPlane(planes[plane], frame->data[plane], frame->linesize[plane],
+                         layout.rowBytes, layout.rows, layout.sampleBytes)) {
+      return Frame::emptyFrame();
+    }
+  }
+  return frame;
+}
+
+size_t vivictpp::libav::CompressedFrame::byteSize() const {
+  size_t size = sizeof(CompressedFrame);
+  for (const auto &plane : planes) {
+    size += plane.size();
+  }
+  return size;
+}
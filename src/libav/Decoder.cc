@@ -5,7 +5,9 @@
 #include "libav/Decoder.hh"
 #include "libav/AVErrorUtils.hh"
 #include "libav/Utils.hh"
+#include <algorithm>
 #include <set>
+#include <string>
 
 extern "C" {
 #include <libavcodec/codec.h>
@@ -34,13 +36,57 @@ static enum AVPixelFormat getHwFormat(AVCodecContext *ctx,
 vivictpp::libav::Decoder::Decoder(AVCodecParameters *codecParameters,
                                   const DecoderOptions &decoderOptions)
     : codecContext(nullptr),
+      framePool(FramePool::create()),
+      nextFrame(framePool->get()),
       logger(vivictpp::logging::getOrCreateLogger("Decoder")),
       hwDeviceContext(nullptr),
       hwPixelFormat(AV_PIX_FMT_NONE),
-      swPixelFormat(AV_PIX_FMT_NONE){
+      swPixelFormat(AV_PIX_FMT_NONE),
+      skipFrame(AVDISCARD_DEFAULT){
   initCodecContext(codecParameters, decoderOptions);
   initHardwareContext(decoderOptions.hwAccel);
-  openCodec();
+  openCodec(decoderOptions);
+}
+
+// std::stoi accepts trailing garbage, and its exceptions do not say which
+// option was wrong
+static int parseCount(const std::string &key, const std::string &value) {
+  size_t parsed = 0;
+  int count = -1;
+  try {
+    count = std::stoi(value, &parsed);
+  } catch (const std::logic_error &) {
+  }
+  if (parsed != value.size() || count < 0) {
+    throw std::runtime_error("Invalid value for decoder option " + key + ": '" + value +
+                             "', expected a non-negative integer");
+  }
+  return count;
+}
+
+void vivictpp::libav::parseDecoderOptions(const std::string &options, DecoderOptions &decoderOptions) {
+  size_t start;
+  size_t end = 0;
+  while ((start = options.find_first_not_of(':', end)) != std::string::npos) {
+    end = options.find(':', start);
+    std::string keyValue = options.substr(start, end - start);
+    size_t index = keyValue.find('=');
+    std::string key = keyValue.substr(0, index);
+    std::string value = index == std::string::npos ? "" : keyValue.substr(index + 1);
+    if (key == "threads") {
+      decoderOptions.threads = parseCount(key, value);
+    } else if (key == "thread_type") {
+      decoderOptions.threadType = value;
+    } else if (key == "lowres") {
+      decoderOptions.lowres = parseCount(key, value);
+    } else if (key == "skip_loop_filter") {
+      decoderOptions.skipLoopFilter = value;
+    } else if (key == "gop_decoders") {
+      decoderOptions.gopDecoders = parseCount(key, value);
+    } else {
+      throw std::runtime_error("Unknown decoder option: " + key);
+    }
+  }
 }
 
 const AVCodec* findDecoder(AVCodecID codecId, const vivictpp::libav::DecoderOptions &decoderOptions) {
@@ -156,11 +202,28 @@ void vivictpp::libav::Decoder::initHardwareContext(std::string hwAccel) {
   codecContext->hw_device_ctx = av_buffer_ref(this->hwDeviceContext.get());
 }
 
-void vivictpp::libav::Decoder::openCodec() {
+void vivictpp::libav::Decoder::openCodec(const DecoderOptions &options) {
   AVDictionary *decoderOptions = nullptr;
-  av_dict_set(&decoderOptions, "threads", "auto", 0);
+  av_dict_set(&decoderOptions, "threads", options.threads > 0 ? std::to_string(options.threads).c_str() : "auto", 0);
+  if (!options.threadType.empty()) {
+    av_dict_set(&decoderOptions, "thread_type", options.threadType.c_str(), 0);
+  }
+  if (options.lowres > 0) {
+    av_dict_set_int(&decoderOptions, "lowres", options.lowres, 0);
+  }
+  if (!options.skipLoopFilter.empty()) {
+    av_dict_set(&decoderOptions, "skip_loop_filter", options.skipLoopFilter.c_str(), 0);
+  }
   vivictpp::libav::AVResult ret = avcodec_open2(codecContext.get(), codecContext->codec, &decoderOptions);
+  AVDictionaryEntry *unused = nullptr;
+  while ((unused = av_dict_get(decoderOptions, "", unused, AV_DICT_IGNORE_SUFFIX))) {
+    logger->warn("Decoder {} does not support option {}={}", codecContext->codec->name, unused->key, unused->value);
+  }
+  av_dict_free(&decoderOptions);
   ret.throwOnError("Failed to open codec");
+  skipFrame = codecContext->skip_frame;
+  logger->info("Opened decoder {} with {} threads, thread type {}", codecContext->codec->name,
+               codecContext->thread_count, codecContext->active_thread_type);
   logAudioCodecInfo();
 }
 
@@ -178,6 +241,10 @@ void vivictpp::libav::Decoder::logAudioCodecInfo() {
 
 void vivictpp::libav::Decoder::flush() { avcodec_flush_buffers(this->codecContext.get()); }
 
+void vivictpp::libav::Decoder::setPreroll(bool preroll) {
+  codecContext->skip_frame = preroll ? std::max(skipFrame, AVDISCARD_NONREF) : skipFrame;
+}
+
 std::vector<vivictpp::libav::Frame> vivictpp::libav::Decoder::handlePacket(Packet packet) {
   logger->trace("handlePacket");
   vivictpp::libav::AVResult ret = avcodec_send_packet(this->codecContext.get(),
@@ -187,12 +254,15 @@ std::vector<vivictpp::libav::Frame> vivictpp::libav::Decoder::handlePacket(Packe
   }
   std::vector<Frame> result;
   while ((ret = avcodec_receive_frame(this->codecContext.get(), nextFrame.avFrame())).success()) {
-    result.push_back(nextFrame);
-    nextFrame.reset();
+    result.push_back(std::move(nextFrame));
+    nextFrame = framePool->get();
   }
-  if (ret.error() && !ret.eagain()) {
+  if (ret.error() && !ret.eagain() && !ret.eof()) {
     throw std::runtime_error(std::string("Receive frame failed: ") + ret.getMessage());
   }
+  if (packet.empty()) {
+    flush();
+  }
   return result;
 }
 
@@ -0,0 +1,81 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "libav/DecoderThreads.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+// Rough decoding cost per pixel relative to H.264
+static double codecFactor(AVCodecID codecId) {
+  const AVCodecDescriptor *descriptor = avcodec_descriptor_get(codecId);
+  if (descriptor && (descriptor->props & AV_CODEC_PROP_INTRA_ONLY)) {
+    return 0.5;
+  }
+  switch (codecId) {
+  case AV_CODEC_ID_HEVC:
+  case AV_CODEC_ID_AV1:
+    return 2.0;
+  case AV_CODEC_ID_VP9:
+    return 1.5;
+  case AV_CODEC_ID_MPEG2VIDEO:
+    return 0.5;
+  default:
+    return 1.0;
+  }
+}
+
+double vivictpp::libav::decodingCost(const AVStream *stream) {
+  const AVCodecParameters *codecpar = stream->codecpar;
+  if (codecpar->codec_type != AVMEDIA_TYPE_VIDEO) {
+    return 0;
+  }
+  AVRational frameRate = stream->avg_frame_rate.num ? stream->avg_frame_rate : stream->r_frame_rate;
+  double fps = frameRate.num && frameRate.den ? av_q2d(frameRate) : 25.0;
+  return static_cast<double>(codecpar->width) * codecpar->height * fps * codecFactor(codecpar->codec_id);
+}
+
+std::vector<int> vivictpp::libav::divideDecoderThreads(const std::vector<double> &costs,
+                                                       const std::vector<int> &requested,
+                                                       int cores) {
+  std::vector<int> threads(costs.size(), 1);
+  int available = cores;
+  double totalCost = 0;
+  for (size_t i = 0; i < costs.size(); i++) {
+    if (requested[i] > 0) {
+      threads[i] = requested[i];
+      available -= requested[i];
+    } else {
+      available -= 1;
+      totalCost += costs[i];
+    }
+  }
+  if (available <= 0 || totalCost <= 0) {
+    return threads;
+  }
+  // Largest remainder, so that all available cores are handed out
+  std::vector<std::pair<double, size_t>> remainders;
+  int assigned = 0;
+  for (size_t i = 0; i < costs.size(); i++) {
+    if (requested[i] > 0) {
+      continue;
+    }
+    double share = available * costs[i] / totalCost;
+    int whole = static_cast<int>(std::floor(share));
+    threads[i] += whole;
+    assigned += whole;
+    remainders.emplace_back(share - whole, i);
+  }
+  std::sort(remainders.begin(), remainders.end(),
+            [](const auto &a, const auto &b) { return a.first > b.first; });
+  for (size_t k = 0; k < remainders.size() && assigned < available; k++, assigned++) {
+    threads[remainders[k].second]++;
+  }
+  return threads;
+}
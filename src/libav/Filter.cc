@@ -33,12 +33,14 @@ void freeFilterGraph(AVFilterGraph *graph) {
   avfilter_graph_free(&graph);
 }
 
-vivictpp::libav::Filter::Filter(std::string definition) :
+vivictpp::libav::Filter::Filter(std::string definition, std::shared_ptr<FramePool> framePool) :
   bufferSrcCtx(nullptr),
   bufferSinkCtx(nullptr),
   graph(nullptr),
   definition(definition),
-  eof_(false) {
+  eof_(false),
+  framePool(framePool),
+  nextFrame(framePool->get()) {
 }
 
 void vivictpp::libav::Filter::configureGraph(std::string definition) {
@@ -93,14 +95,15 @@ vivictpp::libav::Frame vivictpp::libav::Filter::filterFrame(const vivictpp::liba
   if (ret < 0) {
     throw std::runtime_error("Error getting frame from filtergraph");
   }
-  Frame frame = nextFrame;
-  nextFrame.reset();
+  Frame frame = std::move(nextFrame);
+  nextFrame = framePool->get();
   return frame;
 }
 
 vivictpp::libav::VideoFilter::VideoFilter(AVStream *videoStream, AVCodecContext *codecContext,
-                         std::string definition) :
-  Filter(definition),
+                         std::string definition,
+                         std::shared_ptr<FramePool> framePool) :
+  Filter(definition, framePool),
   formatParameters({videoStream->time_base, codecContext->width, codecContext->height, codecContext->pix_fmt, codecContext->pix_fmt, codecContext->sample_aspect_ratio})
 {
   configure();
@@ -204,8 +207,9 @@ FilteredVideoMetadata vivictpp::libav::VideoFilter::getFilteredVideoMetadata() {
     return FilteredVideoMetadata(definition, Resolution(w,h), frameRate);
 }
 
-vivictpp::libav::AudioFilter::AudioFilter(AVCodecContext *codecContext, std::string definition) :
-  Filter(definition) {
+vivictpp::libav::AudioFilter::AudioFilter(AVCodecContext *codecContext, std::string definition,
+                                          std::shared_ptr<FramePool> framePool) :
+  Filter(definition, framePool) {
   configure(codecContext, definition);
 }
 
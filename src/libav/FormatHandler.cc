@@ -4,6 +4,7 @@
 
 #include "libav/FormatHandler.hh"
 #include "libav/AVErrorUtils.hh"
+#include "libav/InputCache.hh"
 
 #include "spdlog/spdlog.h"
 
@@ -61,8 +62,11 @@ vivictpp::libav::FormatHandler::FormatHandler(std::string inputFile, std::string
     throw std::runtime_error(std::string("Failed to open input: ") + result.getMessage());
   }
 
-  // Retrieve stream information
-  if (avformat_find_stream_info(formatContext, nullptr) < 0) {
+  // Retrieve stream information, probing the input is slow so use the
+  // cached result if there is one
+  InputCache inputCache(this->inputFile);
+  if (!inputCache.restoreStreamInfo(formatContext) &&
+      avformat_find_stream_info(formatContext, nullptr) < 0) {
     throw std::runtime_error("Failed to find stream info");
   }
 
@@ -108,10 +112,35 @@ void vivictpp::libav::FormatHandler::setActiveStreams(const std::set<int> &activ
 
 void vivictpp::libav::FormatHandler::setStreamActive(int streamIndex) {
   spdlog::debug("FormatHandler::setStreamActive streamIndex={}", streamIndex);
-  this->formatContext->streams[streamIndex]->discard = AVDISCARD_DEFAULT;
+  this->formatContext->streams[streamIndex]->discard = activeDiscard(this->formatContext->streams[streamIndex]);
   activeStreams.insert(streamIndex);
 }
 
+void vivictpp::libav::FormatHandler::setKeyframesOnly(bool keyframesOnly) {
+  logger->debug("FormatHandler::setKeyframesOnly keyframesOnly={}", keyframesOnly);
+  this->keyframesOnly = keyframesOnly;
+  for (int streamIndex : activeStreams) {
+    this->formatContext->streams[streamIndex]->discard = activeDiscard(this->formatContext->streams[streamIndex]);
+  }
+}
+
+// Demuxers that support it skip reading non-keyframes altogether, for the
+// others non-keyframes are dropped in nextPacket
+AVDiscard vivictpp::libav::FormatHandler::activeDiscard(const AVStream *stream) const {
+  if (!keyframesOnly) {
+    return AVDISCARD_DEFAULT;
+  }
+  return stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+}
+
+bool vivictpp::libav::FormatHandler::skipPacket(const AVPacket *packet) const {
+  if (activeStreams.find(packet->stream_index) == activeStreams.end()) {
+    return true;
+  }
+  return keyframesOnly && !(packet->flags & AV_PKT_FLAG_KEY) &&
+    this->formatContext->streams[packet->stream_index]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO;
+}
+
 void vivictpp::libav::FormatHandler::setStreamInactive(int streamIndex) {
   this->formatContext->streams[streamIndex]->discard = AVDISCARD_ALL;
   activeStreams.erase(streamIndex);
@@ -119,7 +148,7 @@ void vivictpp::libav::FormatHandler::setStreamInactive(int streamIndex) {
 
 AVStream* firstActive(const std::vector<AVStream*> &streams) {
    auto it =std::find_if(streams.begin(), streams.end(), [](const AVStream* entry){
-      return entry->discard == AVDISCARD_DEFAULT;
+      return entry->discard != AVDISCARD_ALL;
     });
    return it == streams.end() ? nullptr : *it;
 }
@@ -133,6 +162,13 @@ void vivictpp::libav::FormatHandler::seek(vivictpp::time::Time t) {
   if (stream == nullptr) {
     return;
   }
+  std::optional<IndexEntry> keyframe = frameIndex ? frameIndex->keyframeBefore(stream->index, t)
+    : std::nullopt;
+  if (keyframe && seekToKeyframe(stream, *keyframe)) {
+    seeklog->debug("FormatHandler::seek Seeked to keyframe pts={}, {} frames to decode",
+                   keyframe->pts, frameIndex->framesBetween(stream->index, keyframe->pts, t));
+    return;
+  }
   vivictpp::time::Time seek_t = t;
   int flags = 0;
   /*
@@ -162,14 +198,33 @@ void vivictpp::libav::FormatHandler::seek(vivictpp::time::Time t) {
   }
 }
 
+bool vivictpp::libav::FormatHandler::seekToKeyframe(AVStream *stream, const IndexEntry &keyframe) {
+  vivictpp::libav::AVResult result;
+  // Timestamp seeking in formats with discontinuous timestamps, like MPEG-TS,
+  // is a search that may land on the wrong packet, seek to the byte position
+  // of the keyframe instead
+  const int flags = this->formatContext->iformat->flags;
+  if (keyframe.pos >= 0 && (flags & AVFMT_TS_DISCONT) && !(flags & AVFMT_NO_BYTE_SEEK)) {
+    result = av_seek_frame(this->formatContext, -1, keyframe.pos, AVSEEK_FLAG_BYTE);
+  } else {
+    result = av_seek_frame(this->formatContext, stream->index, keyframe.dts, AVSEEK_FLAG_BACKWARD);
+  }
+  if (result.error()) {
+    seeklog->warn("Seek to indexed keyframe failed: {}", result.getMessage());
+    return false;
+  }
+  return true;
+}
+
 AVPacket *vivictpp::libav::FormatHandler::nextPacket() {
   vivictpp::libav::AVResult ret;
   while ((ret = av_read_frame(this->formatContext, this->packet)).success()) {
       spdlog::debug("FormatHandler::nextPacket  Got packet: dts={} stream_index={} keyframe={}",
                     this->packet->dts, this->packet->stream_index, this->packet->flags & AV_PKT_FLAG_KEY);
-    if (activeStreams.find(packet->stream_index) != activeStreams.end()) {
+    if (!skipPacket(this->packet)) {
       return this->packet;
     }
+    av_packet_unref(this->packet);
   }
   if (ret.eof()) {
     return nullptr;
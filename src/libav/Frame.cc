@@ -4,8 +4,21 @@
 
 #include "libav/Frame.hh"
 
+#include <atomic>
+
 #include "libav/AVErrorUtils.hh"
 
+static std::atomic<uint64_t> allocatedFrames{0};
+
+AVFrame* vivictpp::libav::allocFrame() {
+  allocatedFrames.fetch_add(1, std::memory_order_relaxed);
+  return av_frame_alloc();
+}
+
+uint64_t vivictpp::libav::Frame::allocationCount() {
+  return allocatedFrames.load(std::memory_order_relaxed);
+}
+
 void vivictpp::libav::freeFrame(AVFrame* avFrame) {
   if (avFrame) {
     av_frame_free(&avFrame);
@@ -13,28 +26,15 @@ void vivictpp::libav::freeFrame(AVFrame* avFrame) {
 }
 
 vivictpp::libav::Frame::Frame():
-  frame(av_frame_alloc(), &freeFrame) {
+  frame(allocFrame(), &freeFrame) {
 }
 
 vivictpp::libav::Frame::Frame(AVFrame *frame):
   frame(frame, &freeFrame) {
 }
 
-vivictpp::libav::Frame::Frame(const Frame &otherFrame) {
-  if (otherFrame.frame) {
-    frame.reset(av_frame_clone(otherFrame.frame.get()), &freeFrame);
-  } else {
-    frame.reset((AVFrame*) nullptr, &freeFrame);
-  }
-}
-
-vivictpp::libav::Frame &vivictpp::libav::Frame::operator=(const Frame &otherFrame) {
-  if (otherFrame.frame) {
-    frame.reset(av_frame_clone(otherFrame.frame.get()), &freeFrame);
-  } else {
-    frame.reset((AVFrame*) nullptr, &freeFrame);
-  }
-  return *this;
+vivictpp::libav::Frame::Frame(std::shared_ptr<AVFrame> frame):
+  frame(std::move(frame)) {
 }
 
 vivictpp::libav::Frame vivictpp::libav::Frame::transferHwData(AVPixelFormat swPixelFormat) {
@@ -54,12 +54,22 @@ vivictpp::libav::Frame vivictpp::libav::Frame::transferHwData(AVPixelFormat swPi
   return swFrame;
 }
 
-/*
-  Frame(const Frame &frame);
-  ~Frame() = default;
-  Frame &operator=(const Frame &frame);
- */
+size_t vivictpp::libav::Frame::byteSize() const {
+  if (!frame) {
+    return 0;
+  }
+  size_t size = 0;
+  for (AVBufferRef *buf : frame->buf) {
+    if (buf) {
+      size += buf->size;
+    }
+  }
+  for (int i = 0; i < frame->nb_extended_buf; i++) {
+    size += frame->extended_buf[i]->size;
+  }
+  return size;
+}
 
 void vivictpp::libav::Frame::reset() {
-  frame.reset(av_frame_alloc(), &freeFrame);
+  frame.reset(allocFrame(), &freeFrame);
 }
@@ -0,0 +1,125 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "libav/FrameIndex.hh"
+
+#include <algorithm>
+
+using vivictpp::libav::IndexEntry;
+
+static bool ptsLess(const IndexEntry &a, const IndexEntry &b) {
+  return a.pts < b.pts;
+}
+
+static IndexEntry atPts(vivictpp::time::Time pts) {
+  return {pts, 0, -1, 0, false};
+}
+
+vivictpp::libav::FrameIndex::FrameIndex(size_t nStreams):
+  streams(nStreams) {
+}
+
+void vivictpp::libav::FrameIndex::add(int streamIndex, const IndexEntry &entry,
+                                      vivictpp::time::Time dtsTime) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  StreamIndex *stream = this->streamIndex(streamIndex);
+  if (!stream) {
+    return;
+  }
+  // Packets come in decoding order, so the entry belongs at or near the end
+  auto it = std::upper_bound(stream->entries.begin(), stream->entries.end(), entry, ptsLess);
+  stream->entries.insert(it, entry);
+  if (!vivictpp::time::isNoPts(dtsTime) &&
+      (vivictpp::time::isNoPts(stream->scannedUntil) || dtsTime > stream->scannedUntil)) {
+    stream->scannedUntil = dtsTime;
+  }
+}
+
+void vivictpp::libav::FrameIndex::setComplete() {
+  const std::lock_guard<std::mutex> lock(mutex);
+  complete = true;
+}
+
+bool vivictpp::libav::FrameIndex::isComplete() {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return complete;
+}
+
+size_t vivictpp::libav::FrameIndex::size(int streamIndex) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  StreamIndex *stream = this->streamIndex(streamIndex);
+  return stream ? stream->entries.size() : 0;
+}
+
+std::vector<IndexEntry> vivictpp::libav::FrameIndex::entries(int streamIndex) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  StreamIndex *stream = this->streamIndex(streamIndex);
+  return stream ? stream->entries : std::vector<IndexEntry>();
+}
+
+std::optional<IndexEntry> vivictpp::libav::FrameIndex::keyframeBefore(int streamIndex,
+                                                                      vivictpp::time::Time t) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  StreamIndex *stream = this->streamIndex(streamIndex);
+  if (!stream || !covers(*stream, t)) {
+    return std::nullopt;
+  }
+  auto it = std::upper_bound(stream->entries.begin(), stream->entries.end(), atPts(t), ptsLess);
+  while (it != stream->entries.begin()) {
+    --it;
+    if (it->keyframe) {
+      return *it;
+    }
+  }
+  return std::nullopt;
+}
+
+int vivictpp::libav::FrameIndex::framesBetween(int streamIndex, vivictpp::time::Time from,
+                                               vivictpp::time::Time to) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  StreamIndex *stream = this->streamIndex(streamIndex);
+  if (!stream || !covers(*stream, to)) {
+    return -1;
+  }
+  auto first = std::lower_bound(stream->entries.begin(), stream->entries.end(), atPts(from), ptsLess);
+  auto last = std::upper_bound(first, stream->entries.end(), atPts(to), ptsLess);
+  return static_cast<int>(last - first);
+}
+
+vivictpp::time::Time vivictpp::libav::FrameIndex::nextPts(int streamIndex, vivictpp::time::Time t) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  StreamIndex *stream = this->streamIndex(streamIndex);
+  if (!stream) {
+    return vivictpp::time::NO_TIME;
+  }
+  auto it = std::upper_bound(stream->entries.begin(), stream->entries.end(), atPts(t), ptsLess);
+  if (it == stream->entries.end() || !covers(*stream, it->pts)) {
+    return vivictpp::time::NO_TIME;
+  }
+  return it->pts;
+}
+
+vivictpp::time::Time vivictpp::libav::FrameIndex::previousPts(int streamIndex, vivictpp::time::Time t) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  StreamIndex *stream = this->streamIndex(streamIndex);
+  if (!stream || !covers(*stream, t)) {
+    return vivictpp::time::NO_TIME;
+  }
+  auto it = std::lower_bound(stream->entries.begin(), stream->entries.end(), atPts(t), ptsLess);
+  if (it == stream->entries.begin()) {
+    return vivictpp::time::NO_TIME;
+  }
+  return (--it)->pts;
+}
+
+bool vivictpp::libav::FrameIndex::covers(const StreamIndex &stream, vivictpp::time::Time t) const {
+  return complete || (!vivictpp::time::isNoPts(stream.scannedUntil) && t <= stream.scannedUntil);
+}
+
+vivictpp::libav::FrameIndex::StreamIndex *vivictpp::libav::FrameIndex::streamIndex(int streamIndex) {
+  if (streamIndex < 0 || static_cast<size_t>(streamIndex) >= streams.size()) {
+    return nullptr;
+  }
+  return &streams[streamIndex];
+}
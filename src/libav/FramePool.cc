@@ -0,0 +1,53 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "libav/FramePool.hh"
+
+std::shared_ptr<vivictpp::libav::FramePool> vivictpp::libav::FramePool::create(size_t maxIdleFrames) {
+  return std::shared_ptr<FramePool>(new FramePool(maxIdleFrames));
+}
+
+vivictpp::libav::FramePool::FramePool(size_t maxIdleFrames):
+  maxIdleFrames(maxIdleFrames) {
+  idle.reserve(maxIdleFrames);
+}
+
+vivictpp::libav::FramePool::~FramePool() {
+  for (AVFrame *avFrame : idle) {
+    freeFrame(avFrame);
+  }
+}
+
+vivictpp::libav::Frame vivictpp::libav::FramePool::get() {
+  AVFrame *avFrame = nullptr;
+  {
+    const std::lock_guard<std::mutex> lock(mutex);
+    if (!idle.empty()) {
+      avFrame = idle.back();
+      idle.pop_back();
+    }
+  }
+  if (!avFrame) {
+    avFrame = allocFrame();
+  }
+  std::shared_ptr<FramePool> pool = shared_from_this();
+  return Frame(std::shared_ptr<AVFrame>(avFrame, [pool](AVFrame *f) { pool->recycle(f); }));
+}
+
+size_t vivictpp::libav::FramePool::idleFrames() {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return idle.size();
+}
+
+void vivictpp::libav::FramePool::recycle(AVFrame *avFrame) {
+  av_frame_unref(avFrame);
+  {
+    const std::lock_guard<std::mutex> lock(mutex);
+    if (idle.size() < maxIdleFrames) {
+      idle.push_back(avFrame);
+      return;
+    }
+  }
+  freeFrame(avFrame);
+}
@@ -0,0 +1,420 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "libav/InputCache.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <type_traits>
+
+extern "C" {
+#include <sys/stat.h>
+#include <unistd.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/mem.h>
+}
+
+static const char MAGIC[8] = "VIVPIDX";
+static const char THUMBNAIL_MAGIC[8] = "VIVPTHB";
+// Bump when the layout of the cache file changes
+static const uint32_t VERSION = 2;
+// Sanity limits for values read from the cache file
+static const uint32_t MAX_STREAMS = 4096;
+static const uint32_t MAX_STRING = 1 << 16;
+static const uint64_t MAX_ENTRIES = 1 << 28;
+static const int MAX_THUMBNAIL_SIZE = 4096;
+
+bool vivictpp::libav::InputCache::enabled = true;
+
+template <class T>
+static void write(std::ostream &out, const T &value) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <class T>
+static bool read(std::istream &in, T &value) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+template <class T>
+static void writeVector(std::ostream &out, const std::vector<T> &values) {
+  write(out, static_cast<uint64_t>(values.size()));
+  out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+template <class T>
+static bool readVector(std::istream &in, std::vector<T> &values, uint64_t maxSize) {
+  uint64_t size;
+  if (!read(in, size) || size > maxSize) {
+    return false;
+  }
+  values.resize(size);
+  return static_cast<bool>(in.read(reinterpret_cast<char*>(values.data()), size * sizeof(T)));
+}
+
+// Thumbnails are yuv420p with even dimensions, the size of their data is
+// fixed by the dimensions. Returns 0 for dimensions that are not valid.
+static size_t thumbnailBytes(int width, int height) {
+  if (width <= 0 || width > MAX_THUMBNAIL_SIZE || width % 2 != 0 ||
+      height <= 0 || height > MAX_THUMBNAIL_SIZE || height % 2 != 0) {
+    return 0;
+  }
+  return static_cast<size_t>(width) * height * 3 / 2;
+}
+
+static std::string cacheDirectory() {
+  if (const char *cacheHome = std::getenv("XDG_CACHE_HOME")) {
+    return std::string(cacheHome) + "/vivictpp";
+  }
+  if (const char *home = std::getenv("HOME")) {
+    return std::string(home) + "/.cache/vivictpp";
+  }
+  return "";
+}
+
+void vivictpp::libav::InputCache::setEnabled(bool enabled) {
+  InputCache::enabled = enabled;
+}
+
+vivictpp::libav::InputCache::InputCache(const std::string &inputFile):
+  logger(vivictpp::logging::getOrCreateLogger("InputCache")),
+  inputFile(inputFile) {
+  struct stat st;
+  if (!enabled || stat(inputFile.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+    return;
+  }
+  std::string directory = cacheDirectory();
+  if (directory.empty()) {
+    return;
+  }
+  std::error_code error;
+  absolutePath = std::filesystem::absolute(inputFile, error).string();
+  if (error) {
+    return;
+  }
+  std::ostringstream name;
+  name << directory << "/" << std::hex << std::hash<std::string>()(absolutePath) << ".index";
+  cacheFile = name.str();
+  fileSize = st.st_size;
+  modificationTime = st.st_mtime;
+}
+
+void vivictpp::libav::InputCache::writeHeader(std::ostream &out, const char *magic) const {
+  out.write(magic, sizeof(MAGIC));
+  write(out, VERSION);
+  writeVector(out, std::vector<char>(absolutePath.begin(), absolutePath.end()));
+  write(out, fileSize);
+  write(out, modificationTime);
+}
+
+bool vivictpp::libav::InputCache::readHeader(std::istream &in, const char *expectedMagic) const {
+  char magic[sizeof(MAGIC)];
+  uint32_t version;
+  std::vector<char> path;
+  int64_t size;
+  int64_t mtime;
+  return in.read(magic, sizeof(magic)) && std::memcmp(magic, expectedMagic, sizeof(MAGIC)) == 0 &&
+    read(in, version) && version == VERSION &&
+    readVector(in, path, MAX_STRING) && std::string(path.begin(), path.end()) == absolutePath &&
+    read(in, size) && size == fileSize &&
+    read(in, mtime) && mtime == modificationTime;
+}
+
+bool vivictpp::libav::InputCache::load(bool withIndex) {
+  if (cacheFile.empty()) {
+    return false;
+  }
+  std::ifstream in(cacheFile, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  if (!readHeader(in, MAGIC)) {
+    logger->debug("No valid cache entry for {}", inputFile);
+    return false;
+  }
+  uint32_t nStreams;
+  if (!read(in, startTime) || !read(in, duration) || !read(in, bitRate) ||
+      !read(in, nStreams) || nStreams > MAX_STREAMS) {
+    return false;
+  }
+  streams.resize(nStreams);
+  for (auto &stream : streams) {
+    if (!read(in, stream.params) || !readVector(in, stream.extradata, MAX_ENTRIES)) {
+      return false;
+    }
+  }
+  if (withIndex) {
+    index.resize(nStreams);
+    for (auto &entries : index) {
+      if (!readVector(in, entries, MAX_ENTRIES)) {
+        logger->warn("Cache entry {} for {} is truncated", cacheFile, inputFile);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool vivictpp::libav::InputCache::matches(AVFormatContext *formatContext) const {
+  if (formatContext->nb_streams != streams.size()) {
+    return false;
+  }
+  for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+    const AVCodecParameters *codecpar = formatContext->streams[i]->codecpar;
+    if (codecpar->codec_type != streams[i].params.codecType ||
+        codecpar->codec_id != streams[i].params.codecId) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool vivictpp::libav::InputCache::restoreStreamInfo(AVFormatContext *formatContext) {
+  if (!load(false) || !matches(formatContext)) {
+    return false;
+  }
+  formatContext->start_time = startTime;
+  formatContext->duration = duration;
+  formatContext->bit_rate = bitRate;
+  for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+    AVStream *stream = formatContext->streams[i];
+    AVCodecParameters *codecpar = stream->codecpar;
+    const StreamParams &params = streams[i].params;
+    codecpar->format = params.format;
+    codecpar->width = params.width;
+    codecpar->height = params.height;
+    codecpar->sample_rate = params.sampleRate;
+#if LIBAVCODEC_VERSION_MAJOR >= 59
+    if (codecpar->ch_layout.nb_channels == 0 && params.channels > 0) {
+      if (params.channelMask) {
+        av_channel_layout_from_mask(&codecpar->ch_layout, params.channelMask);
+      } else {
+        av_channel_layout_default(&codecpar->ch_layout, params.channels);
+      }
+    }
+#else
+    if (codecpar->channels == 0) {
+      codecpar->channels = params.channels;
+      codecpar->channel_layout = params.channelMask;
+    }
+#endif
+    codecpar->frame_size = params.frameSize;
+    codecpar->bit_rate = params.bitRate;
+    codecpar->profile = params.profile;
+    codecpar->level = params.level;
+    codecpar->sample_aspect_ratio = params.sampleAspectRatio;
+    codecpar->codec_tag = params.codecTag;
+    codecpar->bits_per_coded_sample = params.bitsPerCodedSample;
+    codecpar->bits_per_raw_sample = params.bitsPerRawSample;
+    codecpar->block_align = params.blockAlign;
+    codecpar->video_delay = params.videoDelay;
+    codecpar->field_order = static_cast<AVFieldOrder>(params.fieldOrder);
+    codecpar->color_range = static_cast<AVColorRange>(params.colorRange);
+    codecpar->color_primaries = static_cast<AVColorPrimaries>(params.colorPrimaries);
+    codecpar->color_trc = static_cast<AVColorTransferCharacteristic>(params.colorTrc);
+    codecpar->color_space = static_cast<AVColorSpace>(params.colorSpace);
+    codecpar->chroma_location = static_cast<AVChromaLocation>(params.chromaLocation);
+    stream->time_base = params.timeBase;
+    stream->r_frame_rate = params.rFrameRate;
+    stream->avg_frame_rate = params.avgFrameRate;
+    stream->start_time = params.startTime;
+    stream->duration = params.duration;
+    stream->nb_frames = params.nbFrames;
+    const std::vector<uint8_t> &extradata = streams[i].extradata;
+    if (!codecpar->extradata && !extradata.empty()) {
+      codecpar->extradata = static_cast<uint8_t*>(av_mallocz(extradata.size() + AV_INPUT_BUFFER_PADDING_SIZE));
+      std::memcpy(codecpar->extradata, extradata.data(), extradata.size());
+      codecpar->extradata_size = static_cast<int>(extradata.size());
+    }
+  }
+  logger->info("Restored stream info of {} from {}", inputFile, cacheFile);
+  return true;
+}
+
+bool vivictpp::libav::InputCache::restoreFrameIndex(FrameIndex &frameIndex) {
+  if (!load(true) || index.size() != frameIndex.streamCount()) {
+    return false;
+  }
+  for (size_t i = 0; i < index.size(); i++) {
+    for (const auto &entry : index[i]) {
+      frameIndex.add(static_cast<int>(i), entry, vivictpp::time::NO_TIME);
+    }
+  }
+  frameIndex.setComplete();
+  logger->info("Restored frame index of {} from {}", inputFile, cacheFile);
+  return true;
+}
+
+bool vivictpp::libav::InputCache::writeFile(const std::string &file,
+                                            const std::function<void(std::ostream &)> &writeContent) {
+  std::error_code error;
+  std::filesystem::create_directories(std::filesystem::path(file).parent_path(), error);
+  if (error) {
+    logger->warn("Failed to create cache directory for {}: {}", file, error.message());
+    return false;
+  }
+  std::string tmpFile = file + ".XXXXXX";
+  int fd = mkstemp(tmpFile.data());
+  if (fd < 0) {
+    logger->warn("Failed to create temporary file for {}", file);
+    return false;
+  }
+  close(fd);
+  {
+    std::ofstream out(tmpFile, std::ios::binary | std::ios::trunc);
+    writeContent(out);
+    if (!out) {
+      logger->warn("Failed to write cache file {}", tmpFile);
+      out.close();
+      std::remove(tmpFile.c_str());
+      return false;
+    }
+  }
+  if (std::rename(tmpFile.c_str(), file.c_str()) != 0) {
+    logger->warn("Failed to rename {} to {}", tmpFile, file);
+    std::remove(tmpFile.c_str());
+    return false;
+  }
+  return true;
+}
+
+void vivictpp::libav::InputCache::save(AVFormatContext *formatContext, FrameIndex &frameIndex) {
+  if (cacheFile.empty()) {
+    return;
+  }
+  bool saved = writeFile(cacheFile, [&](std::ostream &out) {
+    writeHeader(out, MAGIC);
+    write(out, formatContext->start_time);
+    write(out, formatContext->duration);
+    write(out, formatContext->bit_rate);
+    write(out, static_cast<uint32_t>(formatContext->nb_streams));
+    for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+      const AVStream *stream = formatContext->streams[i];
+      const AVCodecParameters *codecpar = stream->codecpar;
+      StreamParams params;
+      std::memset(&params, 0, sizeof(params));
+      params.codecType = codecpar->codec_type;
+      params.codecId = codecpar->codec_id;
+      params.format = codecpar->format;
+      params.width = codecpar->width;
+      params.height = codecpar->height;
+      params.sampleRate = codecpar->sample_rate;
+#if LIBAVCODEC_VERSION_MAJOR >= 59
+      params.channels = codecpar->ch_layout.nb_channels;
+      params.channelMask = codecpar->ch_layout.order == AV_CHANNEL_ORDER_NATIVE ?
+        codecpar->ch_layout.u.mask : 0;
+#else
+      params.channels = codecpar->channels;
+      params.channelMask = codecpar->channel_layout;
+#endif
+      params.frameSize = codecpar->frame_size;
+      params.bitRate = codecpar->bit_rate;
+      params.profile = codecpar->profile;
+      params.level = codecpar->level;
+      params.sampleAspectRatio = codecpar->sample_aspect_ratio;
+      params.codecTag = codecpar->codec_tag;
+      params.bitsPerCodedSample = codecpar->bits_per_coded_sample;
+      params.bitsPerRawSample = codecpar->bits_per_raw_sample;
+      params.blockAlign = codecpar->block_align;
+      params.videoDelay = codecpar->video_delay;
+      params.fieldOrder = codecpar->field_order;
+      params.colorRange = codecpar->color_range;
+      params.colorPrimaries = codecpar->color_primaries;
+      params.colorTrc = codecpar->color_trc;
+      params.colorSpace = codecpar->color_space;
+      params.chromaLocation = codecpar->chroma_location;
+      params.timeBase = stream->time_base;
+      params.rFrameRate = stream->r_frame_rate;
+      params.avgFrameRate = stream->avg_frame_rate;
+      params.startTime = stream->start_time;
+      params.duration = stream->duration;
+      params.nbFrames = stream->nb_frames;
+      write(out, params);
+      writeVector(out, std::vector<uint8_t>(codecpar->extradata,
+                                            codecpar->extradata + std::max(codecpar->extradata_size, 0)));
+    }
+    for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
+      writeVector(out, frameIndex.entries(static_cast<int>(i)));
+    }
+  });
+  if (saved) {
+    logger->info("Saved stream info and frame index of {} to {}", inputFile, cacheFile);
+  }
+}
+
+std::string vivictpp::libav::InputCache::thumbnailFile(int streamIndex) const {
+  // Next to the index entry, which ends with .index
+  return cacheFile.substr(0, cacheFile.rfind('.')) + "." + std::to_string(streamIndex) + ".thumbnails";
+}
+
+bool vivictpp::libav::InputCache::restoreThumbnails(int streamIndex, ThumbnailCache &thumbnails) {
+  if (cacheFile.empty()) {
+    return false;
+  }
+  std::ifstream in(thumbnailFile(streamIndex), std::ios::binary);
+  int64_t start;
+  int64_t interval;
+  uint64_t slotCount;
+  if (!in || !readHeader(in, THUMBNAIL_MAGIC) ||
+      !read(in, start) || start != thumbnails.getStartTime() ||
+      !read(in, interval) || interval != thumbnails.getInterval() ||
+      !read(in, slotCount) || slotCount != thumbnails.slotCount()) {
+    return false;
+  }
+  std::vector<std::shared_ptr<const Thumbnail>> restored;
+  for (uint64_t i = 0; i < slotCount; i++) {
+    auto thumbnail = std::make_shared<Thumbnail>();
+    if (!read(in, thumbnail->pts) || !read(in, thumbnail->width) || !read(in, thumbnail->height)) {
+      logger->warn("Thumbnail cache entry for {} is truncated", inputFile);
+      return false;
+    }
+    size_t expectedBytes = thumbnailBytes(thumbnail->width, thumbnail->height);
+    if (expectedBytes == 0 || !readVector(in, thumbnail->data, expectedBytes) ||
+        thumbnail->data.size() != expectedBytes) {
+      logger->warn("Thumbnail cache entry for {} is truncated or corrupt", inputFile);
+      return false;
+    }
+    restored.push_back(thumbnail);
+  }
+  for (size_t i = 0; i < restored.size(); i++) {
+    thumbnails.set(i, restored[i]);
+  }
+  logger->info("Restored {} thumbnails of {} from {}", slotCount, inputFile, thumbnailFile(streamIndex));
+  return true;
+}
+
+// Only complete sets of thumbnails are saved
+void vivictpp::libav::InputCache::saveThumbnails(int streamIndex, ThumbnailCache &thumbnails) {
+  if (cacheFile.empty()) {
+    return;
+  }
+  std::vector<std::shared_ptr<const Thumbnail>> slots = thumbnails.thumbnails();
+  if (std::any_of(slots.begin(), slots.end(), [](const auto &thumbnail) { return !thumbnail; })) {
+    return;
+  }
+  bool saved = writeFile(thumbnailFile(streamIndex), [&](std::ostream &out) {
+    writeHeader(out, THUMBNAIL_MAGIC);
+    write(out, static_cast<int64_t>(thumbnails.getStartTime()));
+    write(out, static_cast<int64_t>(thumbnails.getInterval()));
+    write(out, static_cast<uint64_t>(slots.size()));
+    for (const auto &thumbnail : slots) {
+      write(out, thumbnail->pts);
+      write(out, thumbnail->width);
+      write(out, thumbnail->height);
+      writeVector(out, thumbnail->data);
+    }
+  });
+  if (saved) {
+    logger->info("Saved {} thumbnails of {} to {}", slots.size(), inputFile, thumbnailFile(streamIndex));
+  }
+}
@@ -16,6 +16,6 @@ vivictpp::libav::Packet::Packet():
 vivictpp::libav::Packet::Packet(AVPacket *pkt):
   packet(pkt ? av_packet_clone(pkt) : pkt, &freePacket) {}
 
-AVPacket* vivictpp::libav::Packet::avPacket() {
+AVPacket* vivictpp::libav::Packet::avPacket() const {
   return packet.get();
 }
@@ -0,0 +1,161 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "libav/PlaneCodec.hh"
+
+#include <algorithm>
+#include <cstring>
+
+static constexpr int BLOCK_SIZE = 16;
+
+// Maps small negative and positive residuals to small values
+static inline uint8_t zigzag(uint8_t residual) {
+  return static_cast<uint8_t>((residual << 1) ^ (0 - (residual >> 7)));
+}
+
+static inline uint8_t unzigzag(uint8_t value) {
+  return static_cast<uint8_t>((value >> 1) ^ (0 - (value & 1)));
+}
+
+// Packs the 16 values of a block with BITS bits each into 2 * BITS bytes
+template <int BITS>
+static void packBlock(const uint8_t *values, uint8_t *out) {
+  uint64_t packed[2] = {0, 0};
+  for (int k = 0; k < BLOCK_SIZE; k++) {
+    int offset = k * BITS;
+    packed[offset / 64] |= static_cast<uint64_t>(values[k]) << (offset % 64);
+    if (offset % 64 + BITS > 64) {
+      packed[1] |= static_cast<uint64_t>(values[k]) >> (64 - offset % 64);
+    }
+  }
+  for (int b = 0; b < 2 * BITS; b++) {
+    out[b] = static_cast<uint8_t>(packed[b / 8] >> (8 * (b % 8)));
+  }
+}
+
+template <int BITS>
+static void unpackBlock(const uint8_t *in, uint8_t *values) {
+  uint64_t packed[2] = {0, 0};
+  for (int b = 0; b < 2 * BITS; b++) {
+    packed[b / 8] |= static_cast<uint64_t>(in[b]) << (8 * (b % 8));
+  }
+  constexpr uint64_t mask = (uint64_t(1) << BITS) - 1;
+  for (int k = 0; k < BLOCK_SIZE; k++) {
+    int offset = k * BITS;
+    uint64_t value = packed[offset / 64] >> (offset % 64);
+    if (offset % 64 + BITS > 64) {
+      value |= packed[1] << (64 - offset % 64);
+    }
+    values[k] = static_cast<uint8_t>(value & mask);
+  }
+}
+
+static void packBlock(int bits, const uint8_t *values, uint8_t *out) {
+  switch (bits) {
+  case 1: packBlock<1>(values, out); break;
+  case 2: packBlock<2>(values, out); break;
+  case 3: packBlock<3>(values, out); break;
+  case 4: packBlock<4>(values, out); break;
+  case 5: packBlock<5>(values, out); break;
+  case 6: packBlock<6>(values, out); break;
+  case 7: packBlock<7>(values, out); break;
+  case 8: std::memcpy(out, values, BLOCK_SIZE); break;
+  default: break;
+  }
+}
+
+static void unpackBlock(int bits, const uint8_t *in, uint8_t *values) {
+  switch (bits) {
+  case 1: unpackBlock<1>(in, values); break;
+  case 2: unpackBlock<2>(in, values); break;
+  case 3: unpackBlock<3>(in, values); break;
+  case 4: unpackBlock<4>(in, values); break;
+  case 5: unpackBlock<5>(in, values); break;
+  case 6: unpackBlock<6>(in, values); break;
+  case 7: unpackBlock<7>(in, values); break;
+  case 8: std::memcpy(values, in, BLOCK_SIZE); break;
+  default: std::memset(values, 0, BLOCK_SIZE); break;
+  }
+}
+
+// Rows are padded with zero residuals to whole blocks, so that a row can be
+// coded on its own, with only the row above it at hand
+static size_t paddedRowBytes(int rowBytes) {
+  return (static_cast<size_t>(rowBytes) + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+}
+
+std::vector<uint8_t> vivictpp::libav::compressPlane(const uint8_t *data, int linesize, int rowBytes,
+                                                    int rows, int sampleBytes) {
+  size_t padded = paddedRowBytes(rowBytes);
+  std::vector<uint8_t> residuals(padded, 0);
+  std::vector<uint8_t> compressed(rows * (padded + padded / BLOCK_SIZE));
+  uint8_t *out = compressed.data();
+  int firstSample = std::min(sampleBytes, rowBytes);
+  for (int y = 0; y < rows; y++) {
+    const uint8_t *row = data + static_cast<ptrdiff_t>(y) * linesize;
+    if (y == 0) {
+      for (int x = 0; x < firstSample; x++) {
+        residuals[x] = zigzag(row[x]);
+      }
+      for (int x = firstSample; x < rowBytes; x++) {
+        residuals[x] = zigzag(row[x] - row[x - sampleBytes]);
+      }
+    } else {
+      const uint8_t *above = row - linesize;
+      for (int x = 0; x < rowBytes; x++) {
+        residuals[x] = zigzag(row[x] - above[x]);
+      }
+    }
+    for (size_t i = 0; i < padded; i += BLOCK_SIZE) {
+      uint8_t all = 0;
+      for (int k = 0; k < BLOCK_SIZE; k++) {
+        all |= residuals[i + k];
+      }
+      int bits = all == 0 ? 0 : 32 - __builtin_clz(all);
+      *out++ = static_cast<uint8_t>(bits);
+      packBlock(bits, residuals.data() + i, out);
+      out += 2 * bits;
+    }
+  }
+  compressed.resize(out - compressed.data());
+  compressed.shrink_to_fit();
+  return compressed;
+}
+
+bool vivictpp::libav::decompressPlane(const std::vector<uint8_t> &compressed, uint8_t *data,
+                                      int linesize, int rowBytes, int rows, int sampleBytes) {
+  size_t padded = paddedRowBytes(rowBytes);
+  std::vector<uint8_t> residuals(padded);
+  const uint8_t *in = compressed.data();
+  const uint8_t *end = in + compressed.size();
+  int firstSample = std::min(sampleBytes, rowBytes);
+  for (int y = 0; y < rows; y++) {
+    for (size_t i = 0; i < padded; i += BLOCK_SIZE) {
+      if (in == end) {
+        return false;
+      }
+      int bits = *in++;
+      if (bits > 8 || end - in < 2 * bits) {
+        return false;
+      }
+      unpackBlock(bits, in, residuals.data() + i);
+      in += 2 * bits;
+    }
+    uint8_t *row = data + static_cast<ptrdiff_t>(y) * linesize;
+    if (y == 0) {
+      for (int x = 0; x < firstSample; x++) {
+        row[x] = unzigzag(residuals[x]);
+      }
+      for (int x = firstSample; x < rowBytes; x++) {
+        row[x] = static_cast<uint8_t>(row[x - sampleBytes] + unzigzag(residuals[x]));
+      }
+    } else {
+      const uint8_t *above = row - linesize;
+      for (int x = 0; x < rowBytes; x++) {
+        row[x] = static_cast<uint8_t>(above[x] + unzigzag(residuals[x]));
+      }
+    }
+  }
+  return in == end;
+}
@@ -0,0 +1,44 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "libav/Scaler.hh"
+
+#include <stdexcept>
+
+#include "libav/AVErrorUtils.hh"
+
+vivictpp::libav::Scaler::~Scaler() {
+  sws_freeContext(swsContext);
+}
+
+vivictpp::libav::Frame vivictpp::libav::Scaler::scale(const Frame &frame, int width, int height) {
+  return scale(frame, width, height, static_cast<AVPixelFormat>(frame.avFrame()->format));
+}
+
+vivictpp::libav::Frame vivictpp::libav::Scaler::scale(const Frame &frame, int width, int height,
+                                                      AVPixelFormat format) {
+  const AVFrame *src = frame.avFrame();
+  swsContext = sws_getCachedContext(swsContext, src->width, src->height,
+                                    static_cast<AVPixelFormat>(src->format),
+                                    width, height, format,
+                                    SWS_BILINEAR, nullptr, nullptr, nullptr);
+  if (!swsContext) {
+    throw std::runtime_error("Failed to create scaling context");
+  }
+  Frame scaled;
+  AVFrame *dst = scaled.avFrame();
+  dst->format = format;
+  dst->width = width;
+  dst->height = height;
+  AVResult ret = av_frame_get_buffer(dst, 0);
+  if (ret.error()) {
+    throw std::runtime_error("Failed to allocate scaled frame");
+  }
+  ret = av_frame_copy_props(dst, src);
+  if (ret.error()) {
+    throw std::runtime_error("Failed to copy frame props");
+  }
+  sws_scale(swsContext, src->data, src->linesize, 0, src->height, dst->data, dst->linesize);
+  return scaled;
+}
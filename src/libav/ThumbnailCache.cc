@@ -0,0 +1,61 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "libav/ThumbnailCache.hh"
+
+#include <algorithm>
+
+vivictpp::libav::ThumbnailCache::ThumbnailCache(vivictpp::time::Time startTime,
+                                                vivictpp::time::Time duration,
+                                                vivictpp::time::Time interval):
+  startTime(startTime),
+  interval(std::max<vivictpp::time::Time>(interval, 1)),
+  slotTotal(duration > 0 ? static_cast<size_t>((duration - 1) / this->interval + 1) : 0),
+  slots(slotTotal) {
+}
+
+void vivictpp::libav::ThumbnailCache::set(size_t slot, std::shared_ptr<const Thumbnail> thumbnail) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  if (slot >= slots.size()) {
+    return;
+  }
+  if (slots[slot]) {
+    bytes -= slots[slot]->data.size();
+  }
+  if (thumbnail) {
+    bytes += thumbnail->data.size();
+  }
+  slots[slot] = std::move(thumbnail);
+}
+
+bool vivictpp::libav::ThumbnailCache::has(size_t slot) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return slot < slots.size() && slots[slot];
+}
+
+std::shared_ptr<const vivictpp::libav::Thumbnail>
+vivictpp::libav::ThumbnailCache::at(vivictpp::time::Time t) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  if (slots.empty() || vivictpp::time::isNoPts(t) || t < startTime) {
+    return nullptr;
+  }
+  size_t slot = std::min(static_cast<size_t>((t - startTime) / interval), slots.size() - 1);
+  for (size_t i = slot + 1; i > 0; i--) {
+    if (slots[i - 1]) {
+      return slots[i - 1];
+    }
+  }
+  return nullptr;
+}
+
+std::vector<std::shared_ptr<const vivictpp::libav::Thumbnail>>
+vivictpp::libav::ThumbnailCache::thumbnails() {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return slots;
+}
+
+size_t vivictpp::libav::ThumbnailCache::byteSize() {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return bytes;
+}
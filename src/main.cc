@@ -11,13 +11,19 @@
 #include "SDL_video.h"
 #include "sdl/SDLUtils.hh"
 #include "spdlog/spdlog.h"
+#include "fmt/core.h"
 #include "ui/FontSize.hh"
 
 #include "Version.hh"
 #include "VivictPP.hh"
 #include "Controller.hh"
+#include "InputOpener.hh"
 #include "SourceConfig.hh"
 #include "vmaf/VmafLog.hh"
+#include "libav/InputCache.hh"
+#include "workers/Executor.hh"
+#include "workers/MemoryBudget.hh"
+#include "workers/ThreadPlacement.hh"
 
 #include "CLI/App.hpp"
 #include "CLI/Formatter.hpp"
@@ -121,6 +127,60 @@ int main(int argc, char **argv) {
     app.add_option("--preferred-decoders", preferredDecodersStr,
                    std::string("Comma separated list of decoders that should be preferred over default decoder when applicable"));
 
+    int threads(0);
+    app.add_option("--threads", threads,
+                   "Number of worker threads for demuxing, decoding and filtering, 0 means one per cpu core");
+
+    std::string leftDecoderOptions;
+    std::string rightDecoderOptions;
+    app.add_option("--left-decoder-options", leftDecoderOptions,
+                   "Decoder options for left video, on the form key1=value1:key2=value2. Valid keys are "
+                   "threads, thread_type, lowres, skip_loop_filter and gop_decoders");
+    app.add_option("--right-decoder-options", rightDecoderOptions,
+                   "Decoder options for right video, see --left-decoder-options");
+
+    int gopDecoders(0);
+    app.add_option("--gop-decoders", gopDecoders,
+                   "Number of decoders per video stream decoding groups of pictures in parallel, "
+                   "only for intra-only or closed GOP video. 0 means a single decoder");
+
+    int memoryLimit(0);
+    app.add_option("--memory-limit", memoryLimit,
+                   "Memory in MiB to use for decoded frames and packet queues, 0 means a quarter of physical memory");
+
+    bool disableIndexCache(false);
+    app.add_flag("--disable-index-cache", disableIndexCache,
+                 "Always probe and index inputs, instead of using cached stream info, frame index and thumbnails");
+
+    double leftWeight(1.0);
+    double rightWeight(1.0);
+    app.add_option("--left-weight", leftWeight, "Scheduling weight of left video relative to right video");
+    app.add_option("--right-weight", rightWeight, "Scheduling weight of right video relative to left video");
+
+    bool pinThreads(false);
+    app.add_flag("--pin-threads", pinThreads,
+                 "Run the presentation thread on a core of its own with raised priority, and all other threads on the remaining cores (Linux only)");
+
+    double trickPlaySpeed(8.0);
+    app.add_option("--trick-play-speed", trickPlaySpeed,
+                   "Playback speed from which only keyframes are decoded, 0 disables keyframe only playback");
+
+    bool downscaleToWindow(false);
+    app.add_flag("--downscale-to-window", downscaleToWindow,
+                 "Downscale video to the window size before it is displayed, when the window is smaller than the video");
+
+    double thumbnailInterval(10.0);
+    app.add_option("--thumbnail-interval", thumbnailInterval,
+                   "Seconds between the thumbnails shown when hovering over the seek bar, 0 disables thumbnails");
+
+    int prefetchFrames(12);
+    app.add_option("--prefetch-frames", prefetchFrames,
+                   "Number of video frames kept decoded before and after the shown frame while playback is stopped, 0 disables decoding of earlier frames");
+
+    int historyFrames(250);
+    app.add_option("--history-frames", historyFrames,
+                   "Number of video frames before the buffered ones kept losslessly compressed in memory for stepping backwards, limited by the memory budget, 0 disables");
+
     CLI11_PARSE(app, argc, argv);
 
 
@@ -132,6 +192,8 @@ int main(int argc, char **argv) {
     std::vector<std::string> vmafLogfiles = {leftVmaf, rightVmaf};
     std::vector<std::string> formatOptions = {leftInputFormat, rightInputFormat};
     std::vector<std::string> preferredDecoders = splitString(preferredDecodersStr);
+    std::vector<double> weights = {leftWeight, rightWeight};
+    std::vector<std::string> decoderOptionStrings = {leftDecoderOptions, rightDecoderOptions};
 
     vivictpp::logging::initializeLogging();
 
@@ -140,18 +202,42 @@ int main(int argc, char **argv) {
         std::string filter = i < filters.size() ? filters[i] : "";
         std::string vmafLogFile = i < vmafLogfiles.size() ? vmafLogfiles[i] : "";
         std::string format = i < formatOptions.size() ? formatOptions[i] : "";
-        sourceConfigs.push_back(SourceConfig(sources[i], filter, vmafLogFile, format, {hwAccel, preferredDecoders}));
+        double weight = i < weights.size() ? weights[i] : 1.0;
+        vivictpp::libav::DecoderOptions decoderOptions{hwAccel, preferredDecoders, gopDecoders};
+        if (i < decoderOptionStrings.size()) {
+          vivictpp::libav::parseDecoderOptions(decoderOptionStrings[i], decoderOptions);
+        }
+        sourceConfigs.push_back(SourceConfig(sources[i], filter, vmafLogFile, format, decoderOptions,
+                                             weight));
     }
 
     for (auto sourceConfig : sourceConfigs) {
         spdlog::debug("Source: path={} filters={}", sourceConfig.path, sourceConfig.filter);
     }
 
-    VivictPPConfig vivictPPConfig(sourceConfigs, !enableAudio);
+    if (pinThreads) {
+      // Before any other thread is started, so that they all inherit it
+      vivictpp::workers::ThreadPlacement::enable();
+    }
+    vivictpp::workers::Executor::setThreadCount(threads);
+    vivictpp::libav::InputCache::setEnabled(!disableIndexCache);
+    if (memoryLimit > 0) {
+      vivictpp::workers::MemoryBudget::instance().setLimit(static_cast<size_t>(memoryLimit) * 1024 * 1024);
+    }
+    VivictPPConfig vivictPPConfig(sourceConfigs, !enableAudio, trickPlaySpeed, downscaleToWindow,
+                                  thumbnailInterval, prefetchFrames, historyFrames);
+    // Inputs are opened in the background while the window is shown
+    auto inputOpener = std::make_shared<InputOpener>(vivictPPConfig.sourceConfigs);
     vivictpp::sdl::SDLInitializer sdlInitializer(enableAudio);
     vivictpp::ui::FontSize::setScaling(!disableFontAutoScaling, fontCustomScaling);
     auto sdlEventLoop = std::make_shared<vivictpp::sdl::SDLEventLoop>(vivictPPConfig.sourceConfigs);
-    vivictpp::Controller controller(sdlEventLoop, sdlEventLoop, vivictPPConfig);
+    bool opened = sdlEventLoop->showSplashUntil(
+      [&]() { return inputOpener->isDone(); },
+      [&]() { return fmt::format("Opening inputs {}/{}", inputOpener->openedCount(), inputOpener->size()); });
+    if (!opened) {
+      return 0;
+    }
+    vivictpp::Controller controller(sdlEventLoop, sdlEventLoop, vivictPPConfig, inputOpener);
     return controller.run();
   } catch (const std::exception &e) {
     std::cerr << "Vivict had an unexpected error: " << e.what() << std::endl;
@@ -3,6 +3,7 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 
 #include "sdl/SDLEventLoop.hh"
+#include "sdl/SDLUtils.hh"
 #include "SDL_events.h"
 #include "SDL_video.h"
 #include "ui/Events.hh"
@@ -32,6 +33,13 @@ vivictpp::sdl::SDLEventLoop::SDLEventLoop(std::vector<SourceConfig> sourceConfig
 static auto staticLogger = vivictpp::logging::getOrCreateLogger("SDLEventLoop");
 
 static Uint32 scheduleEventCallback(Uint32 interval, void *param) {
+  // Normally called on the SDL timer thread, which decides when frames are
+  // presented
+  static thread_local bool placed = false;
+  if (!placed) {
+    vivictpp::sdl::placePresentationThread();
+    placed = true;
+  }
   auto eventData = static_cast<vivictpp::sdl::CustomEvent *>(param);
   SDL_Event event;
   SDL_zero(event);
@@ -145,9 +153,12 @@ void vivictpp::sdl::SDLEventLoop::handleCustomEvent(const SDL_Event &event, Even
 
 void vivictpp::sdl::SDLEventLoop::start(EventListener &eventListener) {
   logger->debug("SDLEventLoop::start");
+  placePresentationThread();
   SDL_Event event;
   while (!quit.load()) {
-    while (SDL_WaitEventTimeout(&event, 100) && !quit.load()) {
+    // Events are only waited for once the idle uploads are done
+    while ((screenOutput.hasIdleUploads() ? SDL_PollEvent(&event) : SDL_WaitEventTimeout(&event, 100)) &&
+           !quit.load()) {
       logger->trace("Recieved event type={}", event.type);
       if (isCustomEvent(event)) {
         handleCustomEvent(event, eventListener);
@@ -212,13 +223,39 @@ void vivictpp::sdl::SDLEventLoop::start(EventListener &eventListener) {
             eventListener.refreshDisplay();
           }
         } break;
+        case SDL_RENDER_TARGETS_RESET: {
+          logger->debug("Render targets reset");
+          screenOutput.onRenderTargetsReset();
+          eventListener.refreshDisplay();
+        } break;
         }
       }
     }
+    screenOutput.uploadIdle();
   }
   logger->debug("SDLEventLoop finished");
 }
 
+bool vivictpp::sdl::SDLEventLoop::showSplashUntil(std::function<bool()> isDone,
+                                                  std::function<std::string()> getStatus) {
+  SDL_Event event;
+  while (!isDone()) {
+    screenOutput.renderSplash(getStatus());
+    if (!SDL_WaitEventTimeout(&event, 50)) {
+      continue;
+    }
+    if (event.type == SDL_QUIT ||
+        (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_q)) {
+      logger->debug("SDLEventLoop::showSplashUntil window closed");
+      return false;
+    }
+    if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+      screenOutput.onResize();
+    }
+  }
+  return true;
+}
+
 void vivictpp::sdl::SDLEventLoop::stop() {
   logger->debug("stopping...");
   quit.store(true);
@@ -3,7 +3,12 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 
 #include "sdl/SDLUtils.hh"
+
+#include <algorithm>
+
 #include "SDL_pixels.h"
+#include "logging/Logging.hh"
+#include "workers/ThreadPlacement.hh"
 
 std::atomic<int> vivictpp::sdl::SDLInitializer::instanceCount(0);
 
@@ -26,22 +31,86 @@ vivictpp::sdl::SDLInitializer::~SDLInitializer() {
 
 vivictpp::sdl::SDLTexture::SDLTexture(SDL_Renderer* renderer, int w, int h, SDL_PixelFormatEnum pixelFormat) :
   texturePtr(createTexture(renderer, w, h, pixelFormat)),
-  pixelFormat(pixelFormat) {
+  pixelFormat(pixelFormat),
+  width(w),
+  height(h) {
+}
+
+bool vivictpp::sdl::SDLTexture::update(const vivictpp::libav::Frame &frame) {
+  return update(frame, {0, 0, width, height});
 }
 
-void vivictpp::sdl::SDLTexture::update(const vivictpp::libav::Frame &frame) {
+bool vivictpp::sdl::SDLTexture::update(const vivictpp::libav::Frame &frame,
+                                       const SDL_Rect &region) {
+  if (frame.empty() || !texturePtr) {
+    return false;
+  }
+  // Both texture formats have chroma subsampled by two in each direction, so
+  // uploaded rectangles start on even coordinates
+  int x0 = std::max(0, region.x & ~1);
+  int y0 = std::max(0, region.y & ~1);
+  int x1 = std::min(width, (region.x + region.w + 1) & ~1);
+  int y1 = std::min(height, (region.y + region.h + 1) & ~1);
+  if (x1 <= x0 || y1 <= y0) {
+    return false;
+  }
+  SDL_Rect rect = {x0, y0, x1 - x0, y1 - y0};
+  if (frame.avFrame() != currentFrame.avFrame()) {
+    uploadRect(frame, rect);
+    currentFrame = frame;
+    uploadedRect = rect;
+    return true;
+  }
+  SDL_Rect unionRect;
+  SDL_UnionRect(&uploadedRect, &rect, &unionRect);
+  if (SDL_RectEquals(&unionRect, &uploadedRect)) {
+    return false;
+  }
+  // Upload the strips around the uploaded rectangle that are newly exposed
+  int top = uploadedRect.y - unionRect.y;
+  int bottom = unionRect.y + unionRect.h - (uploadedRect.y + uploadedRect.h);
+  int left = uploadedRect.x - unionRect.x;
+  int right = unionRect.x + unionRect.w - (uploadedRect.x + uploadedRect.w);
+  if (top > 0) {
+    uploadRect(frame, {unionRect.x, unionRect.y, unionRect.w, top});
+  }
+  if (bottom > 0) {
+    uploadRect(frame, {unionRect.x, uploadedRect.y + uploadedRect.h, unionRect.w, bottom});
+  }
+  if (left > 0) {
+    uploadRect(frame, {unionRect.x, uploadedRect.y, left, uploadedRect.h});
+  }
+  if (right > 0) {
+    uploadRect(frame, {uploadedRect.x + uploadedRect.w, uploadedRect.y, right, uploadedRect.h});
+  }
+  uploadedRect = unionRect;
+  return true;
+}
+
+void vivictpp::sdl::SDLTexture::uploadRect(const vivictpp::libav::Frame &frame,
+                                           const SDL_Rect &rect) {
+  const AVFrame *f = frame.avFrame();
+  const uint8_t *y = f->data[0] + rect.y * f->linesize[0] + rect.x;
   if (pixelFormat == SDL_PIXELFORMAT_YV12) {
     SDL_UpdateYUVTexture(
-    texturePtr.get(), nullptr,
-    frame->data[0], frame->linesize[0],
-    frame->data[1], frame->linesize[1],
-    frame->data[2], frame->linesize[2]);
+    texturePtr.get(), &rect,
+    y, f->linesize[0],
+    f->data[1] + rect.y / 2 * f->linesize[1] + rect.x / 2, f->linesize[1],
+    f->data[2] + rect.y / 2 * f->linesize[2] + rect.x / 2, f->linesize[2]);
   } else {
+    // Interleaved chroma, one byte each of U and V per chroma sample
     SDL_UpdateNVTexture(
-      texturePtr.get(), nullptr,
-      frame->data[0], frame->linesize[0],
-      frame->data[1], frame->linesize[1]);
+      texturePtr.get(), &rect,
+      y, f->linesize[0],
+      f->data[1] + rect.y / 2 * f->linesize[1] + rect.x, f->linesize[1]);
+  }
+}
+
+SDL_PixelFormatEnum vivictpp::sdl::texturePixelFormat(const vivictpp::libav::Frame &frame) {
+  if (!frame.empty() && (AVPixelFormat) frame.avFrame()->format == AV_PIX_FMT_NV12) {
+    return SDL_PIXELFORMAT_NV12;
   }
+  return SDL_PIXELFORMAT_YV12;
 }
 
 std::unique_ptr<SDL_Window, std::function<void(SDL_Window *)>>
@@ -100,3 +169,13 @@ vivictpp::sdl::createHandCursor() {
   }
   return cursor;
 }
+
+void vivictpp::sdl::placePresentationThread() {
+  if (!vivictpp::workers::ThreadPlacement::pinPresentationThread()) {
+    return;
+  }
+  if (SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH) != 0) {
+    vivictpp::logging::getOrCreateLogger("ThreadPlacement")
+      ->warn("Could not raise thread priority, running with normal priority: {}", SDL_GetError());
+  }
+}
@@ -0,0 +1,62 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "sdl/TextureRing.hh"
+
+#include <algorithm>
+
+vivictpp::sdl::SDLTexture &
+vivictpp::sdl::TextureRing::get(SDL_Renderer *renderer, const vivictpp::libav::Frame &frame) {
+  auto it = std::find_if(entries.begin(), entries.end(),
+                         [&frame](const Entry &entry) { return entry.texture.holds(frame); });
+  if (it == entries.end()) {
+    // Textures holding frames that are still wanted are only reused when
+    // there are no others
+    it = std::min_element(entries.begin(), entries.end(),
+                          [](const Entry &a, const Entry &b) {
+                            if (a.texture.holdsFrame() != b.texture.holdsFrame()) {
+                              return !a.texture.holdsFrame();
+                            }
+                            return a.lastUse < b.lastUse;
+                          });
+    SDLTexture &texture = it->texture;
+    if (!frame.empty() &&
+        (!texture || frame->width != texture.getWidth() || frame->height != texture.getHeight() ||
+         texturePixelFormat(frame) != texture.getPixelFormat())) {
+      texture = SDLTexture(renderer, frame->width, frame->height, texturePixelFormat(frame));
+    }
+  }
+  it->lastUse = ++useCount;
+  return it->texture;
+}
+
+bool vivictpp::sdl::TextureRing::contains(const vivictpp::libav::Frame &frame) const {
+  return std::any_of(entries.begin(), entries.end(),
+                     [&frame](const Entry &entry) { return entry.texture.holds(frame); });
+}
+
+void vivictpp::sdl::TextureRing::retain(const std::vector<vivictpp::libav::Frame> &frames) {
+  for (auto &entry : entries) {
+    bool keep = std::any_of(frames.begin(), frames.end(),
+                            [&entry](const vivictpp::libav::Frame &frame) {
+                              return entry.texture.holds(frame);
+                            });
+    if (!keep) {
+      entry.texture.invalidate();
+    }
+  }
+}
+
+void vivictpp::sdl::TextureRing::invalidate() {
+  for (auto &entry : entries) {
+    entry.texture.invalidate();
+  }
+}
+
+void vivictpp::sdl::TextureRing::clear() {
+  for (auto &entry : entries) {
+    entry = Entry();
+  }
+  useCount = 0;
+}
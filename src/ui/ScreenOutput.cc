@@ -53,7 +53,7 @@ vivictpp::ui::ScreenOutput::ScreenOutput(std::vector<SourceConfig> sourceConfigs
     vmafGraph(vmafLogs(sourceConfigs), 1.0f, 0.3f),
     seekBar(Margin{0,50,20,50}),
     logger(vivictpp::logging::getOrCreateLogger("ScreenOutput")) {
-//  renderSplash();
+  renderSplash();
 }
 
 vivictpp::ui::ScreenOutput::~ScreenOutput() {
@@ -82,6 +82,10 @@ void vivictpp::ui::ScreenOutput::onResize() {
   SDL_GetWindowSize(screen.get(), &width, &height);
 }
 
+void vivictpp::ui::ScreenOutput::onRenderTargetsReset() {
+  videoDisplay.invalidateTextures();
+}
+
 void vivictpp::ui::ScreenOutput::setCursorHand() { SDL_SetCursor(handCursor.get()); }
 
 void vivictpp::ui::ScreenOutput::setCursorPan() { SDL_SetCursor(panCursor.get()); }
@@ -108,8 +112,9 @@ void vivictpp::ui::setRectangle(SDL_Rect &rect, int x, int y, int w, int h) {
   rect.h = h;
 }
 
-void vivictpp::ui::ScreenOutput::renderSplash() {
+void vivictpp::ui::ScreenOutput::renderSplash(const std::string &status) {
   DisplayState displayState;
+  splashText.setStatus(status);
   SDL_SetRenderDrawColor(renderer.get(), 0, 0, 0, SDL_ALPHA_OPAQUE);
   SDL_RenderClear(renderer.get());
   splashText.render(displayState, renderer.get(), 0, 0);
@@ -155,6 +160,7 @@ void vivictpp::ui::ScreenOutput::displayFrame(
     seekBar.render(displayState, renderer.get(), 0, y);
   }
   SDL_RenderPresent(renderer.get());
+  videoDisplay.queueNeighbourFrames(displayState);
 }
 
 const vivictpp::ui::MouseClicked vivictpp::ui::ScreenOutput::getClickTarget(int x, int y) {
@@ -8,6 +8,8 @@ extern "C" {
 #include <SDL.h>
 }
 
+#include <algorithm>
+
 
 void vivictpp::ui::SeekBar::render(const DisplayState &displayState, SDL_Renderer *renderer, int x, int y) {
   (void) displayState;
@@ -38,4 +40,62 @@ void vivictpp::ui::SeekBar::render(const DisplayState &displayState, SDL_Rendere
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, state.opacity);
     SDL_RenderDrawRect(renderer, &seekBarRect);
     box = {x0, y0, w, h};
+    if (state.relativeHoverPos >= 0) {
+      renderThumbnails(renderer, width);
+    }
+}
+
+float vivictpp::ui::SeekBar::hoverPos(int x, int y) const {
+  if (box.w <= 0 || x < box.x || x >= box.x + box.w ||
+      y < box.y - HOVER_MARGIN || y >= box.y + box.h + HOVER_MARGIN) {
+    return -1;
+  }
+  return (x - box.x) / static_cast<float>(box.w);
+}
+
+// The left thumbnail is drawn to the left of the hovered position and the
+// right thumbnail to the right of it, as in the split view. A single
+// thumbnail is centered.
+void vivictpp::ui::SeekBar::renderThumbnails(SDL_Renderer *renderer, int width) {
+  const auto &left = state.leftThumbnail;
+  const auto &right = state.rightThumbnail;
+  if (!left && !right) {
+    return;
+  }
+  int hoverX = box.x + static_cast<int>(box.w * state.relativeHoverPos);
+  int leftWidth = left ? left->width : 0;
+  int rightWidth = right ? right->width : 0;
+  int x = left && right ? hoverX - leftWidth : hoverX - (leftWidth + rightWidth) / 2;
+  x = std::max(0, std::min(x, width - leftWidth - rightWidth));
+  int bottom = box.y - HOVER_MARGIN;
+  if (left) {
+    renderThumbnail(renderer, leftThumbnail, left, x, bottom);
+  }
+  if (right) {
+    renderThumbnail(renderer, rightThumbnail, right, x + leftWidth, bottom);
+  }
+}
+
+void vivictpp::ui::SeekBar::renderThumbnail(SDL_Renderer *renderer, ThumbnailTexture &texture,
+                                            const std::shared_ptr<const vivictpp::libav::Thumbnail> &thumbnail,
+                                            int x, int bottom) {
+  int w = thumbnail->width;
+  int h = thumbnail->height;
+  if (texture.thumbnail != thumbnail) {
+    if (!texture.texture || texture.width != w || texture.height != h) {
+      texture.texture = vivictpp::sdl::createTexture(renderer, w, h, SDL_PIXELFORMAT_IYUV);
+      texture.width = w;
+      texture.height = h;
+    }
+    const uint8_t *y = thumbnail->data.data();
+    const uint8_t *u = y + w * h;
+    const uint8_t *v = u + (w / 2) * (h / 2);
+    SDL_UpdateYUVTexture(texture.texture.get(), nullptr, y, w, u, w / 2, v, w / 2);
+    texture.thumbnail = thumbnail;
+  }
+  SDL_SetTextureAlphaMod(texture.texture.get(), state.opacity);
+  SDL_Rect dest{x, bottom - h, w, h};
+  SDL_RenderCopy(renderer, texture.texture.get(), nullptr, &dest);
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, state.opacity);
+  SDL_RenderDrawRect(renderer, &dest);
 }
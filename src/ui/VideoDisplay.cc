@@ -1,38 +1,48 @@
 #include "ui/VideoDisplay.hh"
 #include "SDL_pixels.h"
 
+#include <algorithm>
+#include <cmath>
+
 int inline fitToRange(int value, int min, int max) {
   return std::max(min, std::min(max, value));
 }
 
-SDL_PixelFormatEnum getTexturePixelFormat(const vivictpp::libav::Frame &frame) {
-  if (!frame.empty() && (AVPixelFormat) frame.avFrame()->format == AV_PIX_FMT_NV12) {
-    return SDL_PIXELFORMAT_NV12;
-  }
-  return SDL_PIXELFORMAT_YV12;
-}
+// The shown frame and the neighbour frames on either side of it
+static constexpr size_t TEXTURE_RING_SIZE = 1 + 2 * vivictpp::ui::NEIGHBOUR_FRAMES;
 
 vivictpp::ui::VideoDisplay::VideoDisplay():
-   logger(vivictpp::logging::getOrCreateLogger("VideoDisplay")){
+  leftTextures(TEXTURE_RING_SIZE),
+  rightTextures(TEXTURE_RING_SIZE),
+  logger(vivictpp::logging::getOrCreateLogger("VideoDisplay")){
 }
 
-void vivictpp::ui::VideoDisplay::initTextures(SDL_Renderer *renderer, const DisplayState &displayState) {
+// Textures are created as frames are shown, with the size of the frames,
+// which is smaller than the filtered resolution if they have been downscaled
+// in the decoding pipeline
+void vivictpp::ui::VideoDisplay::initTextures(const DisplayState &displayState) {
   if (displayState.rightVideoMetadata.empty() ||
       displayState.leftVideoMetadata.filteredResolution.w > displayState.rightVideoMetadata.filteredResolution.w) {
     targetResolution = displayState.leftVideoMetadata.filteredResolution;
   } else {
     targetResolution = displayState.rightVideoMetadata.filteredResolution;
   }
-  leftTexture = vivictpp::sdl::SDLTexture(renderer,
-                                          displayState.leftVideoMetadata.filteredResolution.w,
-                                          displayState.leftVideoMetadata.filteredResolution.h,
-                                          getTexturePixelFormat(displayState.leftFrame));
-  if (!displayState.rightVideoMetadata.empty()) {
-    rightTexture = vivictpp::sdl::SDLTexture(renderer,
-                                             displayState.rightVideoMetadata.filteredResolution.w,
-                                             displayState.rightVideoMetadata.filteredResolution.h,
-                                             getTexturePixelFormat(displayState.rightFrame));
+  leftTextures.clear();
+  rightTextures.clear();
+  neighbourUploads.clear();
+}
+
+// Maps a rectangle in the filtered resolution to the texture
+static SDL_Rect toTextureRect(const SDL_Rect &rect, const Resolution &resolution,
+                              const vivictpp::sdl::SDLTexture &texture) {
+  if (resolution.w <= 0 || resolution.h <= 0 ||
+      (texture.getWidth() == resolution.w && texture.getHeight() == resolution.h)) {
+    return rect;
   }
+  double sx = texture.getWidth() / static_cast<double>(resolution.w);
+  double sy = texture.getHeight() / static_cast<double>(resolution.h);
+  return {static_cast<int>(rect.x * sx), static_cast<int>(rect.y * sy),
+    static_cast<int>(std::lround(rect.w * sx)), static_cast<int>(std::lround(rect.h * sy))};
 }
 
 void vivictpp::ui::VideoDisplay::setDefaultSourceRectangles(const DisplayState &displayState) {
@@ -61,6 +71,7 @@ void vivictpp::ui::VideoDisplay::updateRectangles(const DisplayState &displaySta
     destRect.w = scaledResolution.w;
     destRect.h = scaledResolution.h;
     setDefaultSourceRectangles(displayState);
+    displayResolution = Resolution(destRect.w, destRect.h);
   } else if(keepAspectRatio) {
     if (width / static_cast<double>(height) <= scaledResolution.aspectRatio()) {
       destRect.w = width;
@@ -70,7 +81,9 @@ void vivictpp::ui::VideoDisplay::updateRectangles(const DisplayState &displaySta
       destRect.w = scaledResolution.w * height / scaledResolution.h;
     }
     setDefaultSourceRectangles(displayState);
+    displayResolution = Resolution(destRect.w, destRect.h);
   } else {
+    displayResolution = Resolution();
     destRect.w = std::min(width, scaledResolution.w);
     destRect.h = std::min(height, scaledResolution.h);
     calcZoomedSrcRect(displayState, scaledResolution, displayState.leftVideoMetadata, sourceRectLeft);
@@ -113,32 +126,134 @@ void vivictpp::ui::VideoDisplay::calcZoomedSrcRect(const DisplayState &displaySt
                       srcH - rect.h);
 }
 
+// The part of sourceRect that is drawn to the columns destFrom to destTo of
+// destRect, with a margin for the texels sampled when scaling
+SDL_Rect vivictpp::ui::VideoDisplay::visibleSourceRect(const SDL_Rect &sourceRect,
+                                                       int destFrom, int destTo) const {
+  const int margin = 2;
+  if (destRect.w <= 0 || destTo <= destFrom) {
+    return {0, 0, 0, 0};
+  }
+  double scale = sourceRect.w / static_cast<double>(destRect.w);
+  int x0 = sourceRect.x + static_cast<int>(std::floor((destFrom - destRect.x) * scale)) - margin;
+  int x1 = sourceRect.x + static_cast<int>(std::ceil((destTo - destRect.x) * scale)) + margin;
+  return {x0, sourceRect.y - margin, x1 - x0, sourceRect.h + 2 * margin};
+}
+
 void vivictpp::ui::VideoDisplay::update(const DisplayState &displayState) {
   (void) displayState;
 
 }
 
+void vivictpp::ui::VideoDisplay::invalidateTextures() {
+  leftTextures.invalidate();
+  rightTextures.invalidate();
+}
+
+// The uploads of the previous frame that have not been done yet are
+// replaced. Left and right frames are interleaved, nearest first, so that
+// both inputs are ready for a step as soon as possible.
+void vivictpp::ui::VideoDisplay::queueNeighbourFrames(const DisplayState &displayState) {
+  neighbourUploads.clear();
+  std::vector<NeighbourUpload> left =
+    neighbourUploadsFor(leftTextures, displayState.leftFrame, displayState.leftNeighbourFrames,
+                        sourceRectLeft, displayState.leftVideoMetadata.filteredResolution,
+                        destRectLeft);
+  std::vector<NeighbourUpload> right;
+  if (!displayState.splitScreenDisabled && !displayState.rightFrame.empty()) {
+    right = neighbourUploadsFor(rightTextures, displayState.rightFrame, displayState.rightNeighbourFrames,
+                                sourceRectRight, displayState.rightVideoMetadata.filteredResolution,
+                                destRectRight);
+  }
+  for (size_t i = 0; i < std::max(left.size(), right.size()); i++) {
+    if (i < left.size()) {
+      neighbourUploads.push_back(left[i]);
+    }
+    if (i < right.size()) {
+      neighbourUploads.push_back(right[i]);
+    }
+  }
+}
+
+void vivictpp::ui::VideoDisplay::uploadNeighbourFrame(SDL_Renderer *renderer) {
+  if (neighbourUploads.empty()) {
+    return;
+  }
+  NeighbourUpload upload = neighbourUploads.front();
+  neighbourUploads.pop_front();
+  vivictpp::sdl::SDLTexture &texture = upload.textures->get(renderer, upload.frame);
+  texture.update(upload.frame,
+                 visibleSourceRect(toTextureRect(upload.sourceRect, upload.resolution, texture),
+                                   upload.visibleDestRect.x,
+                                   upload.visibleDestRect.x + upload.visibleDestRect.w));
+}
+
+// Textures not holding the shown frame or one of its neighbours are
+// released, so that no frames are held by textures during playback, when
+// there are no neighbour frames, and so that the released textures are
+// reused for the neighbour frames before any texture that is still wanted
+std::vector<vivictpp::ui::VideoDisplay::NeighbourUpload>
+vivictpp::ui::VideoDisplay::neighbourUploadsFor(vivictpp::sdl::TextureRing &textures,
+                                                const vivictpp::libav::Frame &frame,
+                                                const std::vector<vivictpp::libav::Frame> &neighbours,
+                                                const SDL_Rect &sourceRect,
+                                                const Resolution &resolution,
+                                                const SDL_Rect &visibleDestRect) {
+  std::vector<vivictpp::libav::Frame> retained(neighbours);
+  retained.push_back(frame);
+  textures.retain(retained);
+  std::vector<NeighbourUpload> uploads;
+  for (const auto &neighbour : neighbours) {
+    if (!neighbour.empty()) {
+      uploads.push_back({&textures, neighbour, sourceRect, resolution, visibleDestRect});
+    }
+  }
+  return uploads;
+}
+
 void vivictpp::ui::VideoDisplay::render(const DisplayState &displayState, SDL_Renderer *renderer, int x, int y) {
   (void) x;
   (void) y;
   if (videoMetadataVersion != displayState.videoMetadataVersion) {
-    initTextures(renderer, displayState);
+    initTextures(displayState);
     videoMetadataVersion = displayState.videoMetadataVersion;
   }
   float splitPercent = displayState.splitPercent;
 
   updateRectangles(displayState, renderer);
 
-  leftTexture.update(displayState.leftFrame);
-  if (!displayState.rightFrame.empty()) {
-    rightTexture.update(displayState.rightFrame);
+  bool showRight = !displayState.splitScreenDisabled && !displayState.rightFrame.empty();
+  // Frames uploaded ahead by uploadNeighbourFrames are found in the rings
+  vivictpp::sdl::SDLTexture &leftTexture = leftTextures.get(renderer, displayState.leftFrame);
+  SDL_Rect textureRectLeft = toTextureRect(sourceRectLeft,
+                                           displayState.leftVideoMetadata.filteredResolution,
+                                           leftTexture);
+  vivictpp::sdl::SDLTexture *rightTexture = nullptr;
+  SDL_Rect textureRectRight;
+  if (showRight) {
+    rightTexture = &rightTextures.get(renderer, displayState.rightFrame);
+    textureRectRight = toTextureRect(sourceRectRight,
+                                     displayState.rightVideoMetadata.filteredResolution,
+                                     *rightTexture);
+  }
+
+  // Only the visible part of each frame is uploaded, and only if it has not
+  // been uploaded already. Pan, zoom and split changes upload the newly
+  // exposed parts of the frames, if any.
+  leftTexture.update(displayState.leftFrame,
+                     visibleSourceRect(textureRectLeft, destRectLeft.x,
+                                       destRectLeft.x + destRectLeft.w));
+  if (showRight) {
+    rightTexture->update(displayState.rightFrame,
+                        visibleSourceRect(textureRectRight, destRectRight.x,
+                                          destRectRight.x + destRectRight.w));
   }
 
   SDL_RenderSetClipRect(renderer, &destRectLeft);
-  SDL_RenderCopy(renderer, leftTexture.get(), &sourceRectLeft, &destRect);
-  if (!displayState.splitScreenDisabled) {
+  SDL_RenderCopy(renderer, leftTexture.get(), &textureRectLeft, &destRect);
+  if (showRight) {
     SDL_RenderSetClipRect(renderer, &destRectRight);
-    SDL_RenderCopy(renderer, rightTexture.get(), &sourceRectRight, &destRect);
+    SDL_RenderCopy(renderer, rightTexture->get(), &textureRectRight, &destRect);
   }
   SDL_RenderSetClipRect(renderer, nullptr);
 
@@ -7,6 +7,13 @@
 #include "spdlog/spdlog.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 
+#include <algorithm>
+#include <thread>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+}
+
 
 std::string filterStr(std::string stdFilter, std::string customFilter) {
   if (customFilter.empty()) {
@@ -16,50 +23,132 @@ std::string filterStr(std::string stdFilter, std::string customFilter) {
   }
 }
 
-vivictpp::libav::Filter *createFilter(AVStream *stream, AVCodecContext *codecContext, std::string customFilter) {
+vivictpp::libav::Filter *createFilter(AVStream *stream, vivictpp::libav::Decoder &decoder, std::string customFilter) {
   switch (stream->codecpar->codec_type) {
   case AVMEDIA_TYPE_VIDEO:
-    return new vivictpp::libav::VideoFilter(stream, codecContext, filterStr("null", customFilter));
+    return new vivictpp::libav::VideoFilter(stream, decoder.getCodecContext(), filterStr("null", customFilter),
+                                            decoder.getFramePool());
   case AVMEDIA_TYPE_AUDIO:
-    return new vivictpp::libav::AudioFilter(codecContext, "aformat=sample_fmts=s16");
+    return new vivictpp::libav::AudioFilter(decoder.getCodecContext(), "aformat=sample_fmts=s16",
+                                            decoder.getFramePool());
   default:
     throw std::runtime_error("Filter not supported for codec_type");
   }
 }
 
+static bool useGopDecoders(AVStream *stream, const vivictpp::libav::DecoderOptions &decoderOptions) {
+  return decoderOptions.gopDecoders > 1 && stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO;
+}
+
+// In GOP-parallel mode the decoder of the worker decodes nothing, it only
+// provides the codec context and frame pool of the filter
+static vivictpp::libav::DecoderOptions serialDecoderOptions(AVStream *stream,
+                                                            vivictpp::libav::DecoderOptions decoderOptions) {
+  if (useGopDecoders(stream, decoderOptions)) {
+    decoderOptions.threads = 1;
+  }
+  return decoderOptions;
+}
+
+static size_t decodedFrameBytes(AVCodecParameters *codecpar) {
+  int size = av_image_get_buffer_size(static_cast<AVPixelFormat>(codecpar->format),
+                                      codecpar->width, codecpar->height, 1);
+  return size > 0 ? size : static_cast<size_t>(codecpar->width) * codecpar->height * 4;
+}
+
 vivictpp::workers::DecoderWorker::DecoderWorker(AVStream *stream,
                                                 std::string customFilter,
                                                 vivictpp::libav::DecoderOptions decoderOptions,
                                                 int frameBufferSize,
-                                                int packetQueueSize) :
+                                                int packetQueueSize,
+                                                int filterQueueSize) :
   InputWorker(packetQueueSize, "DecoderWorker"),
   streamIndex(stream->index),
   stream(stream),
-  frameBuffer(frameBufferSize),
-  decoder(new vivictpp::libav::Decoder(stream->codecpar, decoderOptions)),
-  filter(createFilter(stream, decoder->getCodecContext(), customFilter)),
-  lastSeenPts(AV_NOPTS_VALUE)
-{}
+  decoder(new vivictpp::libav::Decoder(stream->codecpar, serialDecoderOptions(stream, decoderOptions))),
+  filterWorker(new FilterWorker(stream,
+                                std::shared_ptr<vivictpp::libav::Filter>(createFilter(stream, *decoder, customFilter)),
+                                frameBufferSize, filterQueueSize))
+{
+  filterWorker->setProducerSignal(&wakeupSignal);
+  filterWorker->start();
+  if (useGopDecoders(stream, decoderOptions)) {
+    logger->info("Decoding stream {} with {} GOP-parallel decoders", streamIndex, decoderOptions.gopDecoders);
+    // The threads of the stream are divided between the decoders
+    vivictpp::libav::DecoderOptions gopDecoderOptions = decoderOptions;
+    int threads = decoderOptions.threads > 0 ? decoderOptions.threads
+      : static_cast<int>(std::thread::hardware_concurrency());
+    gopDecoderOptions.threads = std::max(1, threads / decoderOptions.gopDecoders);
+    for (int i = 0; i < decoderOptions.gopDecoders; i++) {
+      gopDecoders.emplace_back(new GopDecoder(stream, gopDecoderOptions,
+                                              [this](const Gop &gop) { onGopDecoded(gop); },
+                                              [this]() { return urgency(); }));
+      gopDecoders.back()->setProducerSignal(&wakeupSignal);
+      gopDecoders.back()->start();
+    }
+    gopAccount = MemoryBudget::instance().open(
+      MemoryBudget::Kind::VIDEO_FRAMES, "decoded GOPs, stream " + std::to_string(streamIndex),
+      decodedFrameBytes(stream->codecpar), 1, frameBufferSize,
+      [this] { return decodedGops.frameBytes(); },
+      [this](MemoryBudget::Allocation allocation) { gopByteLimit = allocation.bytes; });
+  }
+  packetAccount = MemoryBudget::instance().open(
+    MemoryBudget::Kind::PACKETS, "packets, stream " + std::to_string(streamIndex), 0,
+    packetQueueSize, packetQueueSize,
+    [this] { return queuedDataBytes(); },
+    [this](MemoryBudget::Allocation allocation) { setDataByteLimit(allocation.bytes); });
+}
 
 vivictpp::workers::DecoderWorker::~DecoderWorker() {
   quit();
+  // The GOP decoders call back into this worker
+  gopDecoders.clear();
 }
 
 
-void vivictpp::workers::DecoderWorker::seek(vivictpp::time::Time pos, vivictpp::SeekCallback callback) {
+void vivictpp::workers::DecoderWorker::seek(vivictpp::time::Time pos, vivictpp::SeekCallback callback,
+                                            vivictpp::SeekToken token) {
   seeklog->debug("vivictpp::workers::DecoderWorker::seek pos={}", pos);
   DecoderWorker *dw(this);
-  sendCommand(new vivictpp::workers::Command([=](uint64_t serialNo) {
-        dw->messageQueue.clearDataOlderThan(serialNo);
-        dw->state = InputWorkerState::SEEKING;
+  uint64_t ticket = seekCallbacks.put(std::move(callback));
+  sendCommand(vivictpp::workers::Command([=](uint64_t serialNo) {
+        dw->clearDataOlderThan(serialNo);
+        dw->seekToken = token;
         dw->decoder->flush();
-        dw->frameBuffer.clear();
-        dw->seekPos = pos;
-        dw->seekCallback = callback;
+        std::queue<vivictpp::libav::Frame>().swap(dw->frameQueue);
+        dw->resetGops();
+        dw->prerollEnd = dw->gopParallel() ? vivictpp::time::NO_TIME : dw->prerollEndFor(pos);
+        // Frames sent to the filter worker after this get higher serial
+        // numbers than its seek command, and are kept
+        dw->filterWorker->seek(pos, dw->seekCallbacks.take(ticket), dw->prerollEnd, token);
         return true;
                                              }, "seek"));
 }
 
+// Frames that would be dropped from a full frame buffer when the seek
+// position is reached, or to keep the minimum number of frames ahead once it
+// has been, are not needed in full quality. Pre-roll is only used
+// for video with a known frame rate, since the buffer is sized in frames.
+vivictpp::time::Time vivictpp::workers::DecoderWorker::prerollEndFor(vivictpp::time::Time seekPos) {
+  if (stream->codecpar->codec_type != AVMEDIA_TYPE_VIDEO || stream->r_frame_rate.num == 0 ||
+      vivictpp::time::isNoPts(seekPos)) {
+    return vivictpp::time::NO_TIME;
+  }
+  int framesBefore = std::max(0, frames().maxSize() - frames().minFramesAhead());
+  vivictpp::time::Time bufferDuration =
+    av_rescale(vivictpp::time::TIME_BASE * framesBefore, stream->r_frame_rate.den,
+               stream->r_frame_rate.num);
+  return seekPos - bufferDuration;
+}
+
+bool vivictpp::workers::DecoderWorker::inPreroll(const vivictpp::libav::Packet &packet) {
+  AVPacket *avPacket = packet.avPacket();
+  if (vivictpp::time::isNoPts(prerollEnd) || !avPacket || avPacket->pts == AV_NOPTS_VALUE) {
+    return false;
+  }
+  return av_rescale_q(avPacket->pts, stream->time_base, vivictpp::time::TIME_BASE_Q) < prerollEnd;
+}
+
 void logPacket(vivictpp::libav::Packet pkt, const std::shared_ptr<spdlog::logger> &logger) {
   AVPacket *packet = pkt.avPacket();
   if (packet) {
@@ -69,72 +158,140 @@ void logPacket(vivictpp::libav::Packet pkt, const std::shared_ptr<spdlog::logger
   }
 }
 
-void vivictpp::workers::DecoderWorker::doWork() {
+bool vivictpp::workers::DecoderWorker::doWork() {
     logger->trace("vivictpp::workers::DecoderWorker::doWork");
-    while (!frameQueue.empty() && frameBuffer.waitForNotFull(std::chrono::milliseconds(2))) {
-      dropFrameIfSeekingAndBufferFull();
-      addFrameToBuffer(frameQueue.front());
+    bool progress = false;
+    if (gopParallel() && frameQueue.empty()) {
+      progress = takeDecodedGop();
+    }
+    while (!frameQueue.empty() &&
+           filterWorker->offerData(vivictpp::workers::Data<vivictpp::libav::Frame>(frameQueue.front()))) {
       frameQueue.pop();
+      progress = true;
     }
+    return progress;
 }
 
 bool vivictpp::workers::DecoderWorker::onData(const vivictpp::workers::Data<vivictpp::libav::Packet> &data) {
-  if (!frameQueue.empty()) {
-    return false;
+  if (seekToken.obsolete()) {
+    // A later seek is on its way, its command clears the decoder
+    seeklog->trace("DecoderWorker::onData dropping packet of obsolete seek");
+    return true;
   }
-  if (!seeking() && !frameBuffer.waitForNotFull(std::chrono::milliseconds(2))) {
-    logger->trace("vivictpp::workers::DecoderWorker::onData frameBuffer full");
+  if (gopParallel()) {
+    return onGopData(data.data);
+  }
+  if (!frameQueue.empty()) {
     return false;
   }
-  // TODO: check filter.eof
 
-  vivictpp::libav::Packet packet = *(data.data);
+  vivictpp::libav::Packet packet = data.data;
   logPacket(packet, logger);
-  std::vector<vivictpp::libav::Frame> frames = decoder->handlePacket(packet.avPacket());
-  for (auto frame : frames) {
-    dropFrameIfSeekingAndBufferFull();
-    vivictpp::libav::Frame filtered = filter ? filter->filterFrame(frame) : frame;
-    if (!filtered.empty()) {
-      if (frameBuffer.isFull()) {
-        frameQueue.push(filtered);
-      } else {
-        addFrameToBuffer(filtered);
-      }
+  bool packetInPreroll = inPreroll(packet);
+  if (packetInPreroll != preroll) {
+    seeklog->debug("vivictpp::workers::DecoderWorker::onData pre-roll {}", packetInPreroll ? "started" : "ended");
+    decoder->setPreroll(packetInPreroll);
+    preroll = packetInPreroll;
+  }
+  std::vector<vivictpp::libav::Frame> frames;
+  {
+    StageTimer::Scope scope(timer);
+    frames = decoder->handlePacket(packet);
+  }
+  if (timer.getCount() % 100 == 0) {
+    logger->debug("Decode time: average {:.2f} ms/packet, filter time: average {:.2f} ms/frame",
+                  timer.averageMillis(), filterWorker->getTimer().averageMillis());
+  }
+  for (auto &frame : frames) {
+    if (!frameQueue.empty() ||
+        !filterWorker->offerData(vivictpp::workers::Data<vivictpp::libav::Frame>(frame))) {
+      frameQueue.push(std::move(frame));
     }
   }
   return true;
 }
 
-void inline vivictpp::workers::DecoderWorker::dropFrameIfSeekingAndBufferFull() {
-  if (seeking()) {
-    seeklog->debug("vivictpp::workers::DecoderWorker::dropFrameIfSeekingAndBufferFull Dropping 1 frame from buffer");
-    frameBuffer.dropIfFull(1);
+// A keyframe, or the empty packet sent at end of input, ends the current GOP
+bool vivictpp::workers::DecoderWorker::onGopData(const vivictpp::libav::Packet &packet) {
+  AVPacket *avPacket = packet.avPacket();
+  bool keyframe = avPacket && (avPacket->flags & AV_PKT_FLAG_KEY);
+  if ((keyframe || !avPacket) && !currentGop.empty() && !dispatchGop()) {
+    return false;
   }
+  if (avPacket) {
+    currentGop.addPacket(packet);
+  }
+  return true;
 }
 
-void vivictpp::workers::DecoderWorker::addFrameToBuffer(const vivictpp::libav::Frame &frame) {
-    logger->debug("pts={} AV_NOPTS_VALUE={}", frame.pts(), AV_NOPTS_VALUE);
-    vivictpp::time::Time pts = frame.pts();
-    if (pts == AV_NOPTS_VALUE) {
-      if (lastSeenPts == AV_NOPTS_VALUE) {
-        pts = 0;
-      } else {
-        pts = lastSeenPts + av_rescale(vivictpp::time::TIME_BASE, stream->r_frame_rate.den, stream->r_frame_rate.num);
-      }
-      logger->warn("DecoderWorker::doWork Frame has no pts, estimating pts {}", pts);
-    } else {
-      pts = av_rescale_q(pts, stream->time_base, vivictpp::time::TIME_BASE_Q);
+// At most two GOPs per decoder are decoded or waiting to be taken, so that a
+// slow GOP does not make the others pile up, and their decoded frames are
+// kept within the budget of the GOP account. A GOP is always dispatched when
+// none are in flight, or decoding would stop.
+bool vivictpp::workers::DecoderWorker::dispatchGop() {
+  uint64_t inFlight = nextGopSequenceNo - decodedGops.nextSequenceNo();
+  if (inFlight >= 2 * gopDecoders.size()) {
+    return false;
+  }
+  if (inFlight > 0) {
+    size_t decoding = inFlight - std::min<uint64_t>(inFlight, decodedGops.size());
+    if (decodedGops.frameBytes() + (decoding + 1) * lastGopBytes > gopByteLimit.load()) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < gopDecoders.size(); i++) {
+    size_t index = (nextGopDecoder + i) % gopDecoders.size();
+    if (gopDecoders[index]->offerData(vivictpp::workers::Data<Gop>(currentGop))) {
+      nextGopDecoder = (index + 1) % gopDecoders.size();
+      currentGop = Gop(++nextGopSequenceNo, decodedGops.seekEpoch());
+      return true;
     }
-    lastSeenPts = pts;
-    logger->debug("DecoderWorker::doWork Buffering frame with pts={}s ({})",
-                  pts, frame.pts());
-    frameBuffer.write(frame, pts);
-    if(seeking()) {
-      seeklog->debug("vivictpp::workers::DecoderWorker::addFrameToBuffer written pts={} seekPos={}", pts, seekPos);
-      if (pts >= seekPos) {
-        seeklog->debug("DecoderWorker::doWork seekFinished", pts);
-        this->seekCallback(pts, false);
-        this->state = InputWorkerState::ACTIVE;
+  }
+  return false;
+}
+
+// Called from the executor thread of a GopDecoder
+void vivictpp::workers::DecoderWorker::onGopDecoded(const Gop &gop) {
+  if (decodedGops.put(gop)) {
+    wakeup();
+  }
+}
+
+bool vivictpp::workers::DecoderWorker::takeDecodedGop() {
+  Gop gop;
+  if (!decodedGops.take(gop)) {
+    return false;
+  }
+  lastGopBytes = gop.frameBytes();
+  if (!gop.frames().empty()) {
+    gopAccount->setEntryBytes(gop.frameBytes() / gop.frames().size());
+  }
+  // Frames presented before the keyframe refer to the previous GOP, so the
+  // GOP was not closed and they cannot be decoded correctly
+  int64_t keyframePts = gop.firstPts();
+  for (auto &frame : gop.frames()) {
+    if (keyframePts != AV_NOPTS_VALUE && frame.pts() != AV_NOPTS_VALUE && frame.pts() < keyframePts) {
+      if (!openGopWarned) {
+        logger->warn("Open GOP in stream {}, dropping leading frames. "
+                     "GOP-parallel decoding only works for closed GOPs", streamIndex);
+        openGopWarned = true;
       }
+      continue;
     }
+    frameQueue.push(frame);
+  }
+  gop.frames().clear();
+  return true;
+}
+
+void vivictpp::workers::DecoderWorker::resetGops() {
+  if (!gopParallel()) {
+    return;
+  }
+  uint64_t seekEpoch = decodedGops.reset();
+  for (auto &gopDecoder : gopDecoders) {
+    gopDecoder->discardQueued();
+  }
+  nextGopSequenceNo = 0;
+  currentGop = Gop(0, seekEpoch);
 }
@@ -0,0 +1,115 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "workers/Executor.hh"
+#include "workers/ThreadPlacement.hh"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+static thread_local vivictpp::workers::Executor *currentExecutor = nullptr;
+static thread_local size_t currentQueue = 0;
+
+int vivictpp::workers::Executor::configuredThreadCount = 0;
+
+void vivictpp::workers::Executor::setThreadCount(int threadCount) {
+  configuredThreadCount = threadCount;
+}
+
+vivictpp::workers::Executor &vivictpp::workers::Executor::instance() {
+  static Executor executor(configuredThreadCount);
+  return executor;
+}
+
+vivictpp::workers::Executor &vivictpp::workers::Executor::background() {
+  static Executor executor(1, "vpp-background", true);
+  return executor;
+}
+
+vivictpp::workers::Executor::Executor(int threadCount, std::string threadName, bool lowPriority):
+  logger(vivictpp::logging::getOrCreateLogger("Executor")),
+  threadName(std::move(threadName)),
+  lowPriority(lowPriority) {
+  if (threadCount <= 0) {
+    threadCount = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+  }
+  logger->info("Starting executor {} with {} threads", this->threadName, threadCount);
+  for (int i = 0; i < threadCount; i++) {
+    queues.emplace_back(new WorkQueue());
+    queues.back()->tasks.reserve(64);
+  }
+  for (int i = 0; i < threadCount; i++) {
+    threads.emplace_back(&Executor::run, this, i);
+  }
+}
+
+vivictpp::workers::Executor::~Executor() {
+  running = false;
+  workAvailable.unpark();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+void vivictpp::workers::Executor::submit(Task *task) {
+  size_t index = currentExecutor == this
+    ? currentQueue
+    : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+  {
+    const std::lock_guard<std::mutex> lock(queues[index]->mutex);
+    queues[index]->tasks.push_back(task);
+  }
+  pending.fetch_add(1);
+  workAvailable.unpark();
+}
+
+void vivictpp::workers::Executor::run(size_t index) {
+  currentExecutor = this;
+  currentQueue = index;
+  setCurrentThreadName(threadName + "-" + std::to_string(index));
+  if (lowPriority) {
+    setCurrentThreadLowPriority();
+  }
+  while (true) {
+    workAvailable.park([this] { return pending.load() > 0 || !running.load(); });
+    if (!running.load()) {
+      return;
+    }
+    Task *task = take(index);
+    if (task) {
+      task->run();
+    }
+  }
+}
+
+vivictpp::workers::Task *vivictpp::workers::Executor::take(size_t index) {
+  for (size_t i = 0; i < queues.size(); i++) {
+    Task *task = takeHighestPriority(*queues[(index + i) % queues.size()]);
+    if (task) {
+      pending.fetch_sub(1);
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+vivictpp::workers::Task *vivictpp::workers::Executor::takeHighestPriority(WorkQueue &queue) {
+  const std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.tasks.empty()) {
+    return nullptr;
+  }
+  auto best = queue.tasks.begin();
+  double bestPriority = (*best)->priority();
+  for (auto it = best + 1; it != queue.tasks.end(); ++it) {
+    double priority = (*it)->priority();
+    if (priority > bestPriority) {
+      best = it;
+      bestPriority = priority;
+    }
+  }
+  Task *task = *best;
+  queue.tasks.erase(best);
+  return task;
+}
@@ -0,0 +1,220 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "workers/FilterWorker.hh"
+
+#include <algorithm>
+#include <string>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+}
+
+// Minimum depth of a frame buffer, however small the memory budget
+static constexpr int MIN_BUFFERED_FRAMES = 8;
+
+// Frames are only downscaled if that leaves at most this share of the pixels,
+// for smaller reductions scaling costs more than uploading the difference
+static constexpr double MAX_DOWNSCALED_PIXEL_SHARE = 0.75;
+
+static size_t estimateFrameBytes(AVStream *stream) {
+  AVCodecParameters *codecpar = stream->codecpar;
+  if (codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+    int size = av_image_get_buffer_size(static_cast<AVPixelFormat>(codecpar->format),
+                                        codecpar->width, codecpar->height, 1);
+    return size > 0 ? size : static_cast<size_t>(codecpar->width) * codecpar->height * 4;
+  }
+  // Audio is filtered to s16, assume stereo until the first frame is seen
+  int samples = codecpar->frame_size > 0 ? codecpar->frame_size : 1024;
+  return static_cast<size_t>(samples) * 2 * 2;
+}
+
+vivictpp::workers::FilterWorker::FilterWorker(AVStream *stream,
+                                              std::shared_ptr<vivictpp::libav::Filter> filter,
+                                              int frameBufferSize,
+                                              int frameQueueSize) :
+  InputWorker(frameQueueSize, "FilterWorker"),
+  stream(stream),
+  frameBuffer(frameBufferSize, &wakeupSignal),
+  filter(filter),
+  seekPos(vivictpp::time::NO_TIME),
+  prerollEnd(vivictpp::time::NO_TIME),
+  lastSeenPts(AV_NOPTS_VALUE)
+{
+  bool video = stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO;
+  memoryAccount = MemoryBudget::instance().open(
+    video ? MemoryBudget::Kind::VIDEO_FRAMES : MemoryBudget::Kind::AUDIO_FRAMES,
+    std::string(video ? "video" : "audio") + " frames, stream " + std::to_string(stream->index),
+    estimateFrameBytes(stream),
+    std::min(MIN_BUFFERED_FRAMES, frameBuffer.capacity()),
+    frameBuffer.capacity(),
+    [this] { return frameBuffer.bytes(); },
+    [this](MemoryBudget::Allocation allocation) { frameBuffer.setMaxSize(allocation.entries); });
+}
+
+vivictpp::workers::FilterWorker::~FilterWorker() {
+  quit();
+}
+
+void vivictpp::workers::FilterWorker::seek(vivictpp::time::Time pos, vivictpp::SeekCallback callback,
+                                           vivictpp::time::Time prerollEnd,
+                                           vivictpp::SeekToken token) {
+  seeklog->debug("vivictpp::workers::FilterWorker::seek pos={}", pos);
+  FilterWorker *fw(this);
+  uint64_t ticket = seekCallbacks.put(std::move(callback));
+  sendCommand(vivictpp::workers::Command([=](uint64_t serialNo) {
+        fw->clearDataOlderThan(serialNo);
+        fw->state = InputWorkerState::SEEKING;
+        std::queue<vivictpp::libav::Frame>().swap(fw->frameQueue);
+        fw->frameBuffer.clear();
+        fw->seekPos = pos;
+        fw->prerollEnd = prerollEnd;
+        fw->prerollFramesSkipped = 0;
+        fw->seekCallback = fw->seekCallbacks.take(ticket);
+        fw->seekToken = token;
+        return true;
+                                             }, "seek"));
+}
+
+void vivictpp::workers::FilterWorker::setDownscaleResolution(Resolution resolution) {
+  FilterWorker *fw(this);
+  sendCommand(vivictpp::workers::Command([=](uint64_t serialNo) {
+        (void) serialNo;
+        fw->logger->debug("FilterWorker::setDownscaleResolution {}x{}", resolution.w, resolution.h);
+        fw->downscaleResolution = resolution;
+        return true;
+      }, "setDownscaleResolution", vivictpp::workers::Command::Kind::SUPERSEDING));
+}
+
+FilteredVideoMetadata vivictpp::workers::FilterWorker::getFilteredVideoMetadata() {
+  std::shared_ptr<vivictpp::libav::VideoFilter> videoFilter =
+    std::dynamic_pointer_cast<vivictpp::libav::VideoFilter>(filter);
+  if (videoFilter) {
+    return videoFilter->getFilteredVideoMetadata();
+  }
+  return FilteredVideoMetadata();
+}
+
+int vivictpp::workers::FilterWorker::urgency() {
+  if (seeking()) {
+    return MAX_URGENCY;
+  }
+  int maxSize = frameBuffer.maxSize();
+  return std::max(1, MAX_URGENCY * (maxSize - frameBuffer.framesAhead()) / maxSize);
+}
+
+bool vivictpp::workers::FilterWorker::doWork() {
+  bool progress = false;
+  while (!frameQueue.empty() && frameBuffer.makeRoom()) {
+    dropFrameIfSeekingAndBufferFull();
+    addFrameToBuffer(frameQueue.front());
+    frameQueue.pop();
+    progress = true;
+  }
+  return progress;
+}
+
+bool vivictpp::workers::FilterWorker::onData(const vivictpp::workers::Data<vivictpp::libav::Frame> &data) {
+  if (!frameQueue.empty()) {
+    return false;
+  }
+  if (!seeking() && !frameBuffer.makeRoom()) {
+    logger->trace("vivictpp::workers::FilterWorker::onData frameBuffer full");
+    return false;
+  }
+  if (skipPrerollFrame(data.data)) {
+    return true;
+  }
+  if (seeking() && seekToken.obsolete()) {
+    seeklog->trace("FilterWorker::onData dropping frame of obsolete seek");
+    return true;
+  }
+  dropFrameIfSeekingAndBufferFull();
+  vivictpp::libav::Frame filtered = vivictpp::libav::Frame::emptyFrame();
+  {
+    StageTimer::Scope scope(timer);
+    filtered = filter->filterFrame(data.data);
+    filtered = downscale(filtered);
+  }
+  if (timer.getCount() % 100 == 0) {
+    logger->debug("Filter time: average {:.2f} ms/frame", timer.averageMillis());
+  }
+  if (!filtered.empty()) {
+    if (frameBuffer.isFull()) {
+      frameQueue.push(std::move(filtered));
+    } else {
+      addFrameToBuffer(filtered);
+    }
+  }
+  return true;
+}
+
+vivictpp::libav::Frame vivictpp::workers::FilterWorker::downscale(const vivictpp::libav::Frame &frame) {
+  if (frame.empty() || downscaleResolution.w <= 0 || downscaleResolution.h <= 0) {
+    return frame;
+  }
+  const AVFrame *avFrame = frame.avFrame();
+  if (downscaleResolution.w >= avFrame->width && downscaleResolution.h >= avFrame->height) {
+    return frame;
+  }
+  // Even dimensions, so that subsampled chroma covers the whole picture
+  int width = std::max(2, std::min(avFrame->width, downscaleResolution.w) & ~1);
+  int height = std::max(2, std::min(avFrame->height, downscaleResolution.h) & ~1);
+  if (width * static_cast<double>(height) >
+      MAX_DOWNSCALED_PIXEL_SHARE * avFrame->width * avFrame->height) {
+    return frame;
+  }
+  return scaler.scale(frame, width, height);
+}
+
+bool vivictpp::workers::FilterWorker::skipPrerollFrame(const vivictpp::libav::Frame &frame) {
+  if (!seeking() || vivictpp::time::isNoPts(prerollEnd) || frame.pts() == AV_NOPTS_VALUE) {
+    return false;
+  }
+  vivictpp::time::Time pts = av_rescale_q(frame.pts(), stream->time_base, vivictpp::time::TIME_BASE_Q);
+  if (pts >= prerollEnd) {
+    return false;
+  }
+  lastSeenPts = pts;
+  prerollFramesSkipped++;
+  return true;
+}
+
+void inline vivictpp::workers::FilterWorker::dropFrameIfSeekingAndBufferFull() {
+  if (seeking()) {
+    seeklog->debug("vivictpp::workers::FilterWorker::dropFrameIfSeekingAndBufferFull Dropping 1 frame from buffer");
+    frameBuffer.dropIfFull(1);
+  }
+}
+
+void vivictpp::workers::FilterWorker::addFrameToBuffer(const vivictpp::libav::Frame &frame) {
+    logger->debug("pts={} AV_NOPTS_VALUE={}", frame.pts(), AV_NOPTS_VALUE);
+    vivictpp::time::Time pts = frame.pts();
+    if (pts == AV_NOPTS_VALUE) {
+      if (lastSeenPts == AV_NOPTS_VALUE) {
+        pts = 0;
+      } else {
+        pts = lastSeenPts + av_rescale(vivictpp::time::TIME_BASE, stream->r_frame_rate.den, stream->r_frame_rate.num);
+      }
+      logger->warn("FilterWorker::addFrameToBuffer Frame has no pts, estimating pts {}", pts);
+    } else {
+      pts = av_rescale_q(pts, stream->time_base, vivictpp::time::TIME_BASE_Q);
+    }
+    lastSeenPts = pts;
+    logger->debug("FilterWorker::addFrameToBuffer Buffering frame with pts={}s ({}), frame allocations={}",
+                  pts, frame.pts(), vivictpp::libav::Frame::allocationCount());
+    frameBuffer.write(frame, pts);
+    memoryAccount->setEntryBytes(frame.byteSize());
+    if(seeking()) {
+      seeklog->debug("vivictpp::workers::FilterWorker::addFrameToBuffer written pts={} seekPos={}", pts, seekPos);
+      if (pts >= seekPos) {
+        seeklog->debug("FilterWorker::addFrameToBuffer seekFinished pts={}, {} pre-roll frames skipped",
+                       pts, prerollFramesSkipped);
+        if (this->seekCallback) {
+          this->seekCallback(pts, false);
+        }
+        this->state = InputWorkerState::ACTIVE;
+      }
+    }
+}
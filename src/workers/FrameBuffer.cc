@@ -4,253 +4,346 @@
 
 #include "workers/FrameBuffer.hh"
 
-#include <iostream>
-#include <libavutil/avutil.h>
-#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
 
 #include "logging/Logging.hh"
 
-
-
-std::string ptsBufferToString(const std::vector<vivictpp::time::Time> &ptsBuffer) {
-  std::ostringstream os;
-  int c = 0;
-  os << "[";
-  for (vivictpp::time::Time i : ptsBuffer) {
-    if (c++ > 0) {
-      os << ",";
-    }
-    os << i;
+static uint64_t nextPowerOfTwo(uint64_t n) {
+  uint64_t result = 1;
+  while (result < n) {
+    result <<= 1;
   }
-  os << "]";
-  std::string str(os.str());
-  return str;
+  return result;
 }
 
-
-vivictpp::workers::FrameBuffer::FrameBuffer(int _maxSize):
+vivictpp::workers::FrameBuffer::FrameBuffer(int _maxSize, WakeupSignal *spaceSignal):
     logger(vivictpp::logging::getOrCreateLogger("FrameBuffer")),
-    queue(_maxSize),
-    ptsBuffer(_maxSize),
-    _writePos(0, _maxSize),
-    _cursor(0, _maxSize),
-    _size(0),
     _maxSize(_maxSize),
-    mutex() {
-    for (int i = 0; i < _maxSize; i++) {
-        queue[i] = vivictpp::libav::Frame::emptyFrame();
+    _capacity(nextPowerOfTwo(_maxSize)),
+    _mask(_capacity - 1),
+    queue(_capacity, vivictpp::libav::Frame::emptyFrame()),
+    ptsBuffer(new std::atomic<vivictpp::time::Time>[_capacity]),
+    sizeBuffer(new std::atomic<size_t>[_capacity]),
+    spaceSignal(spaceSignal) {
+  for (uint64_t i = 0; i < _capacity; i++) {
+    ptsBuffer[i].store(vivictpp::time::NO_TIME, std::memory_order_relaxed);
+    sizeBuffer[i].store(0, std::memory_order_relaxed);
   }
 }
 
-bool vivictpp::workers::FrameBuffer::isFull() {
-  const std::lock_guard<std::mutex> lock(mutex);
-  return _size == _maxSize;
+void vivictpp::workers::FrameBuffer::setMaxSize(int maxSize) {
+  uint64_t newMaxSize = std::min(static_cast<uint64_t>(std::max(maxSize, 1)), _capacity);
+  uint64_t oldMaxSize = _maxSize.exchange(newMaxSize);
+  logger->debug("Max size changed from {} to {}", oldMaxSize, newMaxSize);
+  if (newMaxSize > oldMaxSize) {
+    notifyNotFull();
+  }
 }
 
-bool vivictpp::workers::FrameBuffer::waitForNotFull(const std::chrono::milliseconds& relTime) {
-  std::unique_lock<std::mutex> lock(mutex);
-  bool result = false;
-  if (_size < _maxSize) {
-    result = true;
-  } else {
-    result = conditionVariable.wait_for(lock, relTime, [&]{ return _size < _maxSize; });
+uint64_t vivictpp::workers::FrameBuffer::loadCursor() {
+  uint64_t cursor = _cursor.load();
+  uint64_t tail = _tail.load();
+  while (cursor < tail) {
+    if (_cursor.compare_exchange_weak(cursor, tail)) {
+      cursor = tail;
+    }
+    tail = _tail.load();
   }
-  logger->trace("waitForNotNull _size={} _maxSize={} returning {}", _size, _maxSize, result);
-  return result;
+  return cursor;
+}
+
+bool vivictpp::workers::FrameBuffer::isFull() {
+  return _head.load() - _tail.load() >= _maxSize.load();
+}
+
+bool vivictpp::workers::FrameBuffer::isEmpty() {
+  return _head.load() == _tail.load();
 }
 
 int vivictpp::workers::FrameBuffer::size() {
-  const std::lock_guard<std::mutex> lock(mutex);
-  return _size;
+  return static_cast<int>(_head.load() - _tail.load());
+}
+
+int vivictpp::workers::FrameBuffer::framesAhead() {
+  uint64_t head = _head.load();
+  uint64_t cursor = std::max(_cursor.load(), _tail.load());
+  return head > cursor ? static_cast<int>(head - cursor) : 0;
+}
+
+int vivictpp::workers::FrameBuffer::framesBehind() {
+  uint64_t tail = _tail.load();
+  uint64_t cursor = std::max(_cursor.load(), tail);
+  uint64_t head = _head.load();
+  return head > tail ? static_cast<int>(std::min(cursor, head - 1) - tail) : 0;
+}
+
+void vivictpp::workers::FrameBuffer::setMinFramesAhead(int minFramesAhead) {
+  _minFramesAhead.store(std::max<uint64_t>(MIN_FRAMES_AHEAD, std::max(minFramesAhead, 0)));
+}
+
+int vivictpp::workers::FrameBuffer::minFramesAhead() {
+  return static_cast<int>(minFramesAhead(_maxSize.load()));
+}
+
+// A raised minimum is limited to half the buffer, so that frames behind the
+// cursor are kept as well
+uint64_t vivictpp::workers::FrameBuffer::minFramesAhead(uint64_t maxSize) const {
+  return std::min(_minFramesAhead.load(), std::max(MIN_FRAMES_AHEAD, maxSize / 2));
+}
+
+bool vivictpp::workers::FrameBuffer::makeRoom() {
+  uint64_t tail = _tail.load();
+  uint64_t head = _head.load();
+  uint64_t maxSize = _maxSize.load();
+  if (head - tail < maxSize) {
+    return true;
+  }
+  uint64_t cursor = loadCursor();
+  uint64_t ahead = head - cursor;
+  uint64_t toDrop = 0;
+  if (head - tail > maxSize) {
+    // The max size has been lowered
+    toDrop = head - tail - maxSize + 1;
+  }
+  uint64_t minAhead = minFramesAhead(maxSize);
+  if (ahead < minAhead) {
+    toDrop = std::max(toDrop, minAhead - ahead);
+  }
+  if (toDrop == 0 || cursor <= tail) {
+    return false;
+  }
+  uint64_t newTail = std::min(cursor, tail + toDrop);
+  if (_tail.compare_exchange_strong(tail, newTail)) {
+    releaseBytes(tail, newTail);
+    logger->trace("vivictpp::workers::FrameBuffer::makeRoom dropped {} frames", newTail - tail);
+    releaseDropped();
+  }
+  return _head.load() - _tail.load() < _maxSize.load();
+}
+
+bool vivictpp::workers::FrameBuffer::waitForNotFull(const std::chrono::milliseconds& relTime) {
+  bool result = notFull.parkFor(relTime, [this]{ return makeRoom(); });
+  logger->trace("waitForNotFull size={} _maxSize={} returning {}", size(), maxSize(), result);
+  return result;
 }
 
 void vivictpp::workers::FrameBuffer::write(vivictpp::libav::Frame frame, vivictpp::time::Time pts) {
-  bool wasEmpty = false;
-  {
-    const std::lock_guard<std::mutex> lock(mutex);
-    if (_size == _maxSize) {
-      throw std::runtime_error("Buffer is full");
-    }
-    wasEmpty = _size == 0;
-    queue[_writePos] = frame;
-    ptsBuffer[_writePos.getValue()] = pts;
-    _writePos = _writePos + 1;
-    _size++;
+  uint64_t head = _head.load(std::memory_order_relaxed);
+  // Checked against the capacity, since the max size may have been lowered
+  // after the writer made room
+  if (head - _tail.load() >= _capacity) {
+    throw std::runtime_error("Buffer is full");
   }
-  if (wasEmpty) {
-    conditionVariable.notify_all();
+  releaseDropped();
+  // The slot was last used by index head - _capacity, which is below the
+  // tail. Wait for the reader in the unlikely case it is still copying it.
+  if (head >= _capacity) {
+    while (readerPin.load() == head - _capacity) {
+      std::this_thread::yield();
+    }
+    _released = std::max(_released, head - _capacity + 1);
   }
-  logger->debug("Wrote frame with pts {}, size is now {}", pts, _size);
-  logger->trace("_size={}, ptsBuffer: {}", _size, ptsBufferToString(ptsBuffer));
+  size_t frameBytes = frame.byteSize();
+  queue[head & _mask] = std::move(frame);
+  ptsBuffer[head & _mask].store(pts, std::memory_order_relaxed);
+  sizeBuffer[head & _mask].store(frameBytes, std::memory_order_relaxed);
+  _bytes.fetch_add(frameBytes);
+  _head.store(head + 1);
+  notEmpty.unpark();
+  logger->debug("Wrote frame with pts {}, size is now {}", pts, size());
 }
 
-bool vivictpp::workers::FrameBuffer::isEmpty() {
-  const std::lock_guard<std::mutex> lock(mutex);
-  return _size == 0;
+void vivictpp::workers::FrameBuffer::releaseDropped() {
+  uint64_t tail = _tail.load();
+  for (; _released < tail; _released++) {
+    if (readerPin.load() == _released) {
+      return;
+    }
+    if (dropListener && _released >= _noticeFrom) {
+      uint64_t next = _released + 1;
+      dropListener(queue[_released & _mask], ptsAt(_released),
+                   next < _head.load(std::memory_order_relaxed) ? ptsAt(next) : vivictpp::time::NO_TIME);
+    }
+    queue[_released & _mask] = vivictpp::libav::Frame::emptyFrame();
+  }
 }
 
 vivictpp::libav::Frame vivictpp::workers::FrameBuffer::first() {
   logger->trace("vivictpp::workers::FrameBuffer::first enter");
-  std::unique_lock<std::mutex> lock(mutex);
-  conditionVariable.wait(lock, [&]{ return _size > 0; });
-  logger->trace("vivictpp::workers::FrameBuffer::first exit");
-  return queue[_cursor.getValue()];
+  notEmpty.park([this]{ return !isEmpty(); });
+  while (true) {
+    uint64_t cursor = loadCursor();
+    readerPin.store(cursor);
+    if (cursor >= _tail.load() && cursor < _head.load()) {
+      vivictpp::libav::Frame frame = queue[cursor & _mask];
+      readerPin.store(NOT_PINNED);
+      logger->trace("vivictpp::workers::FrameBuffer::first exit");
+      return frame;
+    }
+    readerPin.store(NOT_PINNED);
+    if (isEmpty()) {
+      // Cleared by the writer, wait for the next frame
+      notEmpty.park([this]{ return !isEmpty(); });
+    }
+  }
+}
+
+vivictpp::libav::Frame vivictpp::workers::FrameBuffer::frameAt(int offset) {
+  uint64_t cursor = loadCursor();
+  if (offset < 0 && static_cast<uint64_t>(-offset) > cursor) {
+    return vivictpp::libav::Frame::emptyFrame();
+  }
+  uint64_t index = cursor + offset;
+  readerPin.store(index);
+  vivictpp::libav::Frame frame = vivictpp::libav::Frame::emptyFrame();
+  if (index >= _tail.load() && index < _head.load()) {
+    frame = queue[index & _mask];
+  }
+  readerPin.store(NOT_PINNED);
+  return frame;
 }
 
 vivictpp::time::Time vivictpp::workers::FrameBuffer::currentPts() {
-  const std::lock_guard<std::mutex> lock(mutex);
-  if (_size == 0) {
+  uint64_t cursor = loadCursor();
+  if (cursor >= _head.load()) {
     return 0;
   }
-  return ptsBuffer[_cursor.getValue()];
+  return ptsAt(cursor);
 }
 
 bool vivictpp::workers::FrameBuffer::ptsInRange(vivictpp::time::Time pts) {
-  logger->trace("vivictpp::workers::FrameBuffer::ptsInRange pts={} minPts={} maxPts={}", pts, minPts(), maxPts());
+  uint64_t tail = _tail.load();
+  uint64_t head = _head.load();
   bool result;
-  const std::lock_guard<std::mutex> lock(mutex);
-  if (_size == 0) {
-    result=false;
-  }
-  else if (_size == 1) {
-    result = pts == ptsBuffer[_cursor.getValue()];
+  if (head == tail) {
+    result = false;
+  } else if (head - tail == 1) {
+    result = pts == ptsAt(tail);
   } else {
-      result = this->minPts() <= pts && pts <= this->maxPts();
+    result = ptsAt(tail) <= pts && pts <= ptsAt(head - 1);
   }
-//  if (!result) {
-      logger->trace("_size={}, ptsBuffer: {}", _size, ptsBufferToString(ptsBuffer));
-//  }
+  logger->trace("vivictpp::workers::FrameBuffer::ptsInRange pts={} size={} result={}",
+                pts, head - tail, result);
   return result;
 }
 
-vivictpp::time::Time vivictpp::workers::FrameBuffer::minPts() { return ptsBuffer[this->tail().getValue()]; }
+vivictpp::time::Time vivictpp::workers::FrameBuffer::minPts() { return ptsAt(_tail.load()); }
 
 vivictpp::time::Time vivictpp::workers::FrameBuffer::maxPts() {
-  QueuePointer index = _writePos - 1;
-  logger->debug("maxPts() maxPts={}", ptsBuffer[index.getValue()]);
-  return ptsBuffer[index.getValue()];
-}
-
-bool vivictpp::workers::FrameBuffer::previous() {
-  const std::lock_guard<std::mutex> lock(mutex);
-  if (_cursor != tail()) {
-    _cursor = _cursor - 1;
-    return true;
-  }
-  return false;
+  vivictpp::time::Time maxPts = ptsAt(_head.load() - 1);
+  logger->debug("maxPts() maxPts={}", maxPts);
+  return maxPts;
 }
 
-bool vivictpp::workers::FrameBuffer::next() {
-  int dropN = 0;
-  bool result = false;
-  {
-    const std::lock_guard<std::mutex> lock(mutex);
-
-    if (_size > 1 && _cursor + 1 != _writePos) {
-      _cursor = _cursor + 1;
-      int distance = _cursor.distance(_writePos);
-      if (_size == _maxSize && distance < 5) {
-        dropN = 5 - distance;
+int vivictpp::workers::FrameBuffer::stepForward(vivictpp::time::Time pts) {
+  while (true) {
+    uint64_t cursor = loadCursor();
+    uint64_t head = _head.load();
+    uint64_t target = cursor;
+    while (target + 1 < head) {
+      vivictpp::time::Time nextPts = ptsAt(target + 1);
+      if (vivictpp::time::isNoPts(nextPts) || nextPts > pts) {
+        break;
       }
-      result = true;
+      target++;
+    }
+    if (target == cursor) {
+      return 0;
+    }
+    if (_cursor.compare_exchange_strong(cursor, target)) {
+      if (isFull()) {
+        notifyNotFull();
+      }
+      return static_cast<int>(target - cursor);
     }
   }
-  if (dropN > 0) {
-    drop(dropN);
-  }
-  return result;
-}
-
-int vivictpp::workers::FrameBuffer::stepForward(vivictpp::time::Time pts) {
-  int c = 0;
-  vivictpp::time::Time nextPts = this->nextPts();
-  while (!vivictpp::time::isNoPts(nextPts) && nextPts <= pts && next()) {
-    c++;
-    nextPts = this->nextPts();
-  }
-  return c;
 }
 
 void vivictpp::workers::FrameBuffer::stepBackward(vivictpp::time::Time pts) {
-  logger->debug("vivictpp::workers::Framebuffer::stepBackward entry _cursor={}, pts={}",
-                _cursor.getValue(), pts);
-  while (ptsBuffer[(_cursor - 1).getValue()] >= pts && previous()) {
-    logger->trace("vivictpp::workers::Framebuffer::stepBackward _cursor={}, pts={}",
-                  _cursor.getValue(), pts);
+  while (true) {
+    uint64_t cursor = loadCursor();
+    uint64_t tail = _tail.load();
+    logger->debug("vivictpp::workers::Framebuffer::stepBackward entry cursor={}, pts={}",
+                  cursor, pts);
+    uint64_t target = cursor;
+    while (target > tail && ptsAt(target - 1) >= pts) {
+      target--;
+    }
+    if (target == cursor || _cursor.compare_exchange_strong(cursor, target)) {
+      return;
+    }
   }
 }
 
 vivictpp::time::Time vivictpp::workers::FrameBuffer::nextPts() {
-  const std::lock_guard<std::mutex> lock(mutex);
+  uint64_t cursor = loadCursor();
+  uint64_t head = _head.load();
   vivictpp::time::Time nextPts;
-  if (_size == 0 || _cursor + 1 == _writePos) {
+  if (cursor + 1 >= head) {
     nextPts = vivictpp::time::NO_TIME;
   } else {
-    nextPts = ptsBuffer[(_cursor + 1).getValue()];
-  }
-  logger->debug("vivictpp::workers::FrameBuffer::nextPts _size={} _cursor={} nextPts={}", _size,
-                _cursor.getValue(), nextPts);
-  if (nextPts < 0.01) {
-    logger->debug("vivictpp::workers::FrameBuffer::nextPts ptsBuffer={}",
-                  ptsBufferToString(ptsBuffer));
+    nextPts = ptsAt(cursor + 1);
   }
+  logger->debug("vivictpp::workers::FrameBuffer::nextPts cursor={} head={} nextPts={}",
+                cursor, head, nextPts);
   return nextPts;
 }
 
 vivictpp::time::Time vivictpp::workers::FrameBuffer::previousPts() {
-  const std::lock_guard<std::mutex> lock(mutex);
+  uint64_t cursor = loadCursor();
   vivictpp::time::Time previousPts;
-  if (_size == 0 || _cursor == this->tail()) {
+  if (cursor >= _head.load() || cursor == _tail.load()) {
     previousPts = vivictpp::time::NO_TIME;
   } else {
-    previousPts = ptsBuffer[(_cursor - 1).getValue()];
-  }
-  logger->debug("vivictpp::workers::FrameBuffer::previousPts _size={} _cursor={} previousPts={}", _size,
-                _cursor.getValue(), previousPts);
-  if (previousPts < 0.01) {
-    logger->debug("vivictpp::workers::FrameBuffer::previousPts ptsBuffer={}",
-                  ptsBufferToString(ptsBuffer));
+    previousPts = ptsAt(cursor - 1);
   }
+  logger->debug("vivictpp::workers::FrameBuffer::previousPts cursor={} previousPts={}",
+                cursor, previousPts);
   return previousPts;
 }
 
 void vivictpp::workers::FrameBuffer::drop(int n) {
-  {
-    const std::lock_guard<std::mutex> lock(mutex);
-    _drop(n);
+  logger->trace("vivictpp::workers::FrameBuffer::drop n={}", n);
+  uint64_t tail = _tail.load();
+  uint64_t newTail;
+  do {
+    newTail = std::min(_head.load(), tail + n);
+  } while (newTail > tail && !_tail.compare_exchange_weak(tail, newTail));
+  if (newTail > tail) {
+    releaseBytes(tail, newTail);
   }
-  conditionVariable.notify_all();
+  notifyNotFull();
 }
 
-
-void vivictpp::workers::FrameBuffer::_drop(int n) {
-    logger->trace("vivictpp::workers::FrameBuffer::_drop n={}", n);
-  for (int i = 0; i < n && _size > 0; i++) {
-    if (_cursor == this->tail()) {
-      _cursor = _cursor + 1;
-    }
-    queue[this->tail().getValue()] = vivictpp::libav::Frame::emptyFrame();
-    _size--;
+void vivictpp::workers::FrameBuffer::dropIfFull(int n) {
+  if (isFull()) {
+    drop(n);
   }
 }
 
+void vivictpp::workers::FrameBuffer::clear() {
+  uint64_t head = _head.load(std::memory_order_relaxed);
+  uint64_t tail = _tail.exchange(head);
+  releaseBytes(tail, head);
+  _cursor.store(head);
+  _noticeFrom = head;
+  releaseDropped();
+  notifyNotFull();
+}
 
-void vivictpp::workers::FrameBuffer::dropIfFull(int n) {
-  {
-    const std::lock_guard<std::mutex> lock(mutex);
-    if (_size < _maxSize) {
-      return;
-    }
+void vivictpp::workers::FrameBuffer::releaseBytes(uint64_t begin, uint64_t end) {
+  size_t released = 0;
+  for (uint64_t i = begin; i < end; i++) {
+    released += sizeBuffer[i & _mask].load(std::memory_order_relaxed);
   }
-  drop(n);
+  _bytes.fetch_sub(released);
 }
 
-void vivictpp::workers::FrameBuffer::clear() {
-  {
-    const std::lock_guard<std::mutex> lock(mutex);
-    _drop(_size);
-    _cursor = 0;
-    _writePos = 0;
+void vivictpp::workers::FrameBuffer::notifyNotFull() {
+  notFull.unpark();
+  if (spaceSignal) {
+    spaceSignal->notify();
   }
-  conditionVariable.notify_all();
 }
@@ -0,0 +1,305 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "workers/FrameHistory.hh"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+vivictpp::workers::FrameHistory::FrameHistory(size_t maxBytes):
+  _maxBytes(maxBytes) {
+}
+
+void vivictpp::workers::FrameHistory::add(std::map<vivictpp::time::Time, vivictpp::libav::Frame> frames,
+                                          vivictpp::time::Time endPts) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  if (entries.empty()) {
+    _endPts = endPts;
+  } else if (endPts != entries.begin()->first) {
+    return;
+  }
+  for (auto it = frames.begin(); it != frames.end() && it->first < endPts; ++it) {
+    Entry entry;
+    entry.frame = std::move(it->second);
+    addEntry(it->first, std::move(entry));
+  }
+  dropExcess();
+}
+
+void vivictpp::workers::FrameHistory::append(const vivictpp::libav::Frame &frame,
+                                             vivictpp::time::Time pts,
+                                             vivictpp::time::Time nextPts) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  if (!entries.empty() && pts != _endPts) {
+    clearEntries();
+  }
+  Entry entry;
+  entry.frame = frame;
+  addEntry(pts, std::move(entry));
+  _endPts = nextPts;
+  dropExcess();
+}
+
+void vivictpp::workers::FrameHistory::clear() {
+  const std::lock_guard<std::mutex> lock(mutex);
+  clearEntries();
+  _endPts = vivictpp::time::NO_TIME;
+  position = vivictpp::time::NO_TIME;
+}
+
+void vivictpp::workers::FrameHistory::setMaxBytes(size_t maxBytes) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  _maxBytes = maxBytes;
+  dropExcess();
+}
+
+void vivictpp::workers::FrameHistory::setPosition(vivictpp::time::Time pts) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  position = pts;
+}
+
+int vivictpp::workers::FrameHistory::size() {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return static_cast<int>(entries.size());
+}
+
+size_t vivictpp::workers::FrameHistory::bytes() {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return _bytes;
+}
+
+bool vivictpp::workers::FrameHistory::full() {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return !entries.empty() && _bytes + _bytes / entries.size() > _maxBytes;
+}
+
+vivictpp::time::Time vivictpp::workers::FrameHistory::endPts() {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return entries.empty() ? vivictpp::time::NO_TIME : _endPts;
+}
+
+vivictpp::time::Time vivictpp::workers::FrameHistory::firstPts() {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return entries.empty() ? vivictpp::time::NO_TIME : entries.begin()->first;
+}
+
+vivictpp::time::Time vivictpp::workers::FrameHistory::lastPts() {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return entries.empty() ? vivictpp::time::NO_TIME : entries.rbegin()->first;
+}
+
+bool vivictpp::workers::FrameHistory::joins(vivictpp::time::Time bufferStart) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return !entries.empty() && !vivictpp::time::isNoPts(bufferStart) && bufferStart == _endPts;
+}
+
+int vivictpp::workers::FrameHistory::framesBefore(vivictpp::time::Time pts) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return static_cast<int>(std::distance(entries.begin(), entries.lower_bound(pts)));
+}
+
+vivictpp::time::Time vivictpp::workers::FrameHistory::ptsAtOrAfter(vivictpp::time::Time pts) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.lower_bound(pts);
+  return it == entries.end() ? vivictpp::time::NO_TIME : it->first;
+}
+
+vivictpp::time::Time vivictpp::workers::FrameHistory::ptsAtOrBefore(vivictpp::time::Time pts) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.upper_bound(pts);
+  return it == entries.begin() ? vivictpp::time::NO_TIME : std::prev(it)->first;
+}
+
+vivictpp::time::Time vivictpp::workers::FrameHistory::previousPts(vivictpp::time::Time pts) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.lower_bound(pts);
+  return it == entries.begin() ? vivictpp::time::NO_TIME : std::prev(it)->first;
+}
+
+vivictpp::time::Time vivictpp::workers::FrameHistory::nextPts(vivictpp::time::Time pts) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.upper_bound(pts);
+  return it == entries.end() ? vivictpp::time::NO_TIME : it->first;
+}
+
+vivictpp::libav::Frame vivictpp::workers::FrameHistory::frame(vivictpp::time::Time pts) {
+  std::shared_ptr<const vivictpp::libav::CompressedFrame> compressed;
+  {
+    const std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(pts);
+    if (it == entries.end()) {
+      return vivictpp::libav::Frame::emptyFrame();
+    }
+    if (!it->second.frame.empty()) {
+      return it->second.frame;
+    }
+    compressed = it->second.compressed;
+  }
+  vivictpp::libav::Frame frame = compressed->decompress();
+  const std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.find(pts);
+  if (!frame.empty() && it != entries.end() && it->second.compressed == compressed &&
+      it->second.frame.empty()) {
+    it->second.frame = frame;
+    _bytes += frame.byteSize();
+    dropExcess();
+  }
+  return frame;
+}
+
+std::vector<vivictpp::libav::Frame>
+vivictpp::workers::FrameHistory::framesAround(vivictpp::time::Time pts, int distance) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  std::vector<vivictpp::libav::Frame> result;
+  auto it = entries.find(pts);
+  if (it == entries.end()) {
+    return result;
+  }
+  auto after = std::next(it);
+  auto before = it;
+  for (int d = 1; d <= distance; d++) {
+    if (after != entries.end()) {
+      if (!after->second.frame.empty()) {
+        result.push_back(after->second.frame);
+      }
+      ++after;
+    }
+    if (before != entries.begin()) {
+      --before;
+      if (!before->second.frame.empty()) {
+        result.push_back(before->second.frame);
+      }
+    }
+  }
+  return result;
+}
+
+// The frames nearest the end are compressed first, they are the ones that
+// are kept longest
+size_t vivictpp::workers::FrameHistory::compressOne() {
+  vivictpp::time::Time pts;
+  vivictpp::libav::Frame frame = vivictpp::libav::Frame::emptyFrame();
+  {
+    const std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+      const Entry &entry = it->second;
+      if (!entry.compressed && !entry.incompressible && !nearPosition(std::prev(it.base()))) {
+        pts = it->first;
+        frame = entry.frame;
+        break;
+      }
+    }
+  }
+  if (frame.empty()) {
+    return 0;
+  }
+  std::shared_ptr<const vivictpp::libav::CompressedFrame> compressed =
+    vivictpp::libav::CompressedFrame::compress(frame);
+  const std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.find(pts);
+  if (it == entries.end() || it->second.frame.avFrame() != frame.avFrame() ||
+      it->second.compressed) {
+    return frame.byteSize();
+  }
+  Entry &entry = it->second;
+  size_t oldBytes = entry.bytes();
+  if (compressed) {
+    entry.compressed = compressed;
+    if (!nearPosition(it)) {
+      entry.frame = vivictpp::libav::Frame::emptyFrame();
+    }
+  } else {
+    entry.incompressible = true;
+  }
+  _bytes = _bytes - oldBytes + entry.bytes();
+  dropExcess();
+  return compressed ? compressed->byteSize() : frame.byteSize();
+}
+
+bool vivictpp::workers::FrameHistory::warmOne() {
+  vivictpp::time::Time pts;
+  std::shared_ptr<const vivictpp::libav::CompressedFrame> compressed;
+  {
+    const std::lock_guard<std::mutex> lock(mutex);
+    bool released = false;
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+      Entry &entry = it->second;
+      if (!entry.compressed) {
+        continue;
+      }
+      bool near = nearPosition(it);
+      if (!near && !entry.frame.empty()) {
+        _bytes -= entry.frame.byteSize();
+        entry.frame = vivictpp::libav::Frame::emptyFrame();
+        released = true;
+      } else if (near && entry.frame.empty() && !compressed) {
+        // The earliest first, stepping backwards is what the history is for
+        pts = it->first;
+        compressed = entry.compressed;
+      }
+    }
+    if (!compressed) {
+      return released;
+    }
+  }
+  vivictpp::libav::Frame frame = compressed->decompress();
+  const std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.find(pts);
+  if (!frame.empty() && it != entries.end() && it->second.compressed == compressed &&
+      it->second.frame.empty()) {
+    it->second.frame = frame;
+    _bytes += frame.byteSize();
+    dropExcess();
+  }
+  return true;
+}
+
+// While a buffered frame is shown the position is the end of the history,
+// where stepping backwards enters it
+bool vivictpp::workers::FrameHistory::nearPosition(Entries::const_iterator it) {
+  Entries::const_iterator center = vivictpp::time::isNoPts(position) ? entries.end()
+    : entries.lower_bound(position);
+  for (int d = 0; d <= NEAR_POSITION; d++) {
+    if (center == it) {
+      return true;
+    }
+    if (center == entries.begin()) {
+      break;
+    }
+    --center;
+  }
+  center = vivictpp::time::isNoPts(position) ? entries.end() : entries.lower_bound(position);
+  for (int d = 0; d < NEAR_POSITION && center != entries.end(); d++) {
+    if (++center == it) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void vivictpp::workers::FrameHistory::addEntry(vivictpp::time::Time pts, Entry entry) {
+  auto it = entries.find(pts);
+  if (it != entries.end()) {
+    eraseEntry(it);
+  }
+  _bytes += entry.bytes();
+  entries.emplace(pts, std::move(entry));
+}
+
+void vivictpp::workers::FrameHistory::eraseEntry(Entries::iterator it) {
+  _bytes -= it->second.bytes();
+  entries.erase(it);
+}
+
+void vivictpp::workers::FrameHistory::clearEntries() {
+  entries.clear();
+  _bytes = 0;
+}
+
+void vivictpp::workers::FrameHistory::dropExcess() {
+  while (_bytes > _maxBytes && !entries.empty()) {
+    eraseEntry(entries.begin());
+  }
+}
@@ -0,0 +1,80 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "workers/Gop.hh"
+
+vivictpp::workers::Gop::Gop(uint64_t sequenceNo, uint64_t seekEpoch):
+  state(std::make_shared<State>()) {
+  state->sequenceNo = sequenceNo;
+  state->seekEpoch = seekEpoch;
+}
+
+void vivictpp::workers::Gop::addPacket(const vivictpp::libav::Packet &packet) {
+  state->packets.push_back(packet);
+  state->bytes += packet.byteSize();
+}
+
+void vivictpp::workers::Gop::addFrame(vivictpp::libav::Frame frame) {
+  state->frameBytes += frame.byteSize();
+  state->frames.push_back(std::move(frame));
+}
+
+int64_t vivictpp::workers::Gop::firstPts() const {
+  if (state->packets.empty() || !state->packets[0].avPacket()) {
+    return AV_NOPTS_VALUE;
+  }
+  return state->packets[0].avPacket()->pts;
+}
+
+bool vivictpp::workers::DecodedGops::put(const Gop &gop) {
+  std::lock_guard<std::mutex> guard(mutex);
+  if (gop.seekEpoch() != epoch || gop.sequenceNo() < nextToTake) {
+    return false;
+  }
+  if (gops.emplace(gop.sequenceNo(), gop).second) {
+    bytes += gop.frameBytes();
+  }
+  return true;
+}
+
+bool vivictpp::workers::DecodedGops::take(Gop &gop) {
+  std::lock_guard<std::mutex> guard(mutex);
+  auto it = gops.find(nextToTake);
+  if (it == gops.end()) {
+    return false;
+  }
+  gop = it->second;
+  gops.erase(it);
+  bytes -= gop.frameBytes();
+  nextToTake++;
+  return true;
+}
+
+uint64_t vivictpp::workers::DecodedGops::reset() {
+  std::lock_guard<std::mutex> guard(mutex);
+  gops.clear();
+  bytes = 0;
+  nextToTake = 0;
+  return ++epoch;
+}
+
+uint64_t vivictpp::workers::DecodedGops::seekEpoch() {
+  std::lock_guard<std::mutex> guard(mutex);
+  return epoch;
+}
+
+uint64_t vivictpp::workers::DecodedGops::nextSequenceNo() {
+  std::lock_guard<std::mutex> guard(mutex);
+  return nextToTake;
+}
+
+size_t vivictpp::workers::DecodedGops::size() {
+  std::lock_guard<std::mutex> guard(mutex);
+  return gops.size();
+}
+
+size_t vivictpp::workers::DecodedGops::frameBytes() {
+  std::lock_guard<std::mutex> guard(mutex);
+  return bytes;
+}
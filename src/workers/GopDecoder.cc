@@ -0,0 +1,44 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "workers/GopDecoder.hh"
+
+vivictpp::workers::GopDecoder::GopDecoder(AVStream *stream,
+                                          const vivictpp::libav::DecoderOptions &decoderOptions,
+                                          std::function<void(const Gop &)> onDecoded,
+                                          std::function<int()> urgencyFunction):
+  InputWorker(1, "GopDecoder"),
+  decoder(stream->codecpar, decoderOptions),
+  onDecoded(onDecoded),
+  urgencyFunction(urgencyFunction) {
+}
+
+vivictpp::workers::GopDecoder::~GopDecoder() {
+  quit();
+}
+
+void vivictpp::workers::GopDecoder::discardQueued() {
+  GopDecoder *gd(this);
+  sendCommand(vivictpp::workers::Command([=](uint64_t serialNo) {
+        gd->clearDataOlderThan(serialNo);
+        return true;
+      }, "discardQueued"));
+}
+
+bool vivictpp::workers::GopDecoder::onData(const vivictpp::workers::Data<Gop> &data) {
+  Gop gop = data.data;
+  for (const auto &packet : gop.packets()) {
+    for (auto &frame : decoder.handlePacket(packet)) {
+      gop.addFrame(std::move(frame));
+    }
+  }
+  // Drain the frames still held by the decoder
+  for (auto &frame : decoder.handlePacket(vivictpp::libav::Packet())) {
+    gop.addFrame(std::move(frame));
+  }
+  logger->trace("GopDecoder::onData sequenceNo={} packets={} frames={}",
+                gop.sequenceNo(), gop.packets().size(), gop.frames().size());
+  onDecoded(gop);
+  return true;
+}
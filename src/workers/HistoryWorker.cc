@@ -0,0 +1,185 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "workers/HistoryWorker.hh"
+
+#include <stdexcept>
+#include <utility>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+}
+
+static size_t estimateFrameBytes(const AVCodecParameters *codecpar) {
+  int size = av_image_get_buffer_size(static_cast<AVPixelFormat>(codecpar->format),
+                                      codecpar->width, codecpar->height, 1);
+  return size > 0 ? size : static_cast<size_t>(codecpar->width) * codecpar->height * 4;
+}
+
+vivictpp::workers::HistoryWorker::HistoryWorker(std::string source, std::string format,
+                                                const AVStream *stream,
+                                                std::string customFilter,
+                                                vivictpp::libav::DecoderOptions decoderOptions,
+                                                std::shared_ptr<vivictpp::libav::FrameIndex> frameIndex,
+                                                std::shared_ptr<FrameHistory> history,
+                                                int maxFrames):
+  InputWorker<int>(0, "HistoryWorker", Executor::background()),
+  source(std::move(source)),
+  format(std::move(format)),
+  streamIndex(stream->index),
+  customFilter(std::move(customFilter)),
+  decoderOptions(std::move(decoderOptions)),
+  frameIndex(std::move(frameIndex)),
+  history(std::move(history)),
+  maxFrames(maxFrames) {
+  // Until the first frame is compressed, assume it halves the size
+  memoryAccount = MemoryBudget::instance().open(
+    MemoryBudget::Kind::VIDEO_FRAMES, "frame history, stream " + std::to_string(streamIndex),
+    estimateFrameBytes(stream->codecpar) / 2, 0, maxFrames,
+    [this] { return this->history->bytes(); },
+    [this](MemoryBudget::Allocation allocation) { this->history->setMaxBytes(allocation.bytes); });
+}
+
+vivictpp::workers::HistoryWorker::~HistoryWorker() {
+  quit();
+}
+
+void vivictpp::workers::HistoryWorker::prefetch(vivictpp::time::Time startPts,
+                                                vivictpp::time::Time endPts) {
+  if (endPts == requestedEndPts) {
+    return;
+  }
+  requestedEndPts = endPts;
+  HistoryWorker *hw(this);
+  sendCommand(vivictpp::workers::Command([=](uint64_t serialNo) {
+        (void) serialNo;
+        hw->logger->debug("HistoryWorker::prefetch startPts={} endPts={}", startPts, endPts);
+        hw->startPts = startPts;
+        hw->endPts = endPts;
+        hw->started = false;
+        return true;
+      }, "prefetch", vivictpp::workers::Command::Kind::SUPERSEDING));
+}
+
+void vivictpp::workers::HistoryWorker::cancel() {
+  if (vivictpp::time::isNoPts(requestedEndPts)) {
+    return;
+  }
+  requestedEndPts = vivictpp::time::NO_TIME;
+  HistoryWorker *hw(this);
+  sendCommand(vivictpp::workers::Command([=](uint64_t serialNo) {
+        (void) serialNo;
+        hw->endPts = vivictpp::time::NO_TIME;
+        hw->started = false;
+        hw->frames.clear();
+        return true;
+      }, "cancel"));
+}
+
+void vivictpp::workers::HistoryWorker::open() {
+  formatHandler.reset(new vivictpp::libav::FormatHandler(source, format));
+  formatHandler->setActiveStreams({streamIndex});
+  formatHandler->setFrameIndex(frameIndex);
+  AVStream *stream = formatHandler->getStreams()[streamIndex];
+  decoder.reset(new vivictpp::libav::Decoder(stream->codecpar, decoderOptions));
+  std::string definition = customFilter.empty() ? "null" : customFilter + ",null";
+  filter.reset(new vivictpp::libav::VideoFilter(stream, decoder->getCodecContext(), definition,
+                                                decoder->getFramePool()));
+}
+
+// Decompressing the frames the user is about to step to comes first, then
+// compressing, and decoding more frames last
+bool vivictpp::workers::HistoryWorker::doWork() {
+  if (history->warmOne()) {
+    return true;
+  }
+  size_t compressedBytes = history->compressOne();
+  if (compressedBytes > 0) {
+    memoryAccount->setEntryBytes(compressedBytes);
+    return true;
+  }
+  if (failed || vivictpp::time::isNoPts(endPts)) {
+    return false;
+  }
+  try {
+    if (!formatHandler) {
+      open();
+    }
+    if (!started) {
+      formatHandler->seek(startPts);
+      decoder->flush();
+      frames.clear();
+      packetsRead = 0;
+      started = true;
+    }
+    bool done = false;
+    AVPacket *packet = formatHandler->nextPacket();
+    if (!packet) {
+      // End of input, the frames still in the decoder are the last ones
+      for (const auto &frame : decoder->handlePacket(vivictpp::libav::Packet())) {
+        addFrame(frame, done);
+      }
+      done = true;
+    } else {
+      bool ours = packet->stream_index == streamIndex;
+      vivictpp::libav::Packet ourPacket = ours ? vivictpp::libav::Packet(packet)
+        : vivictpp::libav::Packet();
+      av_packet_unref(packet);
+      if (ours) {
+        for (const auto &frame : decoder->handlePacket(ourPacket)) {
+          addFrame(frame, done);
+        }
+        done = done || ++packetsRead >= MAX_PACKETS_PER_PREFETCH;
+      }
+    }
+    if (done) {
+      finish();
+    }
+  } catch (const std::runtime_error &e) {
+    // Stepping backwards still works by seeking
+    logger->warn("Decoding frame history of {} stopped: {}", source, e.what());
+    failed = true;
+    frames.clear();
+    filter.reset();
+    decoder.reset();
+    formatHandler.reset();
+    return false;
+  }
+  return true;
+}
+
+// Frames come out of the decoder in pts order, so the first one at or after
+// endPts ends the prefetch
+void vivictpp::workers::HistoryWorker::addFrame(const vivictpp::libav::Frame &frame, bool &done) {
+  if (done) {
+    return;
+  }
+  vivictpp::libav::Frame filtered = filter->filterFrame(frame);
+  if (filtered.empty() || filtered.pts() == AV_NOPTS_VALUE) {
+    return;
+  }
+  vivictpp::time::Time pts = av_rescale_q(filtered.pts(),
+                                          formatHandler->getStreams()[streamIndex]->time_base,
+                                          vivictpp::time::TIME_BASE_Q);
+  if (pts >= endPts) {
+    done = true;
+    return;
+  }
+  if (pts < startPts) {
+    return;
+  }
+  frames[pts] = filtered;
+  // Only the frames closest to endPts are kept, also while decoding
+  while (frames.size() > static_cast<size_t>(maxFrames)) {
+    frames.erase(frames.begin());
+  }
+}
+
+void vivictpp::workers::HistoryWorker::finish() {
+  logger->debug("HistoryWorker::finish {} frames before {}", frames.size(), endPts);
+  history->add(std::move(frames), endPts);
+  frames.clear();
+  endPts = vivictpp::time::NO_TIME;
+  started = false;
+}
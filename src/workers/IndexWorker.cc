@@ -0,0 +1,92 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "workers/IndexWorker.hh"
+
+#include "libav/InputCache.hh"
+
+#include <set>
+#include <stdexcept>
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+vivictpp::workers::IndexWorker::IndexWorker(std::string source, std::string format,
+                                            std::shared_ptr<vivictpp::libav::FrameIndex> frameIndex):
+  InputWorker<int>(0, "IndexWorker", Executor::background()),
+  source(std::move(source)),
+  format(std::move(format)),
+  frameIndex(std::move(frameIndex)) {
+}
+
+vivictpp::workers::IndexWorker::~IndexWorker() {
+  quit();
+}
+
+void vivictpp::workers::IndexWorker::open() {
+  startTime = av_gettime_relative();
+  formatHandler.reset(new vivictpp::libav::FormatHandler(source, format));
+  std::set<int> streams;
+  for (AVStream *stream : formatHandler->getVideoStreams()) {
+    streams.insert(stream->index);
+  }
+  for (AVStream *stream : formatHandler->getAudioStreams()) {
+    streams.insert(stream->index);
+  }
+  formatHandler->setActiveStreams(streams);
+}
+
+bool vivictpp::workers::IndexWorker::doWork() {
+  if (done) {
+    return false;
+  }
+  try {
+    if (!formatHandler) {
+      if (vivictpp::libav::InputCache(source).restoreFrameIndex(*frameIndex)) {
+        done = true;
+        return false;
+      }
+      open();
+    }
+    for (int i = 0; i < PACKETS_PER_STEP; i++) {
+      AVPacket *packet = formatHandler->nextPacket();
+      if (!packet) {
+        frameIndex->setComplete();
+        logger->info("Indexed {} in {:.2f}s", source,
+                     (av_gettime_relative() - startTime) / 1e6);
+        vivictpp::libav::InputCache(source).save(formatHandler->getFormatContext(), *frameIndex);
+        done = true;
+        formatHandler.reset();
+        return false;
+      }
+      addPacket(packet);
+      av_packet_unref(packet);
+    }
+  } catch (const std::runtime_error &e) {
+    // Seeking still works without the index, only less exactly
+    logger->warn("Indexing of {} stopped: {}", source, e.what());
+    done = true;
+    formatHandler.reset();
+    return false;
+  }
+  return true;
+}
+
+void vivictpp::workers::IndexWorker::addPacket(const AVPacket *packet) {
+  int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+  if (pts == AV_NOPTS_VALUE) {
+    return;
+  }
+  int64_t dts = packet->dts != AV_NOPTS_VALUE ? packet->dts : pts;
+  AVRational timeBase = formatHandler->getStreams()[packet->stream_index]->time_base;
+  vivictpp::libav::IndexEntry entry = {
+    av_rescale_q(pts, timeBase, vivictpp::time::TIME_BASE_Q),
+    dts,
+    packet->pos,
+    packet->size,
+    (packet->flags & AV_PKT_FLAG_KEY) != 0
+  };
+  frameIndex->add(packet->stream_index, entry, av_rescale_q(dts, timeBase, vivictpp::time::TIME_BASE_Q));
+}
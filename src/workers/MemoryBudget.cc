@@ -0,0 +1,155 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "workers/MemoryBudget.hh"
+
+#include <algorithm>
+
+extern "C" {
+#include <unistd.h>
+}
+
+static constexpr size_t MIB = 1024 * 1024;
+
+vivictpp::workers::MemoryBudget::Account::Account(MemoryBudget &budget, Kind kind, std::string name,
+                                                  size_t entryBytes, int minEntries, int maxEntries,
+                                                  std::function<size_t()> usage,
+                                                  std::function<void(Allocation)> onAllocation):
+  budget(budget),
+  kind(kind),
+  name(std::move(name)),
+  entryBytes(std::max(entryBytes, static_cast<size_t>(1))),
+  minEntries(minEntries),
+  maxEntries(maxEntries),
+  usage(std::move(usage)),
+  onAllocation(std::move(onAllocation)) {
+}
+
+vivictpp::workers::MemoryBudget::Account::~Account() {
+  budget.close(this);
+}
+
+void vivictpp::workers::MemoryBudget::Account::setEntryBytes(size_t bytes) {
+  size_t current = entryBytes.load();
+  // Small variations, e.g. between compressed frames, are not worth a rebalance
+  if (bytes == 0 || (bytes <= current + current / 8 && bytes + current / 8 >= current)) {
+    return;
+  }
+  const std::lock_guard<std::mutex> lock(budget.mutex);
+  entryBytes = bytes;
+  budget.rebalance();
+}
+
+vivictpp::workers::MemoryBudget::Allocation vivictpp::workers::MemoryBudget::Account::getAllocation() {
+  const std::lock_guard<std::mutex> lock(budget.mutex);
+  return allocation;
+}
+
+vivictpp::workers::MemoryBudget &vivictpp::workers::MemoryBudget::instance() {
+  static MemoryBudget budget(defaultLimit());
+  return budget;
+}
+
+size_t vivictpp::workers::MemoryBudget::defaultLimit() {
+  long pages = sysconf(_SC_PHYS_PAGES);
+  long pageSize = sysconf(_SC_PAGE_SIZE);
+  if (pages <= 0 || pageSize <= 0) {
+    return 2048 * MIB;
+  }
+  return std::max(static_cast<size_t>(pages) * static_cast<size_t>(pageSize) / 4, 256 * MIB);
+}
+
+vivictpp::workers::MemoryBudget::MemoryBudget(size_t limit):
+  logger(vivictpp::logging::getOrCreateLogger("MemoryBudget")),
+  limit(limit) {
+  logger->info("Memory budget for frames and packets is {} MiB", limit / MIB);
+}
+
+std::unique_ptr<vivictpp::workers::MemoryBudget::Account>
+vivictpp::workers::MemoryBudget::open(Kind kind, std::string name, size_t entryBytes,
+                                      int minEntries, int maxEntries,
+                                      std::function<size_t()> usage,
+                                      std::function<void(Allocation)> onAllocation) {
+  std::unique_ptr<Account> account(new Account(*this, kind, std::move(name), entryBytes,
+                                               minEntries, maxEntries,
+                                               std::move(usage), std::move(onAllocation)));
+  const std::lock_guard<std::mutex> lock(mutex);
+  accounts.push_back(account.get());
+  rebalance();
+  return account;
+}
+
+void vivictpp::workers::MemoryBudget::close(Account *account) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  accounts.erase(std::remove(accounts.begin(), accounts.end(), account), accounts.end());
+  rebalance();
+}
+
+void vivictpp::workers::MemoryBudget::setLimit(size_t limit) {
+  const std::lock_guard<std::mutex> lock(mutex);
+  logger->info("Memory budget for frames and packets set to {} MiB", limit / MIB);
+  this->limit = limit;
+  rebalance();
+}
+
+size_t vivictpp::workers::MemoryBudget::getLimit() {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return limit;
+}
+
+size_t vivictpp::workers::MemoryBudget::usedBytes() {
+  const std::lock_guard<std::mutex> lock(mutex);
+  size_t used = 0;
+  for (Account *account : accounts) {
+    used += account->usedBytes();
+  }
+  return used;
+}
+
+void vivictpp::workers::MemoryBudget::rebalance() {
+  std::vector<Account*> frameAccounts;
+  std::vector<Account*> packetAccounts;
+  for (Account *account : accounts) {
+    (account->kind == Kind::PACKETS ? packetAccounts : frameAccounts).push_back(account);
+  }
+  std::vector<std::pair<Account*, Allocation>> allocations;
+
+  size_t packetBytes = packetAccounts.empty() ? 0 : static_cast<size_t>(limit * PACKET_SHARE);
+  for (Account *account : packetAccounts) {
+    allocations.push_back({account, {packetBytes / packetAccounts.size(), account->maxEntries}});
+  }
+
+  // Hand out the smallest needs first, so that what they leave over is
+  // split between the remaining buffers
+  std::sort(frameAccounts.begin(), frameAccounts.end(),
+            [](const Account *a, const Account *b) { return a->maxBytes() < b->maxBytes(); });
+  size_t left = limit - packetBytes;
+  size_t remaining = frameAccounts.size();
+  size_t total = packetBytes;
+  for (Account *account : frameAccounts) {
+    size_t share = left / remaining--;
+    size_t entryBytes = account->entryBytes.load();
+    int entries = static_cast<int>(std::min(share / entryBytes, static_cast<size_t>(account->maxEntries)));
+    entries = std::max(entries, account->minEntries);
+    size_t bytes = entries * entryBytes;
+    left -= std::min(left, bytes);
+    total += bytes;
+    allocations.push_back({account, {bytes, entries}});
+  }
+  if (total > limit) {
+    logger->warn("Memory budget of {} MiB is too small, buffers need at least {} MiB",
+                 limit / MIB, total / MIB);
+  }
+
+  for (auto &[account, allocation] : allocations) {
+    if (allocation.bytes == account->allocation.bytes &&
+        allocation.entries == account->allocation.entries) {
+      continue;
+    }
+    logger->debug("{}: {} entries, {} MiB", account->name, allocation.entries,
+                  allocation.bytes / MIB);
+    account->allocation = allocation;
+    account->onAllocation(allocation);
+  }
+}
@@ -8,6 +8,7 @@
 #include "spdlog/spdlog.h"
 #include "time/Time.hh"
 #include "workers/DecoderWorker.hh"
+#include <algorithm>
 #include <stdexcept>
 
 std::shared_ptr<vivictpp::workers::DecoderWorker> findDecoderWorkerForStream(std::vector<std::shared_ptr<vivictpp::workers::DecoderWorker>> decoderWorkers,
@@ -23,13 +24,18 @@ std::shared_ptr<vivictpp::workers::DecoderWorker> findDecoderWorkerForStream(std
 vivictpp::workers::PacketWorker::PacketWorker(std::string source, std::string format):
     InputWorker<int>(0, "PacketWorker"),
     formatHandler(source, format),
-    currentPacket(nullptr) {
+    currentPacket(nullptr),
+    deliveredCount(0),
+    frameIndex(new vivictpp::libav::FrameIndex(formatHandler.getStreams().size())),
+    indexWorker(new IndexWorker(source, format, frameIndex)) {
     this->initVideoMetadata();
+    formatHandler.setFrameIndex(frameIndex);
+    indexWorker->start();
 }
 
 vivictpp::workers::PacketWorker::~PacketWorker() {
-  unrefCurrentPacket();
   quit();
+  unrefCurrentPacket();
 }
 
 void  vivictpp::workers::PacketWorker::initVideoMetadata() {
@@ -47,37 +53,80 @@ void  vivictpp::workers::PacketWorker::initVideoMetadata() {
     }
 }
 
-void vivictpp::workers::PacketWorker::doWork() {
+bool vivictpp::workers::PacketWorker::doWork() {
   if (!hasDecoders()) {
-     usleep(5 * 1000);
-     return;
+    return false;
+  }
+  if (seekToken.obsolete()) {
+    // The command of the later seek is queued, no packets are read for the
+    // target of this one
+    return false;
   }
   logger->trace("vivictpp::workers::PacketWorker::doWork  enter");
+  int urgency = 1;
+  for (auto &dw : decoderWorkers) {
+    urgency = std::max(urgency, dw->urgency());
+  }
+  decoderUrgency = urgency;
   if (currentPacket == nullptr) {
     currentPacket = formatHandler.nextPacket();
   }
   if (currentPacket == nullptr) {
+    // Woken up again by the next command, e.g. a seek
     logger->trace("Packet is null, eof reached");
-    usleep(5 * 1000);
+    return deliverEndOfStream();
   } else {
-    for (auto dw : decoderWorkers) {
-      // if any decoder wanted the packet but cannot accept it at this time,
-      // we keep the packet and try again later
-        vivictpp::workers::Data<vivictpp::libav::Packet> data(
-          new vivictpp::libav::Packet(currentPacket));
-      if (!dw->offerData(data, std::chrono::milliseconds(2))) {
-        return;
+    const auto &decoders = decodersForStream(currentPacket->stream_index);
+    if (!decoders.empty() && sharedPacket.empty()) {
+      sharedPacket = vivictpp::libav::Packet(currentPacket);
+    }
+    for (; deliveredCount < decoders.size(); deliveredCount++) {
+      // if a decoder cannot accept the packet at this time, we keep the
+      // packet and try again when the decoder signals that it has room,
+      // starting with that decoder
+      vivictpp::workers::Data<vivictpp::libav::Packet> data(sharedPacket);
+      if (!decoders[deliveredCount]->offerData(data)) {
+        return false;
       }
     }
     unrefCurrentPacket();
   }
   logger->trace("vivictpp::workers::PacketWorker::doWork  exit");
+  return true;
+}
+
+// The empty packet makes the decoders drain the frames they still hold
+bool vivictpp::workers::PacketWorker::deliverEndOfStream() {
+  if (endOfStreamDelivered) {
+    return false;
+  }
+  for (; deliveredCount < decoderWorkers.size(); deliveredCount++) {
+    vivictpp::workers::Data<vivictpp::libav::Packet> data((vivictpp::libav::Packet()));
+    if (!decoderWorkers[deliveredCount]->offerData(data)) {
+      return false;
+    }
+  }
+  deliveredCount = 0;
+  endOfStreamDelivered = true;
+  return true;
+}
+
+const std::vector<std::shared_ptr<vivictpp::workers::DecoderWorker>> &
+vivictpp::workers::PacketWorker::decodersForStream(int streamIndex) {
+  static const std::vector<std::shared_ptr<DecoderWorker>> noDecoders;
+  if (streamIndex < 0 || (size_t) streamIndex >= decodersByStream.size()) {
+    return noDecoders;
+  }
+  return decodersByStream[streamIndex];
 }
 
 void vivictpp::workers::PacketWorker::setActiveStreams() {
   std::set<int> activeStreams;
+  decodersByStream.clear();
+  decodersByStream.resize(formatHandler.getStreams().size());
   for (auto dw : decoderWorkers) {
     activeStreams.insert(dw->streamIndex);
+    decodersByStream[dw->streamIndex].push_back(dw);
   }
   //  logger->debug("vivictpp::workers::PacketWorker::setActiveStreams activeStreams={}", activeStreams);
   formatHandler.setActiveStreams(activeStreams);
@@ -88,12 +137,15 @@ void vivictpp::workers::PacketWorker::unrefCurrentPacket() {
     av_packet_unref(currentPacket);
     currentPacket = nullptr;
   }
+  sharedPacket = vivictpp::libav::Packet();
+  deliveredCount = 0;
 }
 
 void vivictpp::workers::PacketWorker::addDecoderWorker(const std::shared_ptr<DecoderWorker> &decoderWorker) {
   PacketWorker *pw(this);
-  sendCommand(new vivictpp::workers::Command([=](uint64_t serialNo) {
+  sendCommand(vivictpp::workers::Command([=](uint64_t serialNo) {
         (void) serialNo;
+        decoderWorker->setProducerSignal(&pw->wakeupSignal);
         pw->decoderWorkers.push_back(decoderWorker);
         pw->setActiveStreams();
         pw->initVideoMetadata();
@@ -103,8 +155,9 @@ void vivictpp::workers::PacketWorker::addDecoderWorker(const std::shared_ptr<Dec
 
 void vivictpp::workers::PacketWorker::removeDecoderWorker(const std::shared_ptr<DecoderWorker> &decoderWorker) {
   PacketWorker *pw(this);
-  sendCommand(new vivictpp::workers::Command([=](uint64_t serialNo) {
+  sendCommand(vivictpp::workers::Command([=](uint64_t serialNo) {
                                                (void) serialNo;
+        decoderWorker->setProducerSignal(nullptr);
         pw->decoderWorkers.erase(std::remove(pw->decoderWorkers.begin(),
                                              pw->decoderWorkers.end(), decoderWorker),
                                  pw->decoderWorkers.end());
@@ -114,21 +167,47 @@ void vivictpp::workers::PacketWorker::removeDecoderWorker(const std::shared_ptr<
       }, "removeDecoder"));
 }
 
-void vivictpp::workers::PacketWorker::seek(vivictpp::time::Time pos, vivictpp::SeekCallback callback) {
+void vivictpp::workers::PacketWorker::seek(vivictpp::time::Time pos, vivictpp::SeekCallback callback,
+                                           vivictpp::SeekToken token) {
   PacketWorker *packetWorker(this);
   seeklog->debug("PacketWorker::seek pos={}", pos);
-  sendCommand(new vivictpp::workers::Command([=](uint64_t serialNo) {
+  {
+    std::lock_guard<std::mutex> lock(pendingSeekMutex);
+    bool commandQueued = pendingSeek.has_value();
+    pendingSeek = PendingSeek{pos, callback, token};
+    if (commandQueued) {
+      seeklog->debug("PacketWorker::seek replaced pending seek");
+      return;
+    }
+  }
+  sendCommand(vivictpp::workers::Command([=](uint64_t serialNo) {
       (void) serialNo;
+      PendingSeek seek;
+      {
+        std::lock_guard<std::mutex> lock(packetWorker->pendingSeekMutex);
+        seek = std::move(*packetWorker->pendingSeek);
+        packetWorker->pendingSeek.reset();
+      }
+      packetWorker->seekToken = seek.token;
       try {
-        packetWorker->formatHandler.seek(pos);
+        packetWorker->formatHandler.seek(seek.pos);
         packetWorker->unrefCurrentPacket();
+        packetWorker->endOfStreamDelivered = false;
         for (auto decoderWorker : packetWorker->decoderWorkers) {
-          decoderWorker->seek(pos, callback);
+          decoderWorker->seek(seek.pos, seek.callback, seek.token);
         }
       } catch (std::runtime_error &e) {
-          callback(vivictpp::time::NO_TIME, true);
+          seek.callback(vivictpp::time::NO_TIME, true);
       }
       return true;
       }, "seek"));
 }
 
+void vivictpp::workers::PacketWorker::setKeyframesOnly(bool keyframesOnly) {
+  PacketWorker *packetWorker(this);
+  sendCommand(vivictpp::workers::Command([=](uint64_t serialNo) {
+      (void) serialNo;
+      packetWorker->formatHandler.setKeyframesOnly(keyframesOnly);
+      return true;
+      }, "setKeyframesOnly", vivictpp::workers::Command::Kind::SUPERSEDING));
+}
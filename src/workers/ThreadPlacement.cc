@@ -0,0 +1,101 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "workers/ThreadPlacement.hh"
+
+#include "logging/Logging.hh"
+
+#include <atomic>
+
+#include <pthread.h>
+#ifdef __linux__
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#ifdef __APPLE__
+#include <pthread/qos.h>
+#endif
+
+static std::atomic<bool> enabled{false};
+#ifdef __linux__
+static int presentationCore{-1};
+#endif
+
+void vivictpp::workers::setCurrentThreadName(const std::string &name) {
+#if defined(__linux__)
+  pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#elif defined(__APPLE__)
+  pthread_setname_np(name.c_str());
+#else
+  (void) name;
+#endif
+}
+
+void vivictpp::workers::setCurrentThreadLowPriority() {
+#if defined(__linux__)
+  // The nice value is per thread on Linux
+  if (setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19) != 0) {
+    vivictpp::logging::getOrCreateLogger("ThreadPlacement")->warn("Could not lower thread priority");
+  }
+#elif defined(__APPLE__)
+  pthread_set_qos_class_self_np(QOS_CLASS_BACKGROUND, 0);
+#endif
+}
+
+void vivictpp::workers::ThreadPlacement::enable() {
+  auto logger = vivictpp::logging::getOrCreateLogger("ThreadPlacement");
+#ifdef __linux__
+  cpu_set_t available;
+  CPU_ZERO(&available);
+  if (sched_getaffinity(0, sizeof(available), &available) != 0 || CPU_COUNT(&available) < 2) {
+    logger->warn("Thread placement disabled, less than two cores available");
+    return;
+  }
+  // The last core, which is the least likely to be used for interrupts
+  for (int cpu = CPU_SETSIZE - 1; cpu >= 0; cpu--) {
+    if (CPU_ISSET(cpu, &available)) {
+      presentationCore = cpu;
+      break;
+    }
+  }
+  cpu_set_t workerCores = available;
+  CPU_CLR(presentationCore, &workerCores);
+  int result = pthread_setaffinity_np(pthread_self(), sizeof(workerCores), &workerCores);
+  if (result != 0) {
+    logger->warn("Thread placement disabled, could not set cpu affinity: error {}", result);
+    return;
+  }
+  logger->info("Presentation thread on core {}, other threads on the remaining {} cores",
+               presentationCore, CPU_COUNT(&workerCores));
+  enabled = true;
+#else
+  logger->warn("Thread placement is not supported on this platform");
+#endif
+}
+
+bool vivictpp::workers::ThreadPlacement::isEnabled() {
+  return enabled.load();
+}
+
+bool vivictpp::workers::ThreadPlacement::pinPresentationThread() {
+  if (!enabled.load()) {
+    return false;
+  }
+#ifdef __linux__
+  cpu_set_t cores;
+  CPU_ZERO(&cores);
+  CPU_SET(presentationCore, &cores);
+  int result = pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores);
+  if (result != 0) {
+    vivictpp::logging::getOrCreateLogger("ThreadPlacement")
+      ->warn("Could not pin presentation thread to core {}: error {}", presentationCore, result);
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
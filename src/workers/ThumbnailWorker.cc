@@ -0,0 +1,145 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "workers/ThumbnailWorker.hh"
+
+#include "libav/InputCache.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+vivictpp::workers::ThumbnailWorker::ThumbnailWorker(std::string source, std::string format,
+                                                    int streamIndex,
+                                                    std::shared_ptr<vivictpp::libav::FrameIndex> frameIndex,
+                                                    std::shared_ptr<vivictpp::libav::ThumbnailCache> thumbnails):
+  InputWorker<int>(0, "ThumbnailWorker", Executor::background()),
+  source(std::move(source)),
+  format(std::move(format)),
+  streamIndex(streamIndex),
+  frameIndex(std::move(frameIndex)),
+  thumbnails(std::move(thumbnails)) {
+}
+
+vivictpp::workers::ThumbnailWorker::~ThumbnailWorker() {
+  quit();
+}
+
+void vivictpp::workers::ThumbnailWorker::open() {
+  formatHandler.reset(new vivictpp::libav::FormatHandler(source, format));
+  formatHandler->setActiveStreams({streamIndex});
+  formatHandler->setFrameIndex(frameIndex);
+  formatHandler->setKeyframesOnly(true);
+  vivictpp::libav::DecoderOptions decoderOptions;
+  decoderOptions.threads = 1;
+  decoder.reset(new vivictpp::libav::Decoder(formatHandler->getStreams()[streamIndex]->codecpar,
+                                             decoderOptions));
+  for (size_t stride = FIRST_STRIDE; stride > 0; stride /= 2) {
+    for (size_t slot = 0; slot < thumbnails->slotCount(); slot += stride) {
+      if (stride == FIRST_STRIDE || slot % (2 * stride) != 0) {
+        slotOrder.push_back(slot);
+      }
+    }
+  }
+}
+
+void vivictpp::workers::ThumbnailWorker::finish() {
+  vivictpp::libav::InputCache(source).saveThumbnails(streamIndex, *thumbnails);
+  logger->info("Made {} thumbnails of {}, {} kB", thumbnails->slotCount(), source,
+               thumbnails->byteSize() / 1024);
+  done = true;
+  decoder.reset();
+  formatHandler.reset();
+}
+
+bool vivictpp::workers::ThumbnailWorker::doWork() {
+  if (done) {
+    return false;
+  }
+  try {
+    if (!formatHandler) {
+      if (vivictpp::libav::InputCache(source).restoreThumbnails(streamIndex, *thumbnails)) {
+        done = true;
+        return false;
+      }
+      open();
+    }
+    if (nextSlot == slotOrder.size()) {
+      finish();
+      return false;
+    }
+    size_t slot = slotOrder[nextSlot++];
+    vivictpp::libav::Frame frame = decodeKeyframe(thumbnails->slotTime(slot));
+    if (!frame.empty()) {
+      thumbnails->set(slot, makeThumbnail(frame));
+    }
+  } catch (const std::runtime_error &e) {
+    // The seek bar works without thumbnails
+    logger->warn("Making thumbnails of {} stopped: {}", source, e.what());
+    done = true;
+    decoder.reset();
+    formatHandler.reset();
+    return false;
+  }
+  return true;
+}
+
+// Seeks to the keyframe at or before t, exactly if the frame index covers t
+vivictpp::libav::Frame vivictpp::workers::ThumbnailWorker::decodeKeyframe(vivictpp::time::Time t) {
+  formatHandler->seek(t);
+  decoder->flush();
+  for (int i = 0; i < MAX_PACKETS_PER_THUMBNAIL; i++) {
+    AVPacket *packet = formatHandler->nextPacket();
+    if (!packet) {
+      break;
+    }
+    bool keyframe = packet->stream_index == streamIndex && (packet->flags & AV_PKT_FLAG_KEY);
+    vivictpp::libav::Packet keyframePacket = keyframe ? vivictpp::libav::Packet(packet)
+      : vivictpp::libav::Packet();
+    av_packet_unref(packet);
+    if (!keyframe) {
+      continue;
+    }
+    std::vector<vivictpp::libav::Frame> frames = decoder->handlePacket(keyframePacket);
+    if (frames.empty()) {
+      // Decoders with reordering delay only output the frame when drained
+      frames = decoder->handlePacket(vivictpp::libav::Packet());
+    }
+    if (!frames.empty()) {
+      return frames.front();
+    }
+  }
+  return vivictpp::libav::Frame::emptyFrame();
+}
+
+std::shared_ptr<const vivictpp::libav::Thumbnail>
+vivictpp::workers::ThumbnailWorker::makeThumbnail(const vivictpp::libav::Frame &frame) {
+  const AVFrame *avFrame = frame.avFrame();
+  double aspectRatio = avFrame->width / static_cast<double>(avFrame->height);
+  if (avFrame->sample_aspect_ratio.num > 0 && avFrame->sample_aspect_ratio.den > 0) {
+    aspectRatio *= av_q2d(avFrame->sample_aspect_ratio);
+  }
+  int width = THUMBNAIL_WIDTH;
+  int height = std::max(2, static_cast<int>(width / aspectRatio) & ~1);
+  vivictpp::libav::Frame scaled = scaler.scale(frame, width, height, AV_PIX_FMT_YUV420P);
+
+  auto thumbnail = std::make_shared<vivictpp::libav::Thumbnail>();
+  thumbnail->pts = frame.pts() == AV_NOPTS_VALUE ? vivictpp::time::NO_TIME
+    : av_rescale_q(frame.pts(), formatHandler->getStreams()[streamIndex]->time_base,
+                   vivictpp::time::TIME_BASE_Q);
+  thumbnail->width = width;
+  thumbnail->height = height;
+  thumbnail->data.resize(width * height * 3 / 2);
+  uint8_t *dst = thumbnail->data.data();
+  const AVFrame *src = scaled.avFrame();
+  for (int plane = 0; plane < 3; plane++) {
+    int planeWidth = plane == 0 ? width : width / 2;
+    int planeHeight = plane == 0 ? height : height / 2;
+    for (int y = 0; y < planeHeight; y++) {
+      std::memcpy(dst, src->data[plane] + y * src->linesize[plane], planeWidth);
+      dst += planeWidth;
+    }
+  }
+  return thumbnail;
+}
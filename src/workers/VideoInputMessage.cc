@@ -3,7 +3,11 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 
 #include "workers/VideoInputMessage.hh"
-#include "workers/VideoInputMessage.hh"
 
-std::atomic<uint64_t> vivictpp::workers::Message::serialCounter(0);
+#include <atomic>
+
+static std::atomic<uint64_t> serialCounter(0);
 
+uint64_t vivictpp::workers::nextSerialNo() {
+  return serialCounter++;
+}
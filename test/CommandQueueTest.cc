@@ -0,0 +1,78 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch2/catch.hpp"
+
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "workers/VideoInputMessage.hh"
+
+using vivictpp::workers::Command;
+using vivictpp::workers::Queue;
+
+static Command recording(std::vector<std::string> *applied, const char *name,
+                         Command::Kind kind = Command::Kind::ORDERED) {
+  return Command([=](uint64_t serialNo) {
+      (void) serialNo;
+      applied->push_back(name);
+      return true;
+    }, name, kind);
+}
+
+// Applies and pops all queued commands
+static void drain(Queue<int> &queue) {
+  while (true) {
+    vivictpp::workers::Message<int> message = queue.peek();
+    if (!std::holds_alternative<Command*>(message)) {
+      return;
+    }
+    std::get<Command*>(message)->apply();
+    queue.popCommand();
+  }
+}
+
+TEST_CASE("Commands pushed to a full queue are kept in order") {
+  Queue<int> queue(4, 2);
+  std::vector<std::string> applied;
+  queue.pushCommand(recording(&applied, "a"));
+  queue.pushCommand(recording(&applied, "b"));
+  queue.pushCommand(recording(&applied, "c"));
+  queue.pushCommand(recording(&applied, "d"));
+  REQUIRE(queue.queuedCommands() == 4);
+
+  drain(queue);
+  REQUIRE(applied == std::vector<std::string>{"a", "b", "c", "d"});
+  REQUIRE(queue.empty());
+}
+
+TEST_CASE("A full queue drops commands superseded by the new one") {
+  Queue<int> queue(4, 3);
+  std::vector<std::string> applied;
+  queue.pushCommand(recording(&applied, "first"));
+  queue.pushCommand(recording(&applied, "prefetch", Command::Kind::SUPERSEDING));
+  queue.pushCommand(recording(&applied, "stop"));
+  queue.pushCommand(recording(&applied, "prefetch", Command::Kind::SUPERSEDING));
+  REQUIRE(queue.queuedCommands() == 3);
+
+  drain(queue);
+  REQUIRE(applied == std::vector<std::string>{"first", "stop", "prefetch"});
+}
+
+TEST_CASE("The command being applied is never dropped") {
+  Queue<int> queue(4, 1);
+  std::vector<std::string> applied;
+  queue.pushCommand(recording(&applied, "prefetch", Command::Kind::SUPERSEDING));
+  Command *front = std::get<Command*>(queue.peek());
+  queue.pushCommand(recording(&applied, "prefetch", Command::Kind::SUPERSEDING));
+  queue.pushCommand(recording(&applied, "prefetch", Command::Kind::SUPERSEDING));
+  // The overflow keeps only the latest of the superseding commands
+  REQUIRE(queue.queuedCommands() == 2);
+  REQUIRE(std::get<Command*>(queue.peek()) == front);
+
+  drain(queue);
+  REQUIRE(applied == std::vector<std::string>{"prefetch", "prefetch"});
+}
@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch2/catch.hpp"
+
+#include "libav/Decoder.hh"
+
+using vivictpp::libav::DecoderOptions;
+using vivictpp::libav::parseDecoderOptions;
+
+TEST_CASE("parseDecoderOptions parses all keys") {
+  DecoderOptions options;
+  parseDecoderOptions("threads=4:thread_type=slice:lowres=1:skip_loop_filter=noref:gop_decoders=2", options);
+  REQUIRE(options.threads == 4);
+  REQUIRE(options.threadType == "slice");
+  REQUIRE(options.lowres == 1);
+  REQUIRE(options.skipLoopFilter == "noref");
+  REQUIRE(options.gopDecoders == 2);
+}
+
+TEST_CASE("parseDecoderOptions names the key of an invalid value") {
+  DecoderOptions options;
+  REQUIRE_THROWS_WITH(parseDecoderOptions("threads=abc", options), Catch::Contains("threads"));
+  REQUIRE_THROWS_WITH(parseDecoderOptions("threads=", options), Catch::Contains("threads"));
+  REQUIRE_THROWS_WITH(parseDecoderOptions("lowres", options), Catch::Contains("lowres"));
+  REQUIRE_THROWS_WITH(parseDecoderOptions("gop_decoders=2x", options), Catch::Contains("gop_decoders"));
+}
+
+TEST_CASE("parseDecoderOptions rejects negative counts") {
+  DecoderOptions options;
+  REQUIRE_THROWS_WITH(parseDecoderOptions("threads=-2", options), Catch::Contains("threads"));
+  REQUIRE(options.threads == 0);
+}
+
+TEST_CASE("parseDecoderOptions rejects unknown keys") {
+  DecoderOptions options;
+  REQUIRE_THROWS_WITH(parseDecoderOptions("thread=4", options), Catch::Contains("thread"));
+}
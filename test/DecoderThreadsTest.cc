@@ -0,0 +1,38 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch2/catch.hpp"
+
+#include "libav/DecoderThreads.hh"
+
+#include <numeric>
+
+using vivictpp::libav::divideDecoderThreads;
+
+TEST_CASE("divideDecoderThreads splits cores evenly for equal costs") {
+  std::vector<int> threads = divideDecoderThreads({1.0, 1.0}, {0, 0}, 8);
+  REQUIRE(threads == std::vector<int>{4, 4});
+}
+
+TEST_CASE("divideDecoderThreads gives more threads to costlier streams") {
+  std::vector<int> threads = divideDecoderThreads({8.0, 1.0}, {0, 0}, 9);
+  REQUIRE(threads == std::vector<int>{7, 2});
+  REQUIRE(std::accumulate(threads.begin(), threads.end(), 0) == 9);
+}
+
+TEST_CASE("divideDecoderThreads gives audio one thread") {
+  std::vector<int> threads = divideDecoderThreads({1.0, 1.0, 0.0}, {0, 0, 0}, 9);
+  REQUIRE(threads == std::vector<int>{4, 4, 1});
+}
+
+TEST_CASE("divideDecoderThreads keeps requested thread counts") {
+  std::vector<int> threads = divideDecoderThreads({1.0, 1.0}, {2, 0}, 8);
+  REQUIRE(threads == std::vector<int>{2, 6});
+}
+
+TEST_CASE("divideDecoderThreads gives every decoder a thread when cores are few") {
+  std::vector<int> threads = divideDecoderThreads({4.0, 1.0, 0.0}, {0, 0, 0}, 2);
+  REQUIRE(threads == std::vector<int>{1, 1, 1});
+}
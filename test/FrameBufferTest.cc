@@ -0,0 +1,173 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch2/catch.hpp"
+
+#include <chrono>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "workers/FrameBuffer.hh"
+
+using vivictpp::workers::FrameBuffer;
+using vivictpp::libav::Frame;
+
+static Frame frameWithPts(int64_t pts) {
+  Frame frame;
+  frame.avFrame()->best_effort_timestamp = pts;
+  return frame;
+}
+
+static Frame frameWithData(int64_t pts, size_t size) {
+  Frame frame = frameWithPts(pts);
+  frame.avFrame()->buf[0] = av_buffer_alloc(size);
+  return frame;
+}
+
+TEST_CASE("FrameBuffer stepping") {
+  FrameBuffer buffer(8);
+  for (int i = 0; i < 4; i++) {
+    buffer.write(frameWithPts(i * 10), i * 10);
+  }
+  REQUIRE(buffer.size() == 4);
+  REQUIRE(buffer.currentPts() == 0);
+  REQUIRE(buffer.nextPts() == 10);
+  REQUIRE(buffer.previousPts() == vivictpp::time::NO_TIME);
+  REQUIRE(buffer.ptsInRange(25));
+  REQUIRE_FALSE(buffer.ptsInRange(31));
+
+  REQUIRE(buffer.stepForward(25) == 2);
+  REQUIRE(buffer.currentPts() == 20);
+  REQUIRE(buffer.first().pts() == 20);
+  REQUIRE(buffer.previousPts() == 10);
+
+  buffer.stepBackward(10);
+  REQUIRE(buffer.currentPts() == 10);
+
+  buffer.drop(2);
+  REQUIRE(buffer.size() == 2);
+  REQUIRE(buffer.minPts() == 20);
+  REQUIRE(buffer.currentPts() == 20);
+
+  buffer.clear();
+  REQUIRE(buffer.isEmpty());
+}
+
+TEST_CASE("FrameBuffer frames around cursor") {
+  FrameBuffer buffer(8);
+  for (int i = 0; i < 4; i++) {
+    buffer.write(frameWithPts(i * 10), i * 10);
+  }
+  buffer.stepForward(10);
+  REQUIRE(buffer.frameAt(0).pts() == 10);
+  REQUIRE(buffer.frameAt(-1).pts() == 0);
+  REQUIRE(buffer.frameAt(2).pts() == 30);
+  REQUIRE(buffer.frameAt(-2).empty());
+  REQUIRE(buffer.frameAt(3).empty());
+
+  buffer.drop(1);
+  REQUIRE(buffer.frameAt(-1).empty());
+  REQUIRE(buffer.frameAt(0).pts() == 10);
+}
+
+TEST_CASE("FrameBuffer makes room when cursor is close to head") {
+  FrameBuffer buffer(6);
+  for (int i = 0; i < 6; i++) {
+    buffer.write(frameWithPts(i), i);
+  }
+  REQUIRE(buffer.isFull());
+  REQUIRE_FALSE(buffer.waitForNotFull(std::chrono::milliseconds(1)));
+  buffer.stepForward(3);
+  REQUIRE(buffer.waitForNotFull(std::chrono::milliseconds(1)));
+  REQUIRE(buffer.currentPts() == 3);
+  REQUIRE(buffer.minPts() <= 3);
+}
+
+TEST_CASE("FrameBuffer keeps raised number of frames ahead") {
+  FrameBuffer buffer(32);
+  buffer.setMinFramesAhead(12);
+  REQUIRE(buffer.minFramesAhead() == 12);
+  for (int i = 0; i < 32; i++) {
+    buffer.write(frameWithPts(i), i);
+  }
+  buffer.stepForward(24);
+  REQUIRE(buffer.framesBehind() == 24);
+  REQUIRE(buffer.makeRoom());
+  REQUIRE(buffer.framesBehind() == 20);
+  REQUIRE(buffer.framesAhead() == 8);
+
+  buffer.setMaxSize(16);
+  REQUIRE(buffer.minFramesAhead() == 8);
+  buffer.setMinFramesAhead(0);
+  REQUIRE(buffer.minFramesAhead() == 5);
+}
+
+TEST_CASE("FrameBuffer hands dropped frames to the drop listener") {
+  FrameBuffer buffer(8);
+  std::vector<std::pair<vivictpp::time::Time, vivictpp::time::Time>> dropped;
+  buffer.setDropListener([&dropped](const Frame &frame, vivictpp::time::Time pts,
+                                    vivictpp::time::Time nextPts) {
+    REQUIRE(frame.pts() == pts);
+    dropped.push_back({pts, nextPts});
+  });
+  for (int i = 0; i < 8; i++) {
+    buffer.write(frameWithPts(i * 10), i * 10);
+  }
+  buffer.stepForward(30);
+  buffer.drop(2);
+  // Released by the writer
+  REQUIRE(dropped.empty());
+  buffer.write(frameWithPts(80), 80);
+  REQUIRE(dropped.size() == 2);
+  REQUIRE(dropped[0] == std::make_pair<vivictpp::time::Time, vivictpp::time::Time>(0, 10));
+  REQUIRE(dropped[1] == std::make_pair<vivictpp::time::Time, vivictpp::time::Time>(10, 20));
+
+  buffer.clear();
+  buffer.write(frameWithPts(200), 200);
+  REQUIRE(dropped.size() == 2);
+}
+
+TEST_CASE("FrameBuffer drops frames behind cursor when max size is lowered") {
+  FrameBuffer buffer(16);
+  for (int i = 0; i < 12; i++) {
+    buffer.write(frameWithData(i, 1000), i);
+  }
+  REQUIRE(buffer.bytes() == 12000);
+  buffer.stepForward(6);
+  buffer.setMaxSize(8);
+  REQUIRE(buffer.isFull());
+  REQUIRE(buffer.makeRoom());
+  REQUIRE(buffer.size() == 7);
+  REQUIRE(buffer.currentPts() == 6);
+  REQUIRE(buffer.bytes() == 7000);
+
+  buffer.setMaxSize(64);
+  REQUIRE(buffer.maxSize() == 16);
+
+  buffer.clear();
+  REQUIRE(buffer.bytes() == 0);
+}
+
+TEST_CASE("FrameBuffer single producer single consumer") {
+  const int frameCount = 10000;
+  FrameBuffer buffer(16);
+  std::thread writer([&buffer, frameCount] {
+    for (int i = 0; i < frameCount; i++) {
+      while (!buffer.waitForNotFull(std::chrono::milliseconds(10))) {
+      }
+      buffer.write(frameWithPts(i), i);
+    }
+  });
+  vivictpp::time::Time lastPts = -1;
+  while (lastPts < frameCount - 1) {
+    Frame frame = buffer.first();
+    REQUIRE(frame.pts() >= lastPts);
+    lastPts = frame.pts();
+    buffer.stepForward(lastPts + 1);
+  }
+  writer.join();
+  REQUIRE(lastPts == frameCount - 1);
+}
@@ -0,0 +1,148 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch2/catch.hpp"
+
+#include <map>
+
+#include "workers/FrameHistory.hh"
+
+using vivictpp::workers::FrameHistory;
+using vivictpp::libav::Frame;
+
+// A small YUV420P frame with smooth content, which compresses well
+static Frame frameAt(vivictpp::time::Time pts) {
+  Frame frame;
+  AVFrame *avFrame = frame.avFrame();
+  avFrame->format = AV_PIX_FMT_YUV420P;
+  avFrame->width = 64;
+  avFrame->height = 32;
+  REQUIRE(av_frame_get_buffer(avFrame, 0) >= 0);
+  for (int plane = 0; plane < 3; plane++) {
+    int width = plane == 0 ? avFrame->width : avFrame->width / 2;
+    int height = plane == 0 ? avFrame->height : avFrame->height / 2;
+    for (int y = 0; y < height; y++) {
+      for (int x = 0; x < width; x++) {
+        avFrame->data[plane][y * avFrame->linesize[plane] + x] = static_cast<uint8_t>(x + y + pts);
+      }
+    }
+  }
+  avFrame->best_effort_timestamp = pts;
+  return frame;
+}
+
+static std::map<vivictpp::time::Time, Frame> framesBetween(int first, int end) {
+  std::map<vivictpp::time::Time, Frame> frames;
+  for (int i = first; i < end; i++) {
+    frames[i * 10] = frameAt(i * 10);
+  }
+  return frames;
+}
+
+TEST_CASE("FrameHistory keeps the frames before the end") {
+  FrameHistory history(1 << 20);
+  REQUIRE(vivictpp::time::isNoPts(history.endPts()));
+  REQUIRE_FALSE(history.joins(100));
+
+  history.add(framesBetween(4, 12), 100);
+  REQUIRE(history.size() == 6);
+  REQUIRE_FALSE(history.full());
+  REQUIRE(history.firstPts() == 40);
+  REQUIRE(history.lastPts() == 90);
+  REQUIRE(history.joins(100));
+  REQUIRE_FALSE(history.joins(110));
+
+  // Stale frames are not added, frames ending at the start are prepended
+  history.add(framesBetween(0, 3), 30);
+  REQUIRE(history.firstPts() == 40);
+  history.add(framesBetween(0, 4), 40);
+  REQUIRE(history.firstPts() == 0);
+  REQUIRE(history.size() == 10);
+  REQUIRE(history.framesBefore(30) == 3);
+
+  history.clear();
+  REQUIRE(history.size() == 0);
+  REQUIRE_FALSE(history.joins(100));
+}
+
+TEST_CASE("FrameHistory appends frames dropped from the frame buffer") {
+  FrameHistory history(1 << 20);
+  history.add(framesBetween(0, 5), 50);
+  history.append(frameAt(50), 50, 60);
+  history.append(frameAt(60), 60, 70);
+  REQUIRE(history.size() == 7);
+  REQUIRE(history.joins(70));
+
+  // A frame that does not follow starts the history over
+  history.append(frameAt(90), 90, 100);
+  REQUIRE(history.size() == 1);
+  REQUIRE(history.firstPts() == 90);
+  REQUIRE(history.joins(100));
+}
+
+TEST_CASE("FrameHistory drops the oldest frames over the byte limit") {
+  size_t frameBytes = frameAt(0).byteSize();
+  REQUIRE(frameBytes > 0);
+  FrameHistory history(frameBytes * 9 / 2);
+  history.add(framesBetween(0, 8), 80);
+  REQUIRE(history.size() == 4);
+  REQUIRE(history.firstPts() == 40);
+  REQUIRE(history.bytes() <= frameBytes * 9 / 2);
+  REQUIRE(history.full());
+
+  history.setMaxBytes(frameBytes * 2);
+  REQUIRE(history.size() == 2);
+  REQUIRE(history.firstPts() == 60);
+}
+
+TEST_CASE("FrameHistory compresses frames away from the position") {
+  FrameHistory history(1 << 20);
+  history.add(framesBetween(0, 8), 80);
+  size_t rawBytes = history.bytes();
+  int compressed = 0;
+  while (history.compressOne() > 0) {
+    compressed++;
+  }
+  // The last two frames are next to the frame buffer
+  REQUIRE(compressed == 6);
+  REQUIRE(history.bytes() < rawBytes);
+  REQUIRE(history.framesAround(70, 2).size() == 1);
+
+  history.setPosition(30);
+  while (history.compressOne() > 0 || history.warmOne()) {
+  }
+  // Only frames 10 to 50 are kept decompressed, around the position
+  std::vector<Frame> around = history.framesAround(30, 2);
+  REQUIRE(around.size() == 4);
+  REQUIRE(around[0].pts() == 40);
+  REQUIRE(around[1].pts() == 20);
+  REQUIRE(history.framesAround(30, 4).size() == 4);
+
+  // Compressed frames are decompressed when asked for
+  REQUIRE(history.frame(0).pts() == 0);
+  REQUIRE(history.frame(45).empty());
+}
+
+TEST_CASE("FrameHistory lookups") {
+  FrameHistory history(1 << 20);
+  history.add(framesBetween(2, 6), 60);
+  REQUIRE(history.ptsAtOrAfter(25) == 30);
+  REQUIRE(history.ptsAtOrAfter(30) == 30);
+  REQUIRE(vivictpp::time::isNoPts(history.ptsAtOrAfter(55)));
+  REQUIRE(history.ptsAtOrBefore(35) == 30);
+  REQUIRE(vivictpp::time::isNoPts(history.ptsAtOrBefore(15)));
+  REQUIRE(history.previousPts(30) == 20);
+  REQUIRE(vivictpp::time::isNoPts(history.previousPts(20)));
+  REQUIRE(history.nextPts(30) == 40);
+  REQUIRE(vivictpp::time::isNoPts(history.nextPts(50)));
+  REQUIRE(history.frame(40).pts() == 40);
+  REQUIRE(history.frame(45).empty());
+
+  std::vector<Frame> around = history.framesAround(30, 2);
+  REQUIRE(around.size() == 3);
+  REQUIRE(around[0].pts() == 40);
+  REQUIRE(around[1].pts() == 20);
+  REQUIRE(around[2].pts() == 50);
+}
@@ -0,0 +1,60 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch2/catch.hpp"
+
+#include "libav/FrameIndex.hh"
+
+using vivictpp::libav::FrameIndex;
+using vivictpp::libav::IndexEntry;
+
+// Adds packets in decoding order for the pts sequence I P B B P B B, with a
+// frame duration of 10
+static void addGop(FrameIndex &index, vivictpp::time::Time start) {
+  vivictpp::time::Time ptsOffsets[] = {0, 30, 10, 20, 60, 40, 50};
+  for (int i = 0; i < 7; i++) {
+    vivictpp::time::Time pts = start + ptsOffsets[i];
+    vivictpp::time::Time dts = start + (i - 1) * 10;
+    index.add(0, {pts, dts, 1000 + start + i, 100, i == 0}, dts);
+  }
+}
+
+TEST_CASE("FrameIndex finds keyframes and frames in presentation order") {
+  FrameIndex index(1);
+  addGop(index, 0);
+  addGop(index, 70);
+  REQUIRE(index.size(0) == 14);
+
+  auto keyframe = index.keyframeBefore(0, 65);
+  REQUIRE(keyframe);
+  REQUIRE(keyframe->pts == 0);
+  REQUIRE(index.framesBetween(0, keyframe->pts, 65) == 7);
+
+  keyframe = index.keyframeBefore(0, 70);
+  REQUIRE(keyframe);
+  REQUIRE(keyframe->pts == 70);
+  REQUIRE(keyframe->pos == 1070);
+
+  REQUIRE(index.nextPts(0, 0) == 10);
+  REQUIRE(index.nextPts(0, 15) == 20);
+  REQUIRE(index.previousPts(0, 40) == 30);
+}
+
+TEST_CASE("FrameIndex only answers for scanned part of stream") {
+  FrameIndex index(2);
+  addGop(index, 0);
+  // Highest dts is 50, so a frame with pts between 50 and 60 may still come
+  REQUIRE(index.nextPts(0, 40) == 50);
+  REQUIRE(vivictpp::time::isNoPts(index.nextPts(0, 50)));
+  REQUIRE_FALSE(index.keyframeBefore(0, 100));
+  REQUIRE(index.framesBetween(0, 0, 100) == -1);
+  REQUIRE_FALSE(index.keyframeBefore(1, 0));
+
+  index.setComplete();
+  REQUIRE(index.isComplete());
+  REQUIRE(index.keyframeBefore(0, 100)->pts == 0);
+  REQUIRE(index.nextPts(0, 50) == 60);
+  REQUIRE(vivictpp::time::isNoPts(index.nextPts(0, 60)));
+}
@@ -0,0 +1,41 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch2/catch.hpp"
+
+#include "libav/FramePool.hh"
+
+using vivictpp::libav::Frame;
+using vivictpp::libav::FramePool;
+
+TEST_CASE("Copying a frame shares the AVFrame") {
+  std::shared_ptr<FramePool> pool = FramePool::create();
+  Frame frame = pool->get();
+  uint64_t allocations = Frame::allocationCount();
+  Frame copy = frame;
+  REQUIRE(copy.avFrame() == frame.avFrame());
+  REQUIRE(Frame::allocationCount() == allocations);
+}
+
+TEST_CASE("Released frames are recycled") {
+  std::shared_ptr<FramePool> pool = FramePool::create(4);
+  pool->get();
+  uint64_t allocations = Frame::allocationCount();
+  for (int i = 0; i < 100; i++) {
+    Frame frame = pool->get();
+    Frame copy = frame;
+  }
+  REQUIRE(Frame::allocationCount() == allocations);
+  REQUIRE(pool->idleFrames() == 1);
+}
+
+TEST_CASE("Frames outlive their pool") {
+  Frame frame;
+  {
+    std::shared_ptr<FramePool> pool = FramePool::create();
+    frame = pool->get();
+  }
+  REQUIRE_FALSE(frame.empty());
+}
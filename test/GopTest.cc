@@ -0,0 +1,78 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch2/catch.hpp"
+
+#include "workers/Gop.hh"
+
+using vivictpp::workers::DecodedGops;
+using vivictpp::workers::Gop;
+using vivictpp::libav::Frame;
+
+static Frame smallFrame() {
+  Frame frame;
+  AVFrame *avFrame = frame.avFrame();
+  avFrame->format = AV_PIX_FMT_YUV420P;
+  avFrame->width = 16;
+  avFrame->height = 16;
+  REQUIRE(av_frame_get_buffer(avFrame, 0) >= 0);
+  return frame;
+}
+
+TEST_CASE("DecodedGops hands out GOPs in sequence order") {
+  DecodedGops decodedGops;
+  REQUIRE(decodedGops.put(Gop(2, 0)));
+  REQUIRE(decodedGops.put(Gop(1, 0)));
+  Gop gop;
+  REQUIRE_FALSE(decodedGops.take(gop));
+
+  REQUIRE(decodedGops.put(Gop(0, 0)));
+  REQUIRE(decodedGops.take(gop));
+  REQUIRE(gop.sequenceNo() == 0);
+  REQUIRE(decodedGops.take(gop));
+  REQUIRE(gop.sequenceNo() == 1);
+  REQUIRE(decodedGops.take(gop));
+  REQUIRE(gop.sequenceNo() == 2);
+  REQUIRE_FALSE(decodedGops.take(gop));
+  REQUIRE(decodedGops.nextSequenceNo() == 3);
+}
+
+TEST_CASE("DecodedGops drops GOPs from an earlier seek epoch") {
+  DecodedGops decodedGops;
+  REQUIRE(decodedGops.put(Gop(1, 0)));
+  REQUIRE(decodedGops.reset() == 1);
+  REQUIRE(decodedGops.size() == 0);
+  REQUIRE(decodedGops.nextSequenceNo() == 0);
+
+  // Decoded for the previous seek, and finishing after it
+  REQUIRE_FALSE(decodedGops.put(Gop(0, 0)));
+  Gop gop;
+  REQUIRE_FALSE(decodedGops.take(gop));
+
+  REQUIRE(decodedGops.put(Gop(0, 1)));
+  REQUIRE(decodedGops.take(gop));
+  REQUIRE(gop.seekEpoch() == 1);
+  REQUIRE(gop.sequenceNo() == 0);
+}
+
+TEST_CASE("DecodedGops counts the bytes of the frames waiting to be taken") {
+  DecodedGops decodedGops;
+  Gop first(0, 0);
+  first.addFrame(smallFrame());
+  Gop second(1, 0);
+  second.addFrame(smallFrame());
+  second.addFrame(smallFrame());
+  REQUIRE(first.frameBytes() > 0);
+  REQUIRE(second.frameBytes() == 2 * first.frameBytes());
+
+  REQUIRE(decodedGops.put(second));
+  REQUIRE(decodedGops.put(first));
+  REQUIRE(decodedGops.frameBytes() == 3 * first.frameBytes());
+  Gop gop;
+  REQUIRE(decodedGops.take(gop));
+  REQUIRE(decodedGops.frameBytes() == second.frameBytes());
+  decodedGops.reset();
+  REQUIRE(decodedGops.frameBytes() == 0);
+}
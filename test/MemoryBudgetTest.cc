@@ -0,0 +1,72 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch2/catch.hpp"
+
+#include "workers/MemoryBudget.hh"
+
+using vivictpp::workers::MemoryBudget;
+
+static constexpr size_t MIB = 1024 * 1024;
+
+struct TestAccount {
+  MemoryBudget::Allocation allocation{0, 0};
+  size_t used{0};
+  std::unique_ptr<MemoryBudget::Account> account;
+
+  TestAccount(MemoryBudget &budget, MemoryBudget::Kind kind, size_t entryBytes, int minEntries, int maxEntries) {
+    account = budget.open(kind, "test", entryBytes, minEntries, maxEntries,
+                          [this] { return used; },
+                          [this](MemoryBudget::Allocation a) { allocation = a; });
+  }
+};
+
+TEST_CASE("MemoryBudget splits frame budget by frame size") {
+  MemoryBudget budget(1000 * MIB);
+  TestAccount small(budget, MemoryBudget::Kind::VIDEO_FRAMES, 1 * MIB, 8, 1000);
+  TestAccount large(budget, MemoryBudget::Kind::VIDEO_FRAMES, 10 * MIB, 8, 1000);
+  REQUIRE(small.allocation.entries == 500);
+  REQUIRE(large.allocation.entries == 50);
+  REQUIRE(small.allocation.bytes + large.allocation.bytes <= budget.getLimit());
+}
+
+TEST_CASE("MemoryBudget gives leftover of small buffers to others") {
+  MemoryBudget budget(1000 * MIB);
+  TestAccount packets(budget, MemoryBudget::Kind::PACKETS, 0, 256, 256);
+  TestAccount audio(budget, MemoryBudget::Kind::AUDIO_FRAMES, 4096, 8, 128);
+  TestAccount video(budget, MemoryBudget::Kind::VIDEO_FRAMES, 10 * MIB, 8, 128);
+  REQUIRE(packets.allocation.bytes == 100 * MIB);
+  REQUIRE(packets.allocation.entries == 256);
+  REQUIRE(audio.allocation.entries == 128);
+  REQUIRE(video.allocation.entries == 89);
+}
+
+TEST_CASE("MemoryBudget rebalances on changes") {
+  MemoryBudget budget(100 * MIB);
+  TestAccount first(budget, MemoryBudget::Kind::VIDEO_FRAMES, 1 * MIB, 8, 1000);
+  REQUIRE(first.allocation.entries == 100);
+  {
+    TestAccount second(budget, MemoryBudget::Kind::VIDEO_FRAMES, 1 * MIB, 8, 1000);
+    REQUIRE(first.allocation.entries == 50);
+    REQUIRE(second.allocation.entries == 50);
+  }
+  REQUIRE(first.allocation.entries == 100);
+
+  first.account->setEntryBytes(4 * MIB);
+  REQUIRE(first.allocation.entries == 25);
+
+  budget.setLimit(8 * MIB);
+  REQUIRE(first.allocation.entries == 8);
+}
+
+TEST_CASE("MemoryBudget sums usage of all accounts") {
+  MemoryBudget budget(100 * MIB);
+  TestAccount first(budget, MemoryBudget::Kind::VIDEO_FRAMES, 1 * MIB, 8, 1000);
+  TestAccount second(budget, MemoryBudget::Kind::PACKETS, 0, 256, 256);
+  first.used = 3 * MIB;
+  second.used = 1 * MIB;
+  REQUIRE(first.account->usedBytes() == 3 * MIB);
+  REQUIRE(budget.usedBytes() == 4 * MIB);
+}
@@ -0,0 +1,66 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch2/catch.hpp"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "libav/PlaneCodec.hh"
+
+using vivictpp::libav::compressPlane;
+using vivictpp::libav::decompressPlane;
+
+static void requireRoundTrip(const std::vector<uint8_t> &plane, int linesize, int rowBytes,
+                             int rows, int sampleBytes) {
+  std::vector<uint8_t> compressed = compressPlane(plane.data(), linesize, rowBytes, rows, sampleBytes);
+  std::vector<uint8_t> decompressed(plane.size(), 0);
+  REQUIRE(decompressPlane(compressed, decompressed.data(), linesize, rowBytes, rows, sampleBytes));
+  for (int y = 0; y < rows; y++) {
+    for (int x = 0; x < rowBytes; x++) {
+      REQUIRE(decompressed[y * linesize + x] == plane[y * linesize + x]);
+    }
+  }
+}
+
+TEST_CASE("PlaneCodec compresses smooth planes") {
+  const int width = 64, height = 32;
+  std::vector<uint8_t> plane(width * height);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      plane[y * width + x] = static_cast<uint8_t>(x + 2 * y);
+    }
+  }
+  std::vector<uint8_t> compressed = compressPlane(plane.data(), width, width, height, 1);
+  REQUIRE(compressed.size() < plane.size() / 2);
+  requireRoundTrip(plane, width, width, height, 1);
+
+  std::vector<uint8_t> flat(width * height, 128);
+  REQUIRE(compressPlane(flat.data(), width, width, height, 1).size() <= flat.size() / 8);
+}
+
+TEST_CASE("PlaneCodec is lossless for noise, padding and wide samples") {
+  std::mt19937 random(42);
+  const int linesize = 80, rowBytes = 70, rows = 9;
+  std::vector<uint8_t> plane(linesize * rows);
+  for (auto &value : plane) {
+    value = static_cast<uint8_t>(random());
+  }
+  std::vector<uint8_t> compressed = compressPlane(plane.data(), linesize, rowBytes, rows, 1);
+  REQUIRE(compressed.size() <= static_cast<size_t>((rowBytes + 15) / 16 * 17 * rows));
+  requireRoundTrip(plane, linesize, rowBytes, rows, 1);
+  requireRoundTrip(plane, linesize, rowBytes, rows, 2);
+  requireRoundTrip(plane, linesize, 1, rows, 4);
+}
+
+TEST_CASE("PlaneCodec rejects data of the wrong size") {
+  std::vector<uint8_t> plane(32 * 4, 7);
+  std::vector<uint8_t> compressed = compressPlane(plane.data(), 32, 32, 4, 1);
+  std::vector<uint8_t> out(32 * 8);
+  REQUIRE_FALSE(decompressPlane(compressed, out.data(), 32, 32, 8, 1));
+  compressed.push_back(0);
+  REQUIRE_FALSE(decompressPlane(compressed, out.data(), 32, 32, 4, 1));
+}
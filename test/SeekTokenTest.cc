@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch2/catch.hpp"
+
+#include "Seeking.hh"
+
+TEST_CASE("Default SeekToken is never obsolete") {
+  vivictpp::SeekToken token;
+  REQUIRE(!token.obsolete());
+}
+
+TEST_CASE("SeekToken becomes obsolete on the next seek") {
+  vivictpp::SeekSequence sequence;
+  vivictpp::SeekToken first = sequence.next();
+  REQUIRE(!first.obsolete());
+  vivictpp::SeekToken second = sequence.next();
+  REQUIRE(first.obsolete());
+  REQUIRE(!second.obsolete());
+}
+
+TEST_CASE("SeekTokens of different sequences are independent") {
+  vivictpp::SeekSequence left;
+  vivictpp::SeekSequence right;
+  vivictpp::SeekToken token = left.next();
+  right.next();
+  REQUIRE(!token.obsolete());
+}
+
+TEST_CASE("SeekCallbackSlots hands back each callback once") {
+  vivictpp::SeekCallbackSlots slots;
+  int called = 0;
+  uint64_t ticket = slots.put([&called](vivictpp::time::Time, bool) { called++; });
+  vivictpp::SeekCallback callback = slots.take(ticket);
+  REQUIRE(callback);
+  callback(0, false);
+  REQUIRE(called == 1);
+}
+
+TEST_CASE("SeekCallbackSlots drops the callbacks of long superseded seeks") {
+  vivictpp::SeekCallbackSlots slots;
+  uint64_t first = slots.put([](vivictpp::time::Time, bool) {});
+  uint64_t latest = first;
+  for (int i = 0; i < 8; i++) {
+    latest = slots.put([](vivictpp::time::Time, bool) {});
+  }
+  REQUIRE_FALSE(slots.take(first));
+  REQUIRE(slots.take(latest));
+}
@@ -0,0 +1,42 @@
+// SPDX-FileCopyrightText: 2023 Sveriges Television AB
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch2/catch.hpp"
+
+#include "libav/ThumbnailCache.hh"
+
+using vivictpp::libav::Thumbnail;
+using vivictpp::libav::ThumbnailCache;
+
+static std::shared_ptr<const Thumbnail> thumbnail(vivictpp::time::Time pts) {
+  return std::make_shared<Thumbnail>(Thumbnail{pts, 2, 2, std::vector<uint8_t>(6)});
+}
+
+TEST_CASE("ThumbnailCache has one slot per started interval") {
+  ThumbnailCache cache(1000, vivictpp::time::seconds(25), vivictpp::time::seconds(10));
+  REQUIRE(cache.slotCount() == 3);
+  REQUIRE(cache.slotTime(2) == 1000 + vivictpp::time::seconds(20));
+}
+
+TEST_CASE("ThumbnailCache answers with the closest filled slot before") {
+  ThumbnailCache cache(0, vivictpp::time::seconds(60), vivictpp::time::seconds(10));
+  REQUIRE(!cache.at(vivictpp::time::seconds(35)));
+  cache.set(1, thumbnail(vivictpp::time::seconds(9)));
+  REQUIRE(!cache.at(vivictpp::time::seconds(5)));
+  REQUIRE(cache.at(vivictpp::time::seconds(35))->pts == vivictpp::time::seconds(9));
+  cache.set(3, thumbnail(vivictpp::time::seconds(30)));
+  REQUIRE(cache.at(vivictpp::time::seconds(35))->pts == vivictpp::time::seconds(30));
+  REQUIRE(cache.at(vivictpp::time::seconds(25))->pts == vivictpp::time::seconds(9));
+  REQUIRE(cache.at(vivictpp::time::seconds(600))->pts == vivictpp::time::seconds(30));
+}
+
+TEST_CASE("ThumbnailCache counts thumbnail bytes") {
+  ThumbnailCache cache(0, vivictpp::time::seconds(20), vivictpp::time::seconds(10));
+  cache.set(0, thumbnail(0));
+  cache.set(1, thumbnail(vivictpp::time::seconds(10)));
+  cache.set(1, thumbnail(vivictpp::time::seconds(10)));
+  REQUIRE(cache.byteSize() == 12);
+  REQUIRE(cache.has(1));
+}